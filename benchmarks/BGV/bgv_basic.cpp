@@ -24,6 +24,11 @@
  */
 
 #include "bgv_common.h"
+#include "../common/energy.h"
+#include "../common/perf_counters.h"
+#include "../common/latency.h"
+#include "../common/memory.h"
+#include "../common/untimed.h"
 
 #include <NTL/BasicThreadPool.h>
 #include <helib/helib.h>
@@ -47,11 +52,16 @@ static void adding_two_ciphertexts(benchmark::State& state, Meta& meta)
   meta.data->publicKey.Encrypt(ctxt1, ptxt1);
   meta.data->publicKey.Encrypt(ctxt2, ptxt2);
   // Benchmark adding ciphertexts
+  helib::Ctxt copy(ctxt1);
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
   for (auto _ : state) {
-    state.PauseTiming();
-    auto copy(ctxt1);
-
-    state.ResumeTiming();
+    {
+      fhebench::UntimedScope untimed(state, energy, perf);
+      copy = ctxt1;
+    }
+    auto sample = latency.Measure();
     copy += ctxt2;
   }
 }
@@ -70,11 +80,16 @@ static void subtracting_two_ciphertexts(benchmark::State& state, Meta& meta)
   meta.data->publicKey.Encrypt(ctxt1, ptxt1);
   meta.data->publicKey.Encrypt(ctxt2, ptxt2);
   // Benchmark subtracting ciphertexts
+  helib::Ctxt copy(ctxt1);
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
   for (auto _ : state) {
-    state.PauseTiming();
-    auto copy(ctxt1);
-
-    state.ResumeTiming();
+    {
+      fhebench::UntimedScope untimed(state, energy, perf);
+      copy = ctxt1;
+    }
+    auto sample = latency.Measure();
     copy -= ctxt2;
   }
 }
@@ -89,11 +104,16 @@ static void negating_a_ciphertext(benchmark::State& state, Meta& meta)
 
   meta.data->publicKey.Encrypt(ctxt, ptxt);
   // Benchmark negating a ciphertext
+  helib::Ctxt copy(ctxt);
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
   for (auto _ : state) {
-    state.PauseTiming();
-    auto copy(ctxt);
-
-    state.ResumeTiming();
+    {
+      fhebench::UntimedScope untimed(state, energy, perf);
+      copy = ctxt;
+    }
+    auto sample = latency.Measure();
     copy.negate();
   }
 }
@@ -108,11 +128,16 @@ static void square_a_ciphertext(benchmark::State& state, Meta& meta)
 
   meta.data->publicKey.Encrypt(ctxt, ptxt);
   // Benchmark squaring a ciphertext
+  helib::Ctxt copy(ctxt);
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
   for (auto _ : state) {
-    state.PauseTiming();
-    auto copy(ctxt);
-
-    state.ResumeTiming();
+    {
+      fhebench::UntimedScope untimed(state, energy, perf);
+      copy = ctxt;
+    }
+    auto sample = latency.Measure();
     copy.square();
   }
 }
@@ -132,11 +157,16 @@ static void multiplying_two_ciphertexts_no_relin(benchmark::State& state,
   meta.data->publicKey.Encrypt(ctxt1, ptxt1);
   meta.data->publicKey.Encrypt(ctxt2, ptxt2);
   // Benchmark multiplying two ciphertexts without relinearization
+  helib::Ctxt copy(ctxt1);
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
   for (auto _ : state) {
-    state.PauseTiming();
-    auto copy(ctxt1);
-
-    state.ResumeTiming();
+    {
+      fhebench::UntimedScope untimed(state, energy, perf);
+      copy = ctxt1;
+    }
+    auto sample = latency.Measure();
     copy.multLowLvl(ctxt2);
   }
 }
@@ -155,11 +185,16 @@ static void multiplying_two_ciphertexts(benchmark::State& state, Meta& meta)
   meta.data->publicKey.Encrypt(ctxt1, ptxt1);
   meta.data->publicKey.Encrypt(ctxt2, ptxt2);
   // Benchmark multiplying two ciphertexts
+  helib::Ctxt copy(ctxt1);
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
   for (auto _ : state) {
-    state.PauseTiming();
-    auto copy(ctxt1);
-
-    state.ResumeTiming();
+    {
+      fhebench::UntimedScope untimed(state, energy, perf);
+      copy = ctxt1;
+    }
+    auto sample = latency.Measure();
     copy.multiplyBy(ctxt2);
   }
 }
@@ -174,11 +209,16 @@ static void rotate_a_ciphertext_by1(benchmark::State& state, Meta& meta)
 
   meta.data->publicKey.Encrypt(ctxt, ptxt);
   // Benchmark rotating a ciphertext
+  helib::Ctxt copy(ctxt);
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
   for (auto _ : state) {
-    state.PauseTiming();
-    auto copy(ctxt);
-
-    state.ResumeTiming();
+    {
+      fhebench::UntimedScope untimed(state, energy, perf);
+      copy = ctxt;
+    }
+    auto sample = latency.Measure();
     meta.data->ea.rotate(copy, 1);
   }
 }
@@ -191,8 +231,13 @@ static void encrypting_ciphertexts(benchmark::State& state, Meta& meta)
   helib::Ctxt ctxt(meta.data->publicKey);
 
   // Benchmark encrypting ciphertexts
-  for (auto _ : state)
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
+  for (auto _ : state) {
+    auto sample = latency.Measure();
     meta.data->publicKey.Encrypt(ctxt, ptxt);
+  }
 }
 
 static void decrypting_ciphertexts(benchmark::State& state, Meta& meta)
@@ -206,8 +251,116 @@ static void decrypting_ciphertexts(benchmark::State& state, Meta& meta)
   helib::Ptxt<helib::BGV> decrypted_result(meta.data->context);
 
   // Benchmark decrypting ciphertexts
-  for (auto _ : state)
+  fhebench::EnergyCounters energy(state);
+  fhebench::PerfCounters perf(state);
+  fhebench::LatencyRecorder latency(state);
+  for (auto _ : state) {
+    auto sample = latency.Measure();
     meta.data->secretKey.Decrypt(decrypted_result, ctxt);
+  }
+}
+
+static helib::Ctxt encrypt_random(Meta& meta)
+{
+  helib::Ptxt<helib::BGV> ptxt(meta.data->context);
+  ptxt.random();
+
+  helib::Ctxt ctxt(meta.data->publicKey);
+  meta.data->publicKey.Encrypt(ctxt, ptxt);
+  return ctxt;
+}
+
+// Applies op in place to the `batch` ciphertexts of one pool batch per
+// iteration. Operations that consume levels restage the batch after it has
+// been used, outside the timed region, so with cycling it has left the cache
+// again by the time it comes round.
+template <typename Op>
+static void run_batched(benchmark::State& state,
+                        const helib::Ctxt& source,
+                        bool restage,
+                        Op op)
+{
+  const long batch = state.range(0);
+  CtxtPool pool(source, batch, state.range(1) != 0);
+  {
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state, batch);
+    for (auto _ : state) {
+      helib::Ctxt* ctxts = pool.next();
+      {
+        auto sample = latency.Measure();
+        for (long i = 0; i < batch; ++i)
+          op(ctxts[i]);
+      }
+
+      if (restage) {
+        fhebench::UntimedScope untimed(state, energy, perf);
+        pool.restage(ctxts);
+      }
+    }
+  }
+  state.counters["Ops"] = batch;
+  state.counters["Per_op"] = benchmark::Counter(
+      batch,
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+  state.counters["Pool_MB"] = pool.megabytes();
+}
+
+static void adding_two_ciphertexts_batched(benchmark::State& state,
+                                           Meta& meta)
+{
+  helib::Ctxt ctxt1 = encrypt_random(meta);
+  helib::Ctxt ctxt2 = encrypt_random(meta);
+  run_batched(state, ctxt1, false, [&](helib::Ctxt& c) { c += ctxt2; });
+}
+
+static void subtracting_two_ciphertexts_batched(benchmark::State& state,
+                                                Meta& meta)
+{
+  helib::Ctxt ctxt1 = encrypt_random(meta);
+  helib::Ctxt ctxt2 = encrypt_random(meta);
+  run_batched(state, ctxt1, false, [&](helib::Ctxt& c) { c -= ctxt2; });
+}
+
+static void negating_a_ciphertext_batched(benchmark::State& state, Meta& meta)
+{
+  helib::Ctxt ctxt = encrypt_random(meta);
+  run_batched(state, ctxt, false, [](helib::Ctxt& c) { c.negate(); });
+}
+
+static void square_a_ciphertext_batched(benchmark::State& state, Meta& meta)
+{
+  helib::Ctxt ctxt = encrypt_random(meta);
+  run_batched(state, ctxt, true, [](helib::Ctxt& c) { c.square(); });
+}
+
+static void multiplying_two_ciphertexts_no_relin_batched(
+    benchmark::State& state,
+    Meta& meta)
+{
+  helib::Ctxt ctxt1 = encrypt_random(meta);
+  helib::Ctxt ctxt2 = encrypt_random(meta);
+  run_batched(
+      state, ctxt1, true, [&](helib::Ctxt& c) { c.multLowLvl(ctxt2); });
+}
+
+static void multiplying_two_ciphertexts_batched(benchmark::State& state,
+                                                Meta& meta)
+{
+  helib::Ctxt ctxt1 = encrypt_random(meta);
+  helib::Ctxt ctxt2 = encrypt_random(meta);
+  run_batched(
+      state, ctxt1, true, [&](helib::Ctxt& c) { c.multiplyBy(ctxt2); });
+}
+
+static void rotate_a_ciphertext_by1_batched(benchmark::State& state,
+                                            Meta& meta)
+{
+  helib::Ctxt ctxt = encrypt_random(meta);
+  const helib::EncryptedArray& ea = meta.data->ea;
+  run_batched(state, ctxt, true, [&](helib::Ctxt& c) { ea.rotate(c, 1); });
 }
 
 Meta fn;
@@ -221,6 +374,13 @@ HE_BENCH_CAPTURE(multiplying_two_ciphertexts_no_relin, tiny_params, fn);
 HE_BENCH_CAPTURE(rotate_a_ciphertext_by1, tiny_params, fn);
 HE_BENCH_CAPTURE(encrypting_ciphertexts, tiny_params, fn);
 HE_BENCH_CAPTURE(decrypting_ciphertexts, tiny_params, fn);
+HE_BENCH_BATCH_CAPTURE(adding_two_ciphertexts_batched, tiny_params, fn);
+HE_BENCH_BATCH_CAPTURE(subtracting_two_ciphertexts_batched, tiny_params, fn);
+HE_BENCH_BATCH_CAPTURE(negating_a_ciphertext_batched, tiny_params, fn);
+HE_BENCH_BATCH_CAPTURE(square_a_ciphertext_batched, tiny_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_batched, tiny_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_no_relin_batched, tiny_params, fn);
+HE_BENCH_BATCH_CAPTURE(rotate_a_ciphertext_by1_batched, tiny_params, fn);
 
 Params small_params(/*m=*/8009, /*p=*/2, /*r=*/1, /*qbits=*/380);
 HE_BENCH_CAPTURE(adding_two_ciphertexts, small_params, fn);
@@ -232,6 +392,13 @@ HE_BENCH_CAPTURE(multiplying_two_ciphertexts_no_relin, small_params, fn);
 HE_BENCH_CAPTURE(rotate_a_ciphertext_by1, small_params, fn);
 HE_BENCH_CAPTURE(encrypting_ciphertexts, small_params, fn);
 HE_BENCH_CAPTURE(decrypting_ciphertexts, small_params, fn);
+HE_BENCH_BATCH_CAPTURE(adding_two_ciphertexts_batched, small_params, fn);
+HE_BENCH_BATCH_CAPTURE(subtracting_two_ciphertexts_batched, small_params, fn);
+HE_BENCH_BATCH_CAPTURE(negating_a_ciphertext_batched, small_params, fn);
+HE_BENCH_BATCH_CAPTURE(square_a_ciphertext_batched, small_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_batched, small_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_no_relin_batched, small_params, fn);
+HE_BENCH_BATCH_CAPTURE(rotate_a_ciphertext_by1_batched, small_params, fn);
 
 Params big_params(/*m=*/32003, /*p=*/2, /*r=*/1, /*qbits=*/5800);
 HE_BENCH_CAPTURE(adding_two_ciphertexts, big_params, fn);
@@ -243,6 +410,13 @@ HE_BENCH_CAPTURE(multiplying_two_ciphertexts_no_relin, big_params, fn);
 HE_BENCH_CAPTURE(rotate_a_ciphertext_by1, big_params, fn);
 HE_BENCH_CAPTURE(encrypting_ciphertexts, big_params, fn);
 HE_BENCH_CAPTURE(decrypting_ciphertexts, big_params, fn);
+HE_BENCH_BATCH_CAPTURE_N(adding_two_ciphertexts_batched, big_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(subtracting_two_ciphertexts_batched, big_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(negating_a_ciphertext_batched, big_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(square_a_ciphertext_batched, big_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(multiplying_two_ciphertexts_batched, big_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(multiplying_two_ciphertexts_no_relin_batched, big_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(rotate_a_ciphertext_by1_batched, big_params, fn, 4);
 
 Params hexl_F4_params(/*m=*/32768, /*p=*/65537, /*r=*/1, /*qbits=*/6400);
 HE_BENCH_CAPTURE(adding_two_ciphertexts, hexl_F4_params, fn);
@@ -254,6 +428,13 @@ HE_BENCH_CAPTURE(multiplying_two_ciphertexts_no_relin, hexl_F4_params, fn);
 HE_BENCH_CAPTURE(rotate_a_ciphertext_by1, hexl_F4_params, fn);
 HE_BENCH_CAPTURE(encrypting_ciphertexts, hexl_F4_params, fn);
 HE_BENCH_CAPTURE(decrypting_ciphertexts, hexl_F4_params, fn);
+HE_BENCH_BATCH_CAPTURE_N(adding_two_ciphertexts_batched, hexl_F4_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(subtracting_two_ciphertexts_batched, hexl_F4_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(negating_a_ciphertext_batched, hexl_F4_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(square_a_ciphertext_batched, hexl_F4_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(multiplying_two_ciphertexts_batched, hexl_F4_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(multiplying_two_ciphertexts_no_relin_batched, hexl_F4_params, fn, 4);
+HE_BENCH_BATCH_CAPTURE_N(rotate_a_ciphertext_by1_batched, hexl_F4_params, fn, 4);
 
 Params hexl_F3_params(/*m=*/16, /*p=*/257, /*r=*/1, /*qbits=*/6400);
 HE_BENCH_CAPTURE(adding_two_ciphertexts, hexl_F3_params, fn);
@@ -265,6 +446,13 @@ HE_BENCH_CAPTURE(multiplying_two_ciphertexts_no_relin, hexl_F3_params, fn);
 HE_BENCH_CAPTURE(rotate_a_ciphertext_by1, hexl_F3_params, fn);
 HE_BENCH_CAPTURE(encrypting_ciphertexts, hexl_F3_params, fn);
 HE_BENCH_CAPTURE(decrypting_ciphertexts, hexl_F3_params, fn);
+HE_BENCH_BATCH_CAPTURE(adding_two_ciphertexts_batched, hexl_F3_params, fn);
+HE_BENCH_BATCH_CAPTURE(subtracting_two_ciphertexts_batched, hexl_F3_params, fn);
+HE_BENCH_BATCH_CAPTURE(negating_a_ciphertext_batched, hexl_F3_params, fn);
+HE_BENCH_BATCH_CAPTURE(square_a_ciphertext_batched, hexl_F3_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_batched, hexl_F3_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_no_relin_batched, hexl_F3_params, fn);
+HE_BENCH_BATCH_CAPTURE(rotate_a_ciphertext_by1_batched, hexl_F3_params, fn);
 
 Params hexl_F3d2_params(/*m=*/512, /*p=*/257, /*r=*/1, /*qbits=*/6400);
 HE_BENCH_CAPTURE(adding_two_ciphertexts, hexl_F3d2_params, fn);
@@ -276,5 +464,14 @@ HE_BENCH_CAPTURE(multiplying_two_ciphertexts_no_relin, hexl_F3d2_params, fn);
 HE_BENCH_CAPTURE(rotate_a_ciphertext_by1, hexl_F3d2_params, fn);
 HE_BENCH_CAPTURE(encrypting_ciphertexts, hexl_F3d2_params, fn);
 HE_BENCH_CAPTURE(decrypting_ciphertexts, hexl_F3d2_params, fn);
+HE_BENCH_BATCH_CAPTURE(adding_two_ciphertexts_batched, hexl_F3d2_params, fn);
+HE_BENCH_BATCH_CAPTURE(subtracting_two_ciphertexts_batched, hexl_F3d2_params, fn);
+HE_BENCH_BATCH_CAPTURE(negating_a_ciphertext_batched, hexl_F3d2_params, fn);
+HE_BENCH_BATCH_CAPTURE(square_a_ciphertext_batched, hexl_F3d2_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_batched, hexl_F3d2_params, fn);
+HE_BENCH_BATCH_CAPTURE(multiplying_two_ciphertexts_no_relin_batched, hexl_F3d2_params, fn);
+HE_BENCH_BATCH_CAPTURE(rotate_a_ciphertext_by1_batched, hexl_F3d2_params, fn);
 
 } // namespace
+
+FHEBENCH_MAIN();
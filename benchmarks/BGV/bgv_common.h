@@ -0,0 +1,283 @@
+/* Copyright (C) 2020 IBM Corp.
+ * This program is Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. See accompanying LICENSE file.
+ */
+
+#ifndef HELIB_BENCH_BGV_COMMON_H
+#define HELIB_BENCH_BGV_COMMON_H
+
+#include "../common/memory.h"
+#include "../common/results.h"
+
+#include <helib/helib.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Params
+{
+  const long m, p, r, qbits;
+  // Bootstrapping (recryption) parameters; mvec is empty for non-bootstrappable
+  // contexts.
+  const std::vector<long> mvec, gens, ords;
+  const long c;
+  const bool thinboot;
+
+  Params(long _m, long _p, long _r, long _qbits) :
+      m(_m), p(_p), r(_r), qbits(_qbits), c(3), thinboot(false)
+  {}
+  Params(long _m,
+         long _p,
+         long _r,
+         long _qbits,
+         const std::vector<long>& _mvec,
+         const std::vector<long>& _gens,
+         const std::vector<long>& _ords,
+         long _c,
+         bool _thinboot) :
+      m(_m),
+      p(_p),
+      r(_r),
+      qbits(_qbits),
+      mvec(_mvec),
+      gens(_gens),
+      ords(_ords),
+      c(_c),
+      thinboot(_thinboot)
+  {}
+  Params(const Params& other) = default;
+
+  bool bootstrappable() const { return !mvec.empty(); }
+
+  bool operator!=(const Params& other) const { return !(*this == other); }
+  bool operator==(const Params& other) const
+  {
+    return m == other.m && p == other.p && r == other.r &&
+           qbits == other.qbits && mvec == other.mvec && gens == other.gens &&
+           ords == other.ords && c == other.c && thinboot == other.thinboot;
+  }
+};
+
+inline const bool helibVersionRegistered =
+    fhebench::RegisterLibraryVersion("helib",
+                                     std::to_string(helib::version::major) +
+                                         "." +
+                                         std::to_string(helib::version::minor) +
+                                         "." +
+                                         std::to_string(helib::version::patch));
+#ifdef NTL_VERSION
+inline const bool ntlVersionRegistered =
+    fhebench::RegisterLibraryVersion("ntl", NTL_VERSION);
+#endif
+
+inline helib::Context buildContext(const Params& params)
+{
+  helib::ContextBuilder<helib::BGV> builder;
+  builder.m(params.m).p(params.p).r(params.r).bits(params.qbits);
+  if (params.bootstrappable()) {
+    builder.gens(params.gens)
+        .ords(params.ords)
+        .c(params.c)
+        .bootstrappable(true)
+        .mvec(params.mvec);
+    if (params.thinboot)
+      builder.thinboot();
+    else
+      builder.thickboot();
+  }
+  return builder.build();
+}
+
+struct ContextAndKeys
+{
+  const Params params;
+
+  helib::Context context;
+  helib::SecKey secretKey;
+  const helib::PubKey publicKey;
+  const helib::EncryptedArray& ea;
+
+  ContextAndKeys(const Params& _params) :
+      params(_params),
+      context(buildContext(params)),
+      secretKey(context),
+      publicKey((secretKey.GenSecKey(),
+                 helib::addSome1DMatrices(secretKey),
+                 genRecryptData(params, secretKey),
+                 secretKey)),
+      ea(context.getEA())
+  {
+    // stderr keeps the reporter's stdout machine-readable.
+    this->context.printout(std::cerr);
+    std::cerr << std::endl;
+  }
+
+private:
+  static int genRecryptData(const Params& params, helib::SecKey& secretKey)
+  {
+    if (params.bootstrappable()) {
+      helib::addFrbMatrices(secretKey);
+      secretKey.genRecryptData();
+    }
+    return 0;
+  }
+};
+
+/*
+ * Hands out one Meta per Params to the benchmarks. The context and keys of a
+ * Params are built on the first access through data, not when the benchmark
+ * is registered, and only one of them is resident at a time: benchmarks run in
+ * registration order, so consecutive benchmarks on the same Params share it.
+ */
+struct Meta
+{
+  class Data
+  {
+  public:
+    explicit Data(Meta* meta) : meta(meta) {}
+    ContextAndKeys* operator->() const { return &meta->get(); }
+    ContextAndKeys& operator*() const { return meta->get(); }
+
+  private:
+    Meta* meta;
+  };
+
+  Data data;
+
+  Meta() : data(this) {}
+  Meta(const Meta&) = delete;
+  Meta& operator=(const Meta&) = delete;
+
+  Meta& operator()(const Params& params)
+  {
+    for (auto& child : children)
+      if (*child->params == params)
+        return *child;
+    children.emplace_back(new Meta(this, params));
+    return *children.back();
+  }
+
+private:
+  Meta(Meta* _parent, const Params& _params) :
+      data(this), parent(_parent), params(std::make_unique<Params>(_params))
+  {}
+
+  ContextAndKeys& get()
+  {
+    Meta& root = (parent != nullptr) ? *parent : *this;
+    if (params == nullptr)
+      throw std::logic_error("Meta used without Params");
+    if (root.resident == nullptr || root.resident->params != *params) {
+      root.resident.reset();
+      root.resident = std::make_unique<ContextAndKeys>(*params);
+    }
+    return *root.resident;
+  }
+
+  Meta* parent = nullptr;
+  std::unique_ptr<Params> params;
+  std::unique_ptr<ContextAndKeys> resident;
+  std::vector<std::unique_ptr<Meta>> children;
+};
+
+inline long lastLevelCacheBytes()
+{
+  long bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (bytes <= 0)
+    bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  return (bytes > 0) ? bytes : 32L << 20;
+}
+
+/*
+ * Copies of one ciphertext for the batched benchmarks, staged before the timed
+ * loop so that an iteration is `batch` back-to-back in-place operations on
+ * contiguous Ctxt objects instead of a PauseTiming/copy/ResumeTiming round per
+ * operation. With cycle set the pool holds enough batches to exceed twice the
+ * last-level cache and next() walks through them round robin, so every batch
+ * starts from memory rather than from cache.
+ */
+class CtxtPool
+{
+public:
+  CtxtPool(const helib::Ctxt& source, long batch, bool cycle) :
+      source(source), batch(batch)
+  {
+    // The pool's footprint comes from the allocation counters, since a Ctxt
+    // keeps its DoubleCRT parts on the heap.
+    long before = fhebench::AllocationSnapshot::Take().liveBytes;
+    addBatch();
+    batchBytes = fhebench::AllocationSnapshot::Take().liveBytes - before;
+    if (cycle && batchBytes > 0)
+      while (batchBytes * numBatches() < 2 * lastLevelCacheBytes())
+        addBatch();
+  }
+
+  long numBatches() const { return ctxts.size() / batch; }
+  double megabytes() const { return batchBytes * numBatches() / 1048576.0; }
+
+  // First Ctxt of the next batch.
+  helib::Ctxt* next()
+  {
+    helib::Ctxt* first = &ctxts[cursor * batch];
+    cursor = (cursor + 1) % numBatches();
+    return first;
+  }
+
+  // Resets a batch to the source, for operations that consume levels.
+  void restage(helib::Ctxt* first)
+  {
+    for (long i = 0; i < batch; ++i)
+      first[i] = source;
+  }
+
+private:
+  void addBatch()
+  {
+    ctxts.reserve(ctxts.size() + batch);
+    for (long i = 0; i < batch; ++i)
+      ctxts.push_back(source);
+  }
+
+  const helib::Ctxt& source;
+  const long batch;
+  long batchBytes = 0;
+  std::vector<helib::Ctxt> ctxts;
+  long cursor = 0;
+};
+
+#define HE_BENCH_CAPTURE(fn, params, meta)                                     \
+  BENCHMARK_CAPTURE(fn, params, meta(params))                                  \
+      ->Unit(benchmark::kMillisecond)                                          \
+      ->Iterations(1)                                                          \
+      ->Repetitions(10)                                                        \
+      ->DisplayAggregatesOnly(true)
+
+// Batched variants take {batch, cycle} arguments; see CtxtPool. The large
+// parameter sets use a smaller batch, since a single ciphertext there is tens
+// of megabytes and 64 copies would not fit in memory.
+#define HE_BENCH_BATCH_CAPTURE_N(fn, params, meta, batch)                      \
+  BENCHMARK_CAPTURE(fn, params, meta(params))                                  \
+      ->ArgNames({"batch", "cycle"})                                           \
+      ->Args({batch, 0})                                                       \
+      ->Args({batch, 1})                                                       \
+      ->Unit(benchmark::kMicrosecond)                                          \
+      ->Repetitions(10)                                                        \
+      ->DisplayAggregatesOnly(true)
+
+#define HE_BENCH_BATCH_CAPTURE(fn, params, meta)                               \
+  HE_BENCH_BATCH_CAPTURE_N(fn, params, meta, 64)
+
+#endif // HELIB_BENCH_BGV_COMMON_H
@@ -0,0 +1,130 @@
+/* Copyright (C) 2020 IBM Corp.
+ * This program is Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. See accompanying LICENSE file.
+ */
+
+#include "bgv_common.h"
+#include "../common/energy.h"
+#include "../common/perf_counters.h"
+#include "../common/latency.h"
+#include "../common/memory.h"
+#include "../common/untimed.h"
+
+#include <NTL/ZZ.h>
+#include <helib/helib.h>
+
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// Encrypts one random element of Z_{p^r} per slot, which is what thin
+// recryption expects and is equally valid input for general recryption.
+static helib::Ctxt encrypt_random_slots(Meta& meta)
+{
+  const helib::EncryptedArray& ea = meta.data->ea;
+  long ptxtSpace = meta.data->context.getPPowR();
+  std::vector<long> slots(ea.size());
+  for (long& slot : slots)
+    slot = NTL::RandomBnd(ptxtSpace);
+
+  helib::Ctxt ctxt(meta.data->publicKey);
+  ea.encrypt(ctxt, meta.data->publicKey, slots);
+  return ctxt;
+}
+
+static void report_recrypt_counters(benchmark::State& state,
+                                    Meta& meta,
+                                    const helib::Ctxt& result)
+{
+  state.counters["Slots"] = meta.data->ea.size();
+  // Modulus bits left for computation after recryption.
+  state.counters["Capacity"] = result.bitCapacity();
+}
+
+static void thin_recrypting_a_ciphertext(benchmark::State& state, Meta& meta)
+{
+  helib::Ctxt ctxt = encrypt_random_slots(meta);
+  helib::Ctxt copy(ctxt);
+  // Benchmark thin recryption
+  {
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
+    for (auto _ : state) {
+      {
+        fhebench::UntimedScope untimed(state, energy, perf);
+        copy = ctxt;
+      }
+      auto sample = latency.Measure();
+      meta.data->publicKey.thinReCrypt(copy);
+    }
+  }
+  report_recrypt_counters(state, meta, copy);
+}
+
+static void recrypting_a_ciphertext(benchmark::State& state, Meta& meta)
+{
+  helib::Ctxt ctxt = encrypt_random_slots(meta);
+  helib::Ctxt copy(ctxt);
+  // Benchmark general (thick) recryption
+  {
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
+    for (auto _ : state) {
+      {
+        fhebench::UntimedScope untimed(state, energy, perf);
+        copy = ctxt;
+      }
+      auto sample = latency.Measure();
+      meta.data->publicKey.reCrypt(copy);
+    }
+  }
+  report_recrypt_counters(state, meta, copy);
+}
+
+// Bootstrappable parameter sets (p = 2): m = prod(mvec), with gens/ords
+// describing the hypercube of Z_m^* / <p>.
+Meta fn;
+Params tiny_thin_params(/*m=*/1023, /*p=*/2, /*r=*/1, /*qbits=*/500,
+                        /*mvec=*/{11, 93}, /*gens=*/{838, 584},
+                        /*ords=*/{10, 6}, /*c=*/2, /*thinboot=*/true);
+HE_BENCH_CAPTURE(thin_recrypting_a_ciphertext, tiny_thin_params, fn);
+
+Params tiny_thick_params(/*m=*/1023, /*p=*/2, /*r=*/1, /*qbits=*/500,
+                         /*mvec=*/{11, 93}, /*gens=*/{838, 584},
+                         /*ords=*/{10, 6}, /*c=*/2, /*thinboot=*/false);
+HE_BENCH_CAPTURE(recrypting_a_ciphertext, tiny_thick_params, fn);
+
+Params small_thin_params(/*m=*/4095, /*p=*/2, /*r=*/1, /*qbits=*/500,
+                         /*mvec=*/{7, 5, 9, 13}, /*gens=*/{2341, 3277, 911},
+                         /*ords=*/{6, 4, 6}, /*c=*/2, /*thinboot=*/true);
+HE_BENCH_CAPTURE(thin_recrypting_a_ciphertext, small_thin_params, fn);
+
+Params small_thick_params(/*m=*/4095, /*p=*/2, /*r=*/1, /*qbits=*/500,
+                          /*mvec=*/{7, 5, 9, 13}, /*gens=*/{2341, 3277, 911},
+                          /*ords=*/{6, 4, 6}, /*c=*/2, /*thinboot=*/false);
+HE_BENCH_CAPTURE(recrypting_a_ciphertext, small_thick_params, fn);
+
+Params big_thin_params(/*m=*/15709, /*p=*/2, /*r=*/1, /*qbits=*/800,
+                       /*mvec=*/{23, 683}, /*gens=*/{4099, 13663},
+                       /*ords=*/{22, 31}, /*c=*/3, /*thinboot=*/true);
+HE_BENCH_CAPTURE(thin_recrypting_a_ciphertext, big_thin_params, fn);
+
+Params big_thick_params(/*m=*/15709, /*p=*/2, /*r=*/1, /*qbits=*/800,
+                        /*mvec=*/{23, 683}, /*gens=*/{4099, 13663},
+                        /*ords=*/{22, 31}, /*c=*/3, /*thinboot=*/false);
+HE_BENCH_CAPTURE(recrypting_a_ciphertext, big_thick_params, fn);
+
+} // namespace
+
+FHEBENCH_MAIN();
@@ -0,0 +1,134 @@
+/* Copyright (C) 2020 IBM Corp.
+ * This program is Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. See accompanying LICENSE file.
+ */
+
+/*
+ * k rotations of one ciphertext along the first dimension of the slots: k
+ * independent automorphisms with a key switch each (Ctxt::smartAutomorph)
+ * against HElib's hoisted BasicAutomorphPrecon, which breaks the ciphertext
+ * into digits once and applies every automorphism to them. A rotation by i is
+ * the automorphism X -> X^(g^i) of the dimension's generator g; in a bad
+ * dimension EncryptedArray::rotate adds a second, masked automorphism, which
+ * is the same for both methods and left out. Every amount has its own
+ * key-switching matrix, so each rotation is a single key switch. The arguments
+ * are indices/k/hoisted as in common/rotations.h.
+ */
+
+#include "bgv_common.h"
+#include "../common/energy.h"
+#include "../common/perf_counters.h"
+#include "../common/latency.h"
+#include "../common/memory.h"
+#include "../common/rotations.h"
+
+#include <helib/helib.h>
+#include <helib/matmul.h>
+
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<int64_t> rotation_counts = {1, 2, 4, 8, 16, 32};
+
+static void rotating_a_ciphertext_k_times(benchmark::State& state, Meta& meta)
+{
+  const int indexSet = static_cast<int>(state.range(0));
+  const size_t k = static_cast<size_t>(state.range(1));
+  const bool hoisted = state.range(2) != 0;
+
+  helib::SecKey& secretKey = meta.data->secretKey;
+  const helib::PAlgebra& zMStar = meta.data->context.getZMStar();
+  const size_t dimension = meta.data->ea.sizeOfDimension(0);
+  if (k >= dimension) {
+    state.SkipWithError("k exceeds the size of the first dimension");
+    return;
+  }
+
+  // The public key was copied before these matrices exist, so the ciphertext
+  // is bound to (and encrypted under) the secret key, which holds them.
+  std::vector<long> exponents;
+  for (int32_t index : fhebench::RotationIndices(indexSet, k, dimension)) {
+    exponents.push_back(zMStar.genToPow(0, index));
+    secretKey.GenKeySWmatrix(1, exponents.back());
+  }
+  secretKey.setKeySwitchMap();
+
+  helib::Ptxt<helib::BGV> ptxt(meta.data->context);
+  ptxt.random();
+  helib::Ctxt ctxt(secretKey);
+  static_cast<const helib::PubKey&>(secretKey).Encrypt(ctxt, ptxt);
+
+  double digitsMB = 0;
+  if (hoisted) {
+    const int64_t liveBefore = fhebench::g_allocationCounters.liveBytes.load(
+        std::memory_order_relaxed);
+    helib::BasicAutomorphPrecon precon(ctxt);
+    digitsMB = (fhebench::g_allocationCounters.liveBytes.load(
+                    std::memory_order_relaxed) -
+                liveBefore) /
+               1048576.0;
+  }
+
+  // Benchmark k rotations of the same ciphertext
+  {
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
+    for (auto _ : state) {
+      auto sample = latency.Measure();
+      if (hoisted) {
+        helib::BasicAutomorphPrecon precon(ctxt);
+        for (long exponent : exponents) {
+          std::shared_ptr<helib::Ctxt> rotated = precon.automorph(exponent);
+          benchmark::DoNotOptimize(rotated);
+        }
+      } else {
+        for (long exponent : exponents) {
+          helib::Ctxt rotated(ctxt);
+          rotated.smartAutomorph(exponent);
+          benchmark::DoNotOptimize(rotated);
+        }
+      }
+    }
+    fhebench::RecordRotations("BGV m:" + std::to_string(meta.data->params.m) +
+                                  " indices:" + std::to_string(indexSet),
+                              hoisted,
+                              static_cast<int64_t>(k),
+                              latency.Histogram(),
+                              digitsMB);
+  }
+  fhebench::PublishRotationCounters(state, k, digitsMB);
+}
+
+void RotationArgs(benchmark::internal::Benchmark* b)
+{
+  for (int64_t indexSet : {0, 1})
+    for (int64_t k : rotation_counts)
+      for (int64_t hoisted : {0, 1})
+        b->Args({indexSet, k, hoisted});
+}
+
+// m = 8191 is prime with ord(2) = 13, so the 630 slots form one dimension.
+Meta fn;
+Params rotation_params(/*m=*/8191, /*p=*/2, /*r=*/1, /*qbits=*/300);
+BENCHMARK_CAPTURE(rotating_a_ciphertext_k_times,
+                  rotation_params,
+                  fn(rotation_params))
+    ->ArgNames({"indices", "k", "hoisted"})
+    ->Apply(RotationArgs)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+FHEBENCH_MAIN();
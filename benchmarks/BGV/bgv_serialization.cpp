@@ -0,0 +1,125 @@
+/* Copyright (C) 2020 IBM Corp.
+ * This program is Licensed under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. See accompanying LICENSE file.
+ */
+
+/* Serialization and deserialization of BGV ciphertexts in HElib's binary
+ * (writeTo/readFrom) and JSON (writeToJSON/readFromJSON) formats, optionally
+ * compressed; see common/serialization.h for the counters. Ciphertexts come
+ * from public-key and from secret-key encryption; only the latter has a
+ * uniformly random part that a seed could replace.
+ */
+
+#include "bgv_common.h"
+#include "../common/memory.h"
+#include "../common/serialization.h"
+
+#include <NTL/ZZ.h>
+#include <helib/helib.h>
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+namespace {
+
+// One random element of Z_{p^r} per slot, encrypted under the secret key when
+// secret is set. EncryptedArray::encrypt dispatches to SecKey::Encrypt for a
+// secret key.
+static helib::Ctxt encrypt_random_slots(Meta& meta, bool secret)
+{
+  const helib::EncryptedArray& ea = meta.data->ea;
+  long ptxtSpace = meta.data->context.getPPowR();
+  std::vector<long> slots(ea.size());
+  for (long& slot : slots)
+    slot = NTL::RandomBnd(ptxtSpace);
+
+  helib::Ctxt ctxt(meta.data->publicKey);
+  if (secret)
+    ea.encrypt(ctxt, meta.data->secretKey, slots);
+  else
+    ea.encrypt(ctxt, meta.data->publicKey, slots);
+  return ctxt;
+}
+
+static fhebench::SerializedObject serialized_ctxt(Meta& meta,
+                                                  bool secret,
+                                                  bool json)
+{
+  const helib::PubKey& publicKey = meta.data->publicKey;
+  helib::Ctxt ctxt = encrypt_random_slots(meta, secret);
+
+  fhebench::SerializedObject serialized;
+  serialized.write = [ctxt, json](std::ostream& out) {
+    if (json)
+      ctxt.writeToJSON(out);
+    else
+      ctxt.writeTo(out);
+  };
+  serialized.read = [&publicKey, json](std::istream& in) {
+    helib::Ctxt copy = json ? helib::Ctxt::readFromJSON(in, publicKey)
+                            : helib::Ctxt::readFrom(in, publicKey);
+    benchmark::DoNotOptimize(copy);
+  };
+  // Part 1 of a secret-key encryption is the uniform polynomial a.
+  if (secret) {
+    const helib::DoubleCRT& a = ctxt[1];
+    serialized.uniformBytes =
+        fhebench::SerializedSize([&a, json](std::ostream& out) {
+          if (json)
+            a.writeToJSON(out);
+          else
+            a.writeTo(out);
+        });
+    serialized.numSeeds = 1;
+  }
+  return serialized;
+}
+
+static void serializing_a_ciphertext(benchmark::State& state,
+                                     Meta& meta,
+                                     bool secret)
+{
+  fhebench::RunSerialization(state,
+                             serialized_ctxt(meta, secret, state.range(0) != 0),
+                             false,
+                             state.range(1));
+}
+
+static void deserializing_a_ciphertext(benchmark::State& state,
+                                       Meta& meta,
+                                       bool secret)
+{
+  fhebench::RunSerialization(state,
+                             serialized_ctxt(meta, secret, state.range(0) != 0),
+                             true,
+                             state.range(1));
+}
+
+#define HE_BENCH_SERIALIZATION_CAPTURE(fn, params, meta, name, secret)         \
+  BENCHMARK_CAPTURE(fn, params##_##name, meta(params), secret)                 \
+      ->Apply(fhebench::SerializationArgs)                                     \
+      ->Unit(benchmark::kMicrosecond)
+
+Meta fn;
+Params tiny_params(/*m=*/257, /*p=*/2, /*r=*/1, /*qbits=*/360);
+HE_BENCH_SERIALIZATION_CAPTURE(serializing_a_ciphertext, tiny_params, fn, pk, false);
+HE_BENCH_SERIALIZATION_CAPTURE(serializing_a_ciphertext, tiny_params, fn, sk, true);
+HE_BENCH_SERIALIZATION_CAPTURE(deserializing_a_ciphertext, tiny_params, fn, pk, false);
+HE_BENCH_SERIALIZATION_CAPTURE(deserializing_a_ciphertext, tiny_params, fn, sk, true);
+
+Params small_params(/*m=*/8009, /*p=*/2, /*r=*/1, /*qbits=*/380);
+HE_BENCH_SERIALIZATION_CAPTURE(serializing_a_ciphertext, small_params, fn, pk, false);
+HE_BENCH_SERIALIZATION_CAPTURE(serializing_a_ciphertext, small_params, fn, sk, true);
+HE_BENCH_SERIALIZATION_CAPTURE(deserializing_a_ciphertext, small_params, fn, pk, false);
+HE_BENCH_SERIALIZATION_CAPTURE(deserializing_a_ciphertext, small_params, fn, sk, true);
+
+} // namespace
+
+FHEBENCH_MAIN();
@@ -35,6 +35,23 @@
 
 #include "benchmark/benchmark.h"
 #include "binfhecontext.h"
+#include "cggi_common.h"
+
+#include "../common/energy.h"
+#include "../common/frequency.h"
+#include "../common/perf_counters.h"
+#include "../common/latency.h"
+#include "../common/memory.h"
+#include "../common/stability.h"
+#include "../common/thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 using namespace lbcrypto;
 
@@ -42,11 +59,7 @@ using namespace lbcrypto;
  * Context setup utility methods
  */
 
-BinFHEContext GenerateFHEWContext(BINFHE_PARAMSET set) {
-    auto cc = BinFHEContext();
-    cc.GenerateBinFHEContext(set, GINX);
-    return cc;
-}
+using fhebench::GenerateFHEWContext;
 
 /*
  * FHEW benchmarks
@@ -57,7 +70,11 @@ void FHEW_BTKEYGEN(benchmark::State& state, ParamSet param_set) {
     BINFHE_PARAMSET param(param_set);
     BinFHEContext cc = GenerateFHEWContext(param);
 
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state) {
+        auto sample = latency.Measure();
         LWEPrivateKey sk = cc.KeyGen();
         cc.BTKeyGen(sk);
     }
@@ -72,7 +89,11 @@ void FHEW_ENCRYPT(benchmark::State& state, ParamSet param_set) {
     BinFHEContext cc = GenerateFHEWContext(param);
 
     LWEPrivateKey sk = cc.KeyGen();
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state) {
+        auto sample = latency.Measure();
         LWECiphertext ct1 = cc.Encrypt(sk, 1, SMALL_DIM);
     }
 }
@@ -89,7 +110,11 @@ void FHEW_NOT(benchmark::State& state, ParamSet param_set) {
 
     LWECiphertext ct1 = cc.Encrypt(sk, 1, SMALL_DIM);
 
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state) {
+        auto sample = latency.Measure();
         LWECiphertext ct11 = cc.EvalNOT(ct1);
     }
 }
@@ -103,16 +128,20 @@ void FHEW_BINGATE(benchmark::State& state, ParamSet param_set, BinGate bin_gate)
     BINGATE gate(bin_gate);
     BINFHE_PARAMSET param(param_set);
 
-    BinFHEContext cc = GenerateFHEWContext(param);
-
-    LWEPrivateKey sk = cc.KeyGen();
-
-    cc.BTKeyGen(sk);
+    // Bootstrapping keys come from the key store after the first run.
+    auto keys         = fhebench::LoadOrGenerateFHEWKeys(param);
+    BinFHEContext& cc = keys.cc;
+    LWEPrivateKey sk  = keys.sk;
 
     LWECiphertext ct1 = cc.Encrypt(sk, 1);
     LWECiphertext ct2 = cc.Encrypt(sk, 1);
 
+    fhebench::EnergyCounters energy(state);
+    fhebench::FrequencyCounters frequency(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state) {
+        auto sample = latency.Measure();
         LWECiphertext ct11 = cc.EvalBinGate(gate, ct1, ct2);
     }
 }
@@ -141,6 +170,206 @@ BENCHMARK_CAPTURE(FHEW_BINGATE, STD128_XOR, STD128, XOR)->Unit(benchmark::kMicro
 
 BENCHMARK_CAPTURE(FHEW_BINGATE, STD128_XNOR, STD128, XNOR)->Unit(benchmark::kMicrosecond);
 
+/*
+ * The AND gate with GINX and with AP bootstrapping, interleaved under the stability
+ * engine (benchmarks/common/stability.h) until both 95% confidence intervals are within
+ * FHEBENCH_CI_TARGET. Ratio is the AP time over the GINX time, paired round by round.
+ */
+template <class ParamSet>
+void FHEW_BINGATE_STABLE_AB(benchmark::State& state, ParamSet param_set) {
+    BINFHE_PARAMSET param(param_set);
+
+    auto ginx = fhebench::LoadOrGenerateFHEWKeys(param, GINX);
+    auto ap   = fhebench::LoadOrGenerateFHEWKeys(param, AP);
+
+    LWECiphertext ginx1 = ginx.cc.Encrypt(ginx.sk, 1);
+    LWECiphertext ginx2 = ginx.cc.Encrypt(ginx.sk, 1);
+    LWECiphertext ap1   = ap.cc.Encrypt(ap.sk, 1);
+    LWECiphertext ap2   = ap.cc.Encrypt(ap.sk, 1);
+
+    auto evalGinx = [&] {
+        LWECiphertext ct = ginx.cc.EvalBinGate(AND, ginx1, ginx2);
+        benchmark::DoNotOptimize(ct);
+    };
+    auto evalAp = [&] {
+        LWECiphertext ct = ap.cc.EvalBinGate(AND, ap1, ap2);
+        benchmark::DoNotOptimize(ct);
+    };
+    fhebench::RunStable(state, {{"GINX", evalGinx}, {"AP", evalAp}});
+}
+
+BENCHMARK_CAPTURE(FHEW_BINGATE_STABLE_AB, MEDIUM_AND, MEDIUM)
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+/*
+ * Multi-threaded gate throughput: a batch of independent gates per iteration, spread over
+ * a work-stealing pool. All workers share one BinFHEContext and one set of bootstrapping
+ * keys, which EvalBinGate only reads. Reports gates/second and the parallel efficiency
+ * relative to the single-thread run of the same parameter set and gate.
+ */
+
+struct FHEWGateBatch {
+    BinFHEContext cc;
+    LWEPrivateKey sk;
+    std::vector<LWECiphertext> lhs;
+    std::vector<LWECiphertext> rhs;
+};
+
+// Keys and inputs are generated once per parameter set and shared by every gate type
+// and thread count.
+std::shared_ptr<FHEWGateBatch> GetFHEWGateBatch(BINFHE_PARAMSET param, size_t batchSize) {
+    static std::mutex mutex;
+    static std::map<BINFHE_PARAMSET, std::shared_ptr<FHEWGateBatch>> batches;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& batch = batches[param];
+    if (!batch) {
+        auto keys = fhebench::LoadOrGenerateFHEWKeys(param);
+        batch     = std::make_shared<FHEWGateBatch>();
+        batch->cc = keys.cc;
+        batch->sk = keys.sk;
+    }
+    for (size_t i = batch->lhs.size(); i < batchSize; ++i) {
+        batch->lhs.push_back(batch->cc.Encrypt(batch->sk, i % 2));
+        batch->rhs.push_back(batch->cc.Encrypt(batch->sk, (i / 2) % 2));
+    }
+    return batch;
+}
+
+// Gates/second of one thread over the batch, measured on first use per (parameter set,
+// gate) unless the 1-thread run has already recorded it, so that the efficiency does not
+// depend on which runs --benchmark_filter selects.
+std::map<std::pair<BINFHE_PARAMSET, BINGATE>, double>& SingleThreadGateRates() {
+    static std::map<std::pair<BINFHE_PARAMSET, BINGATE>, double> rates;
+    return rates;
+}
+
+double SingleThreadGateRate(const FHEWGateBatch& batch, BINFHE_PARAMSET param, BINGATE gate, size_t batchSize) {
+    auto& rates = SingleThreadGateRates();
+    auto rate   = rates.find({param, gate});
+    if (rate != rates.end())
+        return rate->second;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < batchSize; ++i) {
+        LWECiphertext result = batch.cc.EvalBinGate(gate, batch.lhs[i], batch.rhs[i]);
+        benchmark::DoNotOptimize(result);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return rates[{param, gate}] = static_cast<double>(batchSize) / seconds;
+}
+
+template <class ParamSet, class BinGate>
+void FHEW_BINGATE_THROUGHPUT(benchmark::State& state, ParamSet param_set, BinGate bin_gate) {
+    BINGATE gate(bin_gate);
+    BINFHE_PARAMSET param(param_set);
+
+    const size_t numThreads = static_cast<size_t>(state.range(0));
+    const size_t batchSize  = static_cast<size_t>(state.range(1));
+
+    auto batch = GetFHEWGateBatch(param, batchSize);
+    BinFHEContext& cc = batch->cc;
+    std::vector<LWECiphertext> results(batchSize);
+
+    const double baseline = (numThreads > 1) ? SingleThreadGateRate(*batch, param, gate, batchSize) : 0;
+    fhebench::WorkStealingPool pool(numThreads);
+
+    // The loop's own time, without building and tearing down the counters.
+    std::chrono::steady_clock::duration timed{};
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::FrequencyCounters frequency(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            auto sample = latency.Measure();
+            auto start  = std::chrono::steady_clock::now();
+            pool.ParallelFor(batchSize, [&](size_t i) { results[i] = cc.EvalBinGate(gate, batch->lhs[i], batch->rhs[i]); });
+            timed += std::chrono::steady_clock::now() - start;
+        }
+    }
+    double seconds = std::chrono::duration<double>(timed).count();
+    double gatesPerSecond = static_cast<double>(batchSize) * static_cast<double>(state.iterations()) / seconds;
+    // The extra run for the memory figures is slowed down by the allocation hooks.
+    if (numThreads == 1 && !fhebench::g_memoryRunActive.load(std::memory_order_relaxed))
+        SingleThreadGateRates()[{param, gate}] = gatesPerSecond;
+
+    // Ops makes the reporter's Throughput column read gates/second.
+    state.counters["Ops"]         = static_cast<double>(batchSize);
+    state.counters["Threads"]     = static_cast<double>(numThreads);
+    state.counters["Gates_per_s"] = gatesPerSecond;
+    state.counters["Efficiency"] =
+        (numThreads > 1) ? gatesPerSecond / (static_cast<double>(numThreads) * baseline) : 1.0;
+}
+
+// Threads 1, 2, 4, ... up to and including the number of hardware threads (of the
+// FHEBENCH_AFFINITY policy, if one is set).
+void GateThroughputArgs(benchmark::internal::Benchmark* b) {
+    const int64_t maxThreads = fhebench::AvailableThreads();
+    const int64_t batchSize  = 64;
+    for (int64_t threads = 1; threads < maxThreads; threads *= 2)
+        b->Args({threads, batchSize});
+    b->Args({maxThreads, batchSize});
+}
+
+#define FHEW_BINGATE_THROUGHPUT_CAPTURE(name, param, gate)                          \
+    BENCHMARK_CAPTURE(FHEW_BINGATE_THROUGHPUT, name, param, gate)                   \
+        ->ArgNames({"threads", "batch"})                                            \
+        ->Apply(GateThroughputArgs)                                                 \
+        ->UseRealTime()                                                             \
+        ->Unit(benchmark::kMillisecond)
+
+FHEW_BINGATE_THROUGHPUT_CAPTURE(MEDIUM_OR, MEDIUM, OR);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(MEDIUM_AND, MEDIUM, AND);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(MEDIUM_NOR, MEDIUM, NOR);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(MEDIUM_NAND, MEDIUM, NAND);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(MEDIUM_XOR, MEDIUM, XOR);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(MEDIUM_XNOR, MEDIUM, XNOR);
+
+FHEW_BINGATE_THROUGHPUT_CAPTURE(STD128_OR, STD128, OR);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(STD128_AND, STD128, AND);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(STD128_NOR, STD128, NOR);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(STD128_NAND, STD128, NAND);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(STD128_XOR, STD128, XOR);
+FHEW_BINGATE_THROUGHPUT_CAPTURE(STD128_XNOR, STD128, XNOR);
+
+/*
+ * Start-up cost of a bootstrapping-capable context: generating context and keys (cold)
+ * versus loading them from the key store (cached).
+ */
+template <class ParamSet>
+void FHEW_STARTUP(benchmark::State& state, ParamSet param_set) {
+    BINFHE_PARAMSET param(param_set);
+    const bool cached = state.range(0) != 0;
+
+    if (cached) {
+        if (!fhebench::KeyStore::Enabled()) {
+            state.SkipWithError("key store disabled (FHEBENCH_KEY_CACHE=off)");
+            return;
+        }
+        // Make sure an entry exists before timing.
+        fhebench::LoadOrGenerateFHEWKeys(param);
+    }
+
+    for (auto _ : state) {
+        if (cached) {
+            auto keys = fhebench::LoadOrGenerateFHEWKeys(param);
+            benchmark::DoNotOptimize(keys);
+        }
+        else {
+            BinFHEContext cc = GenerateFHEWContext(param);
+            LWEPrivateKey sk = cc.KeyGen();
+            cc.BTKeyGen(sk);
+            benchmark::DoNotOptimize(sk);
+        }
+    }
+}
+
+BENCHMARK_CAPTURE(FHEW_STARTUP, MEDIUM, MEDIUM)->ArgName("cached")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(FHEW_STARTUP, STD128, STD128)->ArgName("cached")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
 // benchmark for key switching
 template <class ParamSet>
 void FHEW_KEYSWITCH(benchmark::State& state, ParamSet param_set) {
@@ -153,7 +382,11 @@ void FHEW_KEYSWITCH(benchmark::State& state, ParamSet param_set) {
     auto ctQN1         = cc.Encrypt(skN, 1, SMALL_DIM);
     auto keySwitchHint = cc.KeySwitchGen(sk, skN);
 
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state) {
+        auto sample = latency.Measure();
         LWECiphertext eQ1 = cc.GetLWEScheme()->KeySwitch(cc.GetParams()->GetLWEParams(), keySwitchHint, ctQN1);
     }
 }
@@ -161,4 +394,4 @@ void FHEW_KEYSWITCH(benchmark::State& state, ParamSet param_set) {
 BENCHMARK_CAPTURE(FHEW_KEYSWITCH, MEDIUM, MEDIUM)->Unit(benchmark::kMicrosecond)->MinTime(1.0);
 BENCHMARK_CAPTURE(FHEW_KEYSWITCH, STD128, STD128)->Unit(benchmark::kMicrosecond)->MinTime(1.0);
 
-BENCHMARK_MAIN();
+FHEBENCH_MAIN();
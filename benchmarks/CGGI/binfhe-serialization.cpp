@@ -0,0 +1,136 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+ * Serialization and deserialization of FHEW objects: an LWE ciphertext and the key
+ * switching key (keySwitchHint) that FHEW_KEYSWITCH in binfhe-ginx.cpp uses, in binary
+ * and JSON, optionally compressed. See common/serialization.h for the counters.
+ */
+
+#include "benchmark/benchmark.h"
+#include "binfhecontext.h"
+#include "cggi_common.h"
+
+#include "../common/memory.h"
+#include "../common/openfhe_serialization.h"
+
+#include <map>
+#include <memory>
+
+using namespace lbcrypto;
+
+enum class FHEWObject { Ciphertext, KeySwitchHint };
+
+struct SerializationKeys {
+    BinFHEContext cc;
+    LWECiphertext ct;
+    LWESwitchingKey keySwitchHint;
+};
+
+// Generated once per parameter set, the same way as in FHEW_ENCRYPT and FHEW_KEYSWITCH.
+static const SerializationKeys& GetSerializationKeys(BINFHE_PARAMSET set) {
+    static std::map<BINFHE_PARAMSET, std::unique_ptr<SerializationKeys>> cache;
+    auto& keys = cache[set];
+    if (!keys) {
+        keys     = std::make_unique<SerializationKeys>();
+        keys->cc = fhebench::GenerateFHEWContext(set);
+
+        LWEPrivateKey sk  = keys->cc.KeyGen();
+        LWEPrivateKey skN = keys->cc.KeyGenN();
+
+        keys->ct            = keys->cc.Encrypt(sk, 1);
+        keys->keySwitchHint = keys->cc.KeySwitchGen(sk, skN);
+    }
+    return *keys;
+}
+
+// The `a` vectors of a fresh ciphertext and of the key switching key are uniform.
+template <typename ST>
+static fhebench::SerializedObject MakeFHEWObject(const SerializationKeys& keys, FHEWObject kind, const ST& sertype) {
+    fhebench::SerializedObject serialized;
+    if (kind == FHEWObject::KeySwitchHint) {
+        serialized              = fhebench::Serialized(keys.keySwitchHint, sertype);
+        serialized.uniformBytes = fhebench::SerializedBytes(keys.keySwitchHint->GetElementsA(), sertype);
+    }
+    else {
+        serialized              = fhebench::Serialized(keys.ct, sertype);
+        serialized.uniformBytes = fhebench::SerializedBytes(keys.ct->GetA(), sertype);
+    }
+    serialized.numSeeds = 1;
+    return serialized;
+}
+
+static fhebench::SerializedObject MakeFHEWObject(BINFHE_PARAMSET set, FHEWObject kind, bool json) {
+    const SerializationKeys& keys = GetSerializationKeys(set);
+    return json ? MakeFHEWObject(keys, kind, SerType::JSON) : MakeFHEWObject(keys, kind, SerType::BINARY);
+}
+
+template <class ParamSet>
+void FHEW_SERIALIZE(benchmark::State& state, ParamSet param_set, FHEWObject kind) {
+    BINFHE_PARAMSET param(param_set);
+    fhebench::RunSerialization(state, MakeFHEWObject(param, kind, state.range(0) != 0), false,
+                               static_cast<int>(state.range(1)));
+}
+
+template <class ParamSet>
+void FHEW_DESERIALIZE(benchmark::State& state, ParamSet param_set, FHEWObject kind) {
+    BINFHE_PARAMSET param(param_set);
+    fhebench::RunSerialization(state, MakeFHEWObject(param, kind, state.range(0) != 0), true,
+                               static_cast<int>(state.range(1)));
+}
+
+BENCHMARK_CAPTURE(FHEW_SERIALIZE, MEDIUM_CIPHERTEXT, MEDIUM, FHEWObject::Ciphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(FHEW_SERIALIZE, STD128_CIPHERTEXT, STD128, FHEWObject::Ciphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(FHEW_SERIALIZE, MEDIUM_KEYSWITCH, MEDIUM, FHEWObject::KeySwitchHint)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(FHEW_SERIALIZE, STD128_KEYSWITCH, STD128, FHEWObject::KeySwitchHint)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(FHEW_DESERIALIZE, MEDIUM_CIPHERTEXT, MEDIUM, FHEWObject::Ciphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(FHEW_DESERIALIZE, STD128_CIPHERTEXT, STD128, FHEWObject::Ciphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(FHEW_DESERIALIZE, MEDIUM_KEYSWITCH, MEDIUM, FHEWObject::KeySwitchHint)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(FHEW_DESERIALIZE, STD128_KEYSWITCH, STD128, FHEWObject::KeySwitchHint)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMillisecond);
+
+FHEBENCH_MAIN();
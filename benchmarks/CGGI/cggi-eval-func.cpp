@@ -4,6 +4,21 @@
 
 #include "benchmark/benchmark.h"
 #include "binfhecontext.h"
+#include "cggi_common.h"
+#include "cggi_lut.h"
+
+#include "../common/energy.h"
+#include "../common/perf_counters.h"
+#include "../common/latency.h"
+#include "../common/memory.h"
+#include "../common/untimed.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 using namespace lbcrypto;
 
@@ -11,12 +26,7 @@ using namespace lbcrypto;
  * Context setup utility methods
  */
 
-BinFHEContext GenerateFHEWContext(BINFHE_PARAMSET set)
-{
-    auto cc = BinFHEContext();
-    cc.GenerateBinFHEContext(set, GINX);
-    return cc;
-}
+using fhebench::GenerateFHEWContext;
 
 /*
  * FHEW benchmarks
@@ -28,8 +38,12 @@ void FHEW_BTKEYGEN(benchmark::State &state, ParamSet param_set)
     BINFHE_PARAMSET param(param_set);
     BinFHEContext cc = GenerateFHEWContext(param);
 
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state)
     {
+        auto sample = latency.Measure();
         LWEPrivateKey sk = cc.KeyGen();
         cc.BTKeyGen(sk);
     }
@@ -45,8 +59,12 @@ void FHEW_ENCRYPT(benchmark::State &state, ParamSet param_set)
     BinFHEContext cc = GenerateFHEWContext(param);
 
     LWEPrivateKey sk = cc.KeyGen();
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state)
     {
+        auto sample = latency.Measure();
         LWECiphertext ct1 = cc.Encrypt(sk, 1, SMALL_DIM);
     }
 }
@@ -60,11 +78,10 @@ void FHEW_EVAL_FUNC(benchmark::State &state, ParamSet param_set)
 {
     BINFHE_PARAMSET param(param_set);
 
-    BinFHEContext cc = GenerateFHEWContext(param);
-
-    LWEPrivateKey sk = cc.KeyGen();
-
-    cc.BTKeyGen(sk);
+    // Bootstrapping keys come from the key store after the first run.
+    auto keys = fhebench::LoadOrGenerateFHEWKeys(param);
+    BinFHEContext &cc = keys.cc;
+    LWEPrivateKey sk = keys.sk;
 
     int p = cc.GetMaxPlaintextSpace().ConvertToInt(); // Obtain the maximum plaintext space
 
@@ -81,8 +98,12 @@ void FHEW_EVAL_FUNC(benchmark::State &state, ParamSet param_set)
 
     auto lut = cc.GenerateLUTviaFunction(fp, p);
 
+    fhebench::EnergyCounters energy(state);
+    fhebench::PerfCounters perf(state);
+    fhebench::LatencyRecorder latency(state);
     for (auto _ : state)
     {
+        auto sample = latency.Measure();
         LWECiphertext ct11 = cc.EvalFunc(ct1, lut);
     }
 }
@@ -90,4 +111,129 @@ void FHEW_EVAL_FUNC(benchmark::State &state, ParamSet param_set)
 BENCHMARK_CAPTURE(FHEW_EVAL_FUNC, MEDIUM, MEDIUM)->Unit(benchmark::kMicrosecond);
 BENCHMARK_CAPTURE(FHEW_EVAL_FUNC, STD128, STD128)->Unit(benchmark::kMicrosecond);
 
-BENCHMARK_MAIN();
+/*
+ * Many functions on the same ciphertext: each iteration applies M different functions
+ * (fhebench::PolynomialLUT) to one encryption, at plaintext modulus p = 2^logp. With
+ * cached:0 the LUT registry is cleared at the start of every iteration, so the timed
+ * work includes generating the M tables; with cached:1 they are generated before timing
+ * and only looked up. Per_op is the amortized cost of one function, LUT_gen_us the
+ * average time to generate one table and LUT_share the fraction of the iteration spent
+ * generating tables.
+ *
+ * Each p gets an STD128 context for arbitrary functions with logQ = logp + 9 (2^(logQ-9)
+ * is its maximum plaintext space, p = 8 at logQ = 12 as in the original example).
+ */
+
+struct FHEWFuncContext
+{
+    fhebench::FHEWKeys keys;
+    fhebench::LUTRegistry registry;
+};
+
+std::shared_ptr<FHEWFuncContext> GetFHEWFuncContext(uint32_t logQ)
+{
+    static std::mutex mutex;
+    static std::map<uint32_t, std::shared_ptr<FHEWFuncContext>> contexts;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &context = contexts[logQ];
+    if (!context)
+    {
+        context = std::make_shared<FHEWFuncContext>();
+        context->keys = fhebench::LoadOrGenerateFHEWKeys(STD128, GINX, logQ);
+        fhebench::RegisterPolynomialLUTs(context->registry);
+    }
+    return context;
+}
+
+void FHEW_EVAL_FUNC_MANY(benchmark::State &state)
+{
+    const uint32_t logp = static_cast<uint32_t>(state.range(0));
+    const uint32_t numFunctions = static_cast<uint32_t>(state.range(1));
+    const bool cached = state.range(2) != 0;
+
+    auto context = GetFHEWFuncContext(logp + 9);
+    BinFHEContext &cc = context->keys.cc;
+    LWEPrivateKey sk = context->keys.sk;
+    fhebench::LUTRegistry &registry = context->registry;
+
+    const NativeInteger p(uint64_t(1) << logp);
+    if (p > cc.GetMaxPlaintextSpace())
+    {
+        state.SkipWithError("p exceeds the maximum plaintext space of the context");
+        return;
+    }
+
+    std::vector<std::string> ids;
+    for (uint32_t k = 0; k < numFunctions; ++k)
+        ids.push_back(fhebench::PolynomialLUTId(k % fhebench::kNumPolynomialLUTs));
+
+    const uint64_t x = 3 % p.ConvertToInt<uint64_t>();
+    LWECiphertext ct1 = cc.Encrypt(sk, x, LARGE_DIM, p.ConvertToInt<uint64_t>());
+
+    // One untimed check that the context evaluates the table correctly at this p.
+    registry.Clear();
+    {
+        LWEPlaintext result;
+        cc.Decrypt(sk, cc.EvalFunc(ct1, registry.Get(cc, ids[0], p)), &result, p.ConvertToInt<uint64_t>());
+        if (static_cast<uint64_t>(result) != fhebench::PolynomialLUT<0>(NativeInteger(x), p).ConvertToInt<uint64_t>())
+        {
+            state.SkipWithError("EvalFunc returned a wrong result at this p");
+            return;
+        }
+    }
+    for (const auto &id : ids)
+        registry.Get(cc, id, p);
+
+    const uint64_t generatedBefore = registry.Generated();
+    const double generationBefore = registry.GenerationSeconds();
+    // Time of the timed parts only, for LUT_share: without the paused registry.Clear()
+    // calls and the setup and teardown of the counters.
+    std::chrono::steady_clock::duration timed{};
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state, numFunctions);
+        for (auto _ : state)
+        {
+            if (!cached)
+            {
+                fhebench::UntimedScope untimed(state, energy, perf);
+                registry.Clear();
+            }
+            auto sample = latency.Measure();
+            auto start = std::chrono::steady_clock::now();
+            for (const auto &id : ids)
+            {
+                LWECiphertext ct2 = cc.EvalFunc(ct1, registry.Get(cc, id, p));
+                benchmark::DoNotOptimize(ct2);
+            }
+            timed += std::chrono::steady_clock::now() - start;
+        }
+    }
+    double seconds = std::chrono::duration<double>(timed).count();
+
+    state.counters["Ops"] = numFunctions;
+    state.counters["Per_op"] = benchmark::Counter(
+        numFunctions, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["LUT_gen_us"] = 1e6 * registry.GenerationSeconds() / static_cast<double>(registry.Generated());
+    if (!cached)
+        state.counters["LUT_share"] = (registry.GenerationSeconds() - generationBefore) / seconds;
+    state.counters["LUTs_generated"] = static_cast<double>(registry.Generated() - generatedBefore);
+}
+
+// p = 4 ... 2^12, for 1, 8 and 32 functions, with and without cached tables.
+void EvalFuncManyArgs(benchmark::internal::Benchmark *b)
+{
+    for (int64_t logp = 2; logp <= 12; ++logp)
+        for (int64_t numFunctions : {1, 8, 32})
+            for (int64_t cached : {0, 1})
+                b->Args({logp, numFunctions, cached});
+}
+
+BENCHMARK(FHEW_EVAL_FUNC_MANY)
+    ->ArgNames({"logp", "functions", "cached"})
+    ->Apply(EvalFuncManyArgs)
+    ->Unit(benchmark::kMillisecond);
+
+FHEBENCH_MAIN();
@@ -0,0 +1,122 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+ * Shared context and key setup for the FHEW/CGGI benchmarks
+ */
+
+#ifndef FHEBENCH_CGGI_COMMON_H
+#define FHEBENCH_CGGI_COMMON_H
+
+#include "binfhecontext.h"
+#include "binfhecontext-ser.h"
+
+#include "../common/keystore.h"
+#include "../common/results.h"
+
+#include <string>
+
+namespace fhebench {
+
+using namespace lbcrypto;
+
+#ifdef BASE_OPENFHE_VERSION
+inline const bool g_openfheVersionRegistered = RegisterLibraryVersion("openfhe", BASE_OPENFHE_VERSION);
+#endif
+
+/*
+ * logQ != 0 generates a context for arbitrary function evaluation (EvalFunc) with a
+ * ciphertext modulus of about 2^logQ, as GenerateBinFHEContext(set, true, logQ) does.
+ */
+inline BinFHEContext GenerateFHEWContext(BINFHE_PARAMSET set, BINFHE_METHOD method = GINX, uint32_t logQ = 0) {
+    auto cc = BinFHEContext();
+    if (logQ != 0)
+        cc.GenerateBinFHEContext(set, true, logQ, 0, method);
+    else
+        cc.GenerateBinFHEContext(set, method);
+    return cc;
+}
+
+// Everything the cached keys depend on; an entry from another library build is never reused.
+inline std::string FHEWKeyDescription(BINFHE_PARAMSET set, BINFHE_METHOD method, uint32_t logQ = 0) {
+    std::string description = "binfhe paramset=" + std::to_string(set) + " method=" + std::to_string(method) +
+                              " nativeint=" + std::to_string(NATIVEINT);
+    if (logQ != 0)
+        description += " arbfunc logQ=" + std::to_string(logQ);
+#ifdef BASE_OPENFHE_VERSION
+    description += " openfhe=" BASE_OPENFHE_VERSION;
+#endif
+    return description;
+}
+
+struct FHEWKeys {
+    BinFHEContext cc;
+    LWEPrivateKey sk;
+};
+
+/*
+ * Context, secret key and bootstrapping (refresh and key switching) keys for a parameter
+ * set, loaded from the key store when an entry exists and generated and stored otherwise.
+ */
+inline FHEWKeys LoadOrGenerateFHEWKeys(BINFHE_PARAMSET set, BINFHE_METHOD method = GINX, uint32_t logQ = 0) {
+    const std::string description = FHEWKeyDescription(set, method, logQ);
+
+    FHEWKeys keys;
+    bool loaded = KeyStore::Load(description, [&](std::istream& in) {
+        RingGSWACCKey refreshKey;
+        LWESwitchingKey switchKey;
+        Serial::Deserialize(keys.cc, in, SerType::BINARY);
+        Serial::Deserialize(keys.sk, in, SerType::BINARY);
+        Serial::Deserialize(refreshKey, in, SerType::BINARY);
+        Serial::Deserialize(switchKey, in, SerType::BINARY);
+        // Loading deserialized bootstrapping keys
+        keys.cc.BTKeyLoad({refreshKey, switchKey});
+    });
+    if (loaded)
+        return keys;
+
+    keys    = FHEWKeys();
+    keys.cc = GenerateFHEWContext(set, method, logQ);
+    keys.sk = keys.cc.KeyGen();
+    keys.cc.BTKeyGen(keys.sk);
+
+    KeyStore::Store(description, [&](std::ostream& out) {
+        Serial::Serialize(keys.cc, out, SerType::BINARY);
+        Serial::Serialize(keys.sk, out, SerType::BINARY);
+        Serial::Serialize(keys.cc.GetRefreshKey(), out, SerType::BINARY);
+        Serial::Serialize(keys.cc.GetSwitchKey(), out, SerType::BINARY);
+    });
+    return keys;
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CGGI_COMMON_H
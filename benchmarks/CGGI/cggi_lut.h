@@ -0,0 +1,131 @@
+/*
+ * Registry of lookup tables for FHEW functional bootstrapping (EvalFunc).
+ *
+ * GenerateLUTviaFunction evaluates the function at every point of the LWE modulus q, so
+ * a pipeline that applies many small functions pays for the tables again and again
+ * unless it keeps them. LUTRegistry maps a function id to its function and caches the
+ * generated tables by (id, plaintext modulus p, q); Get() generates a table on first
+ * use and returns the cached one afterwards, and keeps count of both.
+ */
+
+#ifndef FHEBENCH_CGGI_LUT_H
+#define FHEBENCH_CGGI_LUT_H
+
+#include "binfhecontext.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace fhebench {
+
+using namespace lbcrypto;
+
+// The form GenerateLUTviaFunction accepts: a plain function, not a closure.
+using LUTFunction = NativeInteger (*)(NativeInteger m, NativeInteger p);
+
+class LUTRegistry {
+public:
+    // Adds f under id; an id keeps the function it was first registered with.
+    void Register(const std::string& id, LUTFunction f) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_functions.emplace(id, f);
+    }
+
+    bool Contains(const std::string& id) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_functions.count(id) != 0;
+    }
+
+    // Table of function id for plaintext modulus p under the LWE modulus of cc. The
+    // reference stays valid until Clear().
+    const std::vector<NativeInteger>& Get(BinFHEContext& cc, const std::string& id, NativeInteger p) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto function = m_functions.find(id);
+        if (function == m_functions.end())
+            OPENFHE_THROW("no LUT function registered as " + id);
+
+        const NativeInteger q = cc.GetParams()->GetLWEParams()->Getq();
+        auto key              = std::make_tuple(id, p.ConvertToInt<uint64_t>(), q.ConvertToInt<uint64_t>());
+        auto table            = m_tables.find(key);
+        if (table != m_tables.end()) {
+            ++m_hits;
+            return table->second;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto lut   = cc.GenerateLUTviaFunction(function->second, p);
+        m_generationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++m_generated;
+        return m_tables.emplace(key, std::move(lut)).first->second;
+    }
+
+    // Drops the tables; the registered functions and the counts stay.
+    void Clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tables.clear();
+    }
+
+    size_t NumTables() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_tables.size();
+    }
+    uint64_t Generated() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_generated;
+    }
+    uint64_t Hits() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hits;
+    }
+    // Total time spent in GenerateLUTviaFunction.
+    double GenerationSeconds() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_generationSeconds;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::map<std::string, LUTFunction> m_functions;
+    std::map<std::tuple<std::string, uint64_t, uint64_t>, std::vector<NativeInteger>> m_tables;
+    uint64_t m_generated       = 0;
+    uint64_t m_hits            = 0;
+    double m_generationSeconds = 0;
+};
+
+/*
+ * A family of distinct small functions, f_K(m) = m^(K % 4 + 1) + K mod p, standing in for
+ * the many different functions of a pipeline. Like the x^3 example, inputs at or above
+ * p are first shifted down by p/2.
+ */
+template <uint32_t K>
+NativeInteger PolynomialLUT(NativeInteger m, NativeInteger p) {
+    if (m >= p)
+        m -= p / 2;
+    return (m.ModExp(NativeInteger(K % 4 + 1), p) + NativeInteger(K)).Mod(p);
+}
+
+constexpr uint32_t kNumPolynomialLUTs = 64;
+
+inline std::string PolynomialLUTId(uint32_t k) {
+    return "poly" + std::to_string(k);
+}
+
+template <uint32_t... K>
+void RegisterPolynomialLUTs(LUTRegistry& registry, std::integer_sequence<uint32_t, K...>) {
+    (registry.Register(PolynomialLUTId(K), &PolynomialLUT<K>), ...);
+}
+
+// Registers poly0 ... poly63.
+inline void RegisterPolynomialLUTs(LUTRegistry& registry) {
+    RegisterPolynomialLUTs(registry, std::make_integer_sequence<uint32_t, kNumPolynomialLUTs>());
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CGGI_LUT_H
@@ -30,63 +30,185 @@
 //==================================================================================
 
 /*
-  Example for the FHEW scheme small precision arbitrary function evaluation
+  Example for the FHEW scheme small precision arbitrary function evaluation, as a
+  benchmark of the whole client/server round trip: Encrypt, EvalFunc (x^3 mod p) and
+  Decrypt.
+
+  FHEW_EVALFUNC_SEQUENTIAL is the original loop, one input after another through all
+  three steps. FHEW_EVALFUNC_PIPELINE runs the steps as stages of a pipeline
+  (common/pipeline.h) with bounded queues between them and their own worker threads, so
+  encryption and decryption of some inputs overlap the bootstrapping of others. Each
+  iteration streams `inputs` values through it, optionally at a fixed arrival rate.
  */
 
+#include "benchmark/benchmark.h"
 #include "binfhecontext.h"
+#include "cggi_common.h"
 
-using namespace lbcrypto;
-
-int main() {
-    // Sample Program: Step 1: Set CryptoContext
-    auto cc = BinFHEContext();
-    cc.GenerateBinFHEContext(STD128, true, 12);
-
-    // Sample Program: Step 2: Key Generation
-
-    // Generate the secret key
-    auto sk = cc.KeyGen();
-
-    std::cout << "Generating the bootstrapping keys..." << std::endl;
+#include "../common/energy.h"
+#include "../common/perf_counters.h"
+#include "../common/latency.h"
+#include "../common/memory.h"
+#include "../common/pipeline.h"
 
-    // Generate the bootstrapping keys (refresh and switching keys)
-    cc.BTKeyGen(sk);
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 
-    std::cout << "Completed the key generation." << std::endl;
-
-    // Sample Program: Step 3: Create the to-be-evaluated funciton and obtain its corresponding LUT
-    int p = cc.GetMaxPlaintextSpace().ConvertToInt();  // Obtain the maximum plaintext space
-
-    // Initialize Function f(x) = x^3 % p
-    auto fp = [](NativeInteger m, NativeInteger p1) -> NativeInteger {
-        if (m < p1)
-            return (m * m * m) % p1;
-        else
-            return ((m - p1 / 2) * (m - p1 / 2) * (m - p1 / 2)) % p1;
-    };
+using namespace lbcrypto;
 
-    // Generate LUT from function f(x)
-    auto lut = cc.GenerateLUTviaFunction(fp, p);
-    std::cout << "Evaluate x^3%" << p << "." << std::endl;
+// The context of the original example: STD128 for arbitrary functions, logQ = 12 (p = 8).
+constexpr uint32_t kEvalFuncLogQ = 12;
 
-    // Sample Program: Step 4: evalute f(x) homomorphically and decrypt
-    // Note that we check for all the possible plaintexts.
-    for (int i = 0; i < p; i++) {
-        auto start_time = std::chrono::high_resolution_clock::now();
+// Initialize Function f(x) = x^3 % p
+NativeInteger Cube(NativeInteger m, NativeInteger p1) {
+    if (m < p1)
+        return (m * m * m) % p1;
+    else
+        return ((m - p1 / 2) * (m - p1 / 2) * (m - p1 / 2)) % p1;
+}
 
-        auto ct1 = cc.Encrypt(sk, i % p, LARGE_DIM, p);
+struct EvalFuncSetup {
+    fhebench::FHEWKeys keys;
+    uint64_t p;
+    std::vector<NativeInteger> lut;
+};
+
+EvalFuncSetup& GetEvalFuncSetup() {
+    static EvalFuncSetup setup = [] {
+        EvalFuncSetup s;
+        // Bootstrapping keys come from the key store after the first run.
+        s.keys = fhebench::LoadOrGenerateFHEWKeys(STD128, GINX, kEvalFuncLogQ);
+        s.p    = s.keys.cc.GetMaxPlaintextSpace().ConvertToInt();  // Obtain the maximum plaintext space
+        // Generate LUT from function f(x)
+        s.lut = s.keys.cc.GenerateLUTviaFunction(Cube, s.p);
+        return s;
+    }();
+    return setup;
+}
 
-        auto ct_cube = cc.EvalFunc(ct1, lut);
+// Every input runs through all three steps before the next one starts; Ops is the
+// number of inputs per iteration, so the Throughput column reads inputs/second.
+static void FHEW_EVALFUNC_SEQUENTIAL(benchmark::State& state) {
+    EvalFuncSetup& setup = GetEvalFuncSetup();
+    BinFHEContext& cc    = setup.keys.cc;
+    const size_t inputs  = static_cast<size_t>(state.range(0));
+
+    uint64_t errors = 0;
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            for (size_t i = 0; i < inputs; i++) {
+                auto sample  = latency.Measure();
+                auto ct1     = cc.Encrypt(setup.keys.sk, i % setup.p, LARGE_DIM, setup.p);
+                auto ct_cube = cc.EvalFunc(ct1, setup.lut);
+                LWEPlaintext result;
+                cc.Decrypt(setup.keys.sk, ct_cube, &result, setup.p);
+                errors += static_cast<uint64_t>(result) != Cube(i % setup.p, setup.p).ConvertToInt();
+            }
+        }
+    }
+    state.counters["Ops"]    = static_cast<double>(inputs);
+    state.counters["Errors"] = static_cast<double>(errors);
+}
 
-        LWEPlaintext result;
+BENCHMARK(FHEW_EVALFUNC_SEQUENTIAL)->ArgNames({"inputs"})->Arg(64)->UseRealTime()->Unit(benchmark::kMillisecond);
 
-        cc.Decrypt(sk, ct_cube, &result, p);
+struct EvalFuncItem {
+    uint64_t input = 0;
+    LWECiphertext ct;
+    LWEPlaintext result = 0;
+};
 
-        auto end_time = std::chrono::high_resolution_clock::now();
+/*
+ * Arguments: inputs per iteration, workers for the Encrypt, EvalFunc and Decrypt stages,
+ * queue capacity, and arrival rate in inputs/second (0 for as fast as the pipeline
+ * accepts them). Lat_* are end-to-end latencies from arrival to decryption. Per stage
+ * <Stage>_p50/_p99 are service times, <Stage>_wait_p50/_p99 the time spent in the
+ * stage's input queue and <Stage>_blocked the time its workers waited on a full output
+ * queue, summed over the workers, per second of run time.
+ */
+static void FHEW_EVALFUNC_PIPELINE(benchmark::State& state) {
+    EvalFuncSetup& setup = GetEvalFuncSetup();
+    BinFHEContext& cc    = setup.keys.cc;
+    const size_t inputs  = static_cast<size_t>(state.range(0));
+    const double rate    = static_cast<double>(state.range(5));
+    std::atomic<uint64_t> errors{0};
+
+    fhebench::Pipeline<EvalFuncItem> pipeline(
+        {{"Encrypt", static_cast<size_t>(state.range(1)),
+          [&](EvalFuncItem& item) { item.ct = cc.Encrypt(setup.keys.sk, item.input, LARGE_DIM, setup.p); }},
+         {"EvalFunc", static_cast<size_t>(state.range(2)),
+          [&](EvalFuncItem& item) { item.ct = cc.EvalFunc(item.ct, setup.lut); }},
+         {"Decrypt", static_cast<size_t>(state.range(3)),
+          [&](EvalFuncItem& item) {
+              cc.Decrypt(setup.keys.sk, item.ct, &item.result, setup.p);
+              errors += static_cast<uint64_t>(item.result) != Cube(item.input, setup.p).ConvertToInt();
+          }}},
+        static_cast<size_t>(state.range(4)));
+
+    std::vector<fhebench::Pipeline<EvalFuncItem>::StageStats> stages;
+    double seconds = 0;
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            auto stats = pipeline.Run(
+                inputs,
+                [&](size_t i) {
+                    EvalFuncItem item;
+                    item.input = i % setup.p;
+                    return item;
+                },
+                rate);
+            latency.Merge(stats.endToEnd);
+            seconds += stats.seconds;
+            if (stages.empty()) {
+                stages = std::move(stats.stages);
+                continue;
+            }
+            for (size_t s = 0; s < stages.size(); ++s) {
+                stages[s].service.Merge(stats.stages[s].service);
+                stages[s].wait.Merge(stats.stages[s].wait);
+                stages[s].blockedSeconds += stats.stages[s].blockedSeconds;
+            }
+        }
+    }
 
-        long long duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-        std::cout << "Input: " << i << ". Expected: " << fp(i, p) << ". Evaluated = " << result << ". latency = " << duration <<  std::endl;
+    state.counters["Ops"] = static_cast<double>(inputs);
+    for (const auto& stage : stages) {
+        state.counters[stage.name + "_p50"]      = stage.service.Quantile(0.50) * 1e-9;
+        state.counters[stage.name + "_p99"]      = stage.service.Quantile(0.99) * 1e-9;
+        state.counters[stage.name + "_wait_p50"] = stage.wait.Quantile(0.50) * 1e-9;
+        state.counters[stage.name + "_wait_p99"] = stage.wait.Quantile(0.99) * 1e-9;
+        if (seconds > 0)
+            state.counters[stage.name + "_blocked"] = stage.blockedSeconds / seconds;
     }
+    state.counters["Errors"] = static_cast<double>(errors.load());
+}
 
-    return 0;
+// One worker per client stage; EvalFunc with one worker and with every hardware thread,
+// with short and long queues, flat out and at a fixed arrival rate.
+void PipelineArgs(benchmark::internal::Benchmark* b) {
+    const int64_t inputs  = 64;
+    const int64_t threads = fhebench::AvailableThreads();
+    for (int64_t evalWorkers : {int64_t(1), threads}) {
+        for (int64_t capacity : {2, 16})
+            b->Args({inputs, 1, evalWorkers, 1, capacity, 0});
+        b->Args({inputs, 1, evalWorkers, 1, 16, 10});
+        if (threads == 1)
+            break;
+    }
 }
+
+BENCHMARK(FHEW_EVALFUNC_PIPELINE)
+    ->ArgNames({"inputs", "enc", "eval", "dec", "queue", "rate"})
+    ->Apply(PipelineArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+FHEBENCH_MAIN();
@@ -31,168 +31,319 @@
 
 /*
 
-Example for CKKS bootstrapping with sparse packing
+Benchmark for CKKS bootstrapping with sparse packing
 
 */
 
 #define PROFILE
 
-#include "openfhe.h"
+#include "ckks_batch.h"
+#include "ckks_common.h"
+#include "ckks_packing.h"
+#include "ckks_phases.h"
+#include "ckks_tuner.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <ostream>
 
 using namespace lbcrypto;
 
-void BootstrapExample(uint32_t numSlots);
+/*
+ * Using a sparse plaintext and specifying the smaller number of slots gives a performance
+ * improvement (typically up to 3x). The level budget must be smaller than ceil(log2(slots)).
+ * We use HYBRID key switching with a digit size of 3 and let OpenFHE choose the
+ * baby-step-giant-step dimensions ({0, 0}).
+ */
+class AdvancedCKKSBootstrap : public fhebench::CKKSBootstrapFixture {
+protected:
+    void Configure(fhebench::CKKSBootstrapParams& params) const override {
+        params.numLargeDigits = 3;
+        params.bsgsDim        = {0, 0};
+    }
+};
+
+BENCHMARK_DEFINE_F(AdvancedCKKSBootstrap, EvalBootstrap)(benchmark::State& state) {
+    RunEvalBootstrap(state);
+}
+
+BENCHMARK_REGISTER_F(AdvancedCKKSBootstrap, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations"})
+    ->Args({12, 8, 3, 1})
+    ->Args({12, 16, 3, 1})
+    ->Args({12, 32, 3, 1})
+    ->Unit(benchmark::kMillisecond);
 
-int main(int argc, char* argv[]) {
-    // We run the example with 8 slots and ring dimension 4096 to illustrate how to run bootstrapping with a sparse plaintext.
-    // Using a sparse plaintext and specifying the smaller number of slots gives a performance improvement (typically up to 3x).
-    BootstrapExample(8);
+// The phase breakdown of the full-packing program, with sparse packing.
+BENCHMARK_DEFINE_F(AdvancedCKKSBootstrap, Phases)(benchmark::State& state) {
+    fhebench::RunBootstrapPhases(state, *m_setup);
 }
 
-void BootstrapExample(uint32_t numSlots) {
-    // Step 1: Set CryptoContext
-    CCParams<CryptoContextCKKSRNS> parameters;
-
-    // A. Specify main parameters
-    /*  A1) Secret key distribution
-    * The secret key distribution for CKKS should either be SPARSE_TERNARY or UNIFORM_TERNARY.
-    * The SPARSE_TERNARY distribution was used in the original CKKS paper,
-    * but in this example, we use UNIFORM_TERNARY because this is included in the homomorphic
-    * encryption standard.
-    */
-    SecretKeyDist secretKeyDist = UNIFORM_TERNARY;
-    parameters.SetSecretKeyDist(secretKeyDist);
-
-    /*  A2) Desired security level based on FHE standards.
-    * In this example, we use the "NotSet" option, so the example can run more quickly with
-    * a smaller ring dimension. Note that this should be used only in
-    * non-production environments, or by experts who understand the security
-    * implications of their choices. In production-like environments, we recommend using
-    * HEStd_128_classic, HEStd_192_classic, or HEStd_256_classic for 128-bit, 192-bit,
-    * or 256-bit security, respectively. If you choose one of these as your security level,
-    * you do not need to set the ring dimension.
-    */
-    parameters.SetSecurityLevel(HEStd_NotSet);
-    parameters.SetRingDim(1 << 12);
-
-    /*  A3) Key switching parameters.
-    * By default, we use HYBRID key switching with a digit size of 3.
-    * Choosing a larger digit size can reduce complexity, but the size of keys will increase.
-    * Note that you can leave these lines of code out completely, since these are the default values.
-    */
-    parameters.SetNumLargeDigits(3);
-    parameters.SetKeySwitchTechnique(HYBRID);
-
-    /*  A4) Scaling parameters.
-    * By default, we set the modulus sizes and rescaling technique to the following values
-    * to obtain a good precision and performance tradeoff. We recommend keeping the parameters
-    * below unless you are an FHE expert.
-    */
-#if NATIVEINT == 128 && !defined(__EMSCRIPTEN__)
-    // Currently, only FIXEDMANUAL and FIXEDAUTO modes are supported for 128-bit CKKS bootstrapping.
-    ScalingTechnique rescaleTech = FIXEDAUTO;
-    usint dcrtBits               = 78;
-    usint firstMod               = 89;
-#else
-    // All modes are supported for 64-bit CKKS bootstrapping.
-    ScalingTechnique rescaleTech = FLEXIBLEAUTO;
-    usint dcrtBits               = 59;
-    usint firstMod               = 60;
-#endif
-
-    parameters.SetScalingModSize(dcrtBits);
-    parameters.SetScalingTechnique(rescaleTech);
-    parameters.SetFirstModSize(firstMod);
-
-    /*  A4) Bootstrapping parameters.
-    * We set a budget for the number of levels we can consume in bootstrapping for encoding and decoding, respectively.
-    * Using larger numbers of levels reduces the complexity and number of rotation keys,
-    * but increases the depth required for bootstrapping.
-	* We must choose values smaller than ceil(log2(slots)). A level budget of {4, 4} is good for higher ring
-    * dimensions (65536 and higher).
-    */
-    std::vector<uint32_t> levelBudget = {3, 3};
-
-    /* We give the user the option of configuring values for an optimization algorithm in bootstrapping.
-    * Here, we specify the giant step for the baby-step-giant-step algorithm in linear transforms
-    * for encoding and decoding, respectively. Either choose this to be a power of 2
-    * or an exact divisor of the number of slots. Setting it to have the default value of {0, 0} allows OpenFHE to choose
-    * the values automatically.
-    */
-    std::vector<uint32_t> bsgsDim = {0, 0};
-
-    /*  A5) Multiplicative depth.
-    * The goal of bootstrapping is to increase the number of available levels we have, or in other words,
-    * to dynamically increase the multiplicative depth. However, the bootstrapping procedure itself
-    * needs to consume a few levels to run. We compute the number of bootstrapping levels required
-    * using GetBootstrapDepth, and add it to levelsAvailableAfterBootstrap to set our initial multiplicative
-    * depth.
-    */
-    uint32_t levelsAvailableAfterBootstrap = 10;
-    usint depth = levelsAvailableAfterBootstrap + FHECKKSRNS::GetBootstrapDepth(levelBudget, secretKeyDist);
-    parameters.SetMultiplicativeDepth(depth);
-
-    // Generate crypto context.
-    CryptoContext<DCRTPoly> cryptoContext = GenCryptoContext(parameters);
-
-    // Enable features that you wish to use. Note, we must enable FHE to use bootstrapping.
-    cryptoContext->Enable(PKE);
-    cryptoContext->Enable(KEYSWITCH);
-    cryptoContext->Enable(LEVELEDSHE);
-    cryptoContext->Enable(ADVANCEDSHE);
-    cryptoContext->Enable(FHE);
-
-    usint ringDim = cryptoContext->GetRingDimension();
-    std::cout << "CKKS scheme is using ring dimension " << ringDim << std::endl << std::endl;
-
-    // Step 2: Precomputations for bootstrapping
-    cryptoContext->EvalBootstrapSetup(levelBudget, bsgsDim, numSlots);
-
-    // Step 3: Key Generation
-    auto keyPair = cryptoContext->KeyGen();
-    cryptoContext->EvalMultKeyGen(keyPair.secretKey);
-    // Generate bootstrapping keys.
-    cryptoContext->EvalBootstrapKeyGen(keyPair.secretKey, numSlots);
-
-    // Step 4: Encoding and encryption of inputs
-    // Generate random input
-    std::vector<double> x;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-    for (size_t i = 0; i < numSlots; i++) {
-        x.push_back(dis(gen));
+BENCHMARK_REGISTER_F(AdvancedCKKSBootstrap, Phases)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations"})
+    ->ArgsProduct({{12}, {8}, {1, 2, 3}, {1}})
+    ->Unit(benchmark::kMillisecond);
+
+/*
+ * Instead of a hand-picked level budget, let the tuner (ckks_tuner.h) choose the level
+ * budget and baby-step-giant-step dimensions that bootstrap fastest while meeting a
+ * precision and depth target. Arguments: log2 of the ring dimension, number of slots,
+ * required precision in bits and required levels after bootstrapping. The first run
+ * of a target performs the search; later runs reuse the stored decision.
+ */
+class TunedCKKSBootstrap : public AdvancedCKKSBootstrap {
+public:
+    void SetUp(benchmark::State& state) override {
+        fhebench::CKKSTuneTarget target;
+        target.logRingDim              = static_cast<uint32_t>(state.range(0));
+        target.numSlots                = static_cast<uint32_t>(state.range(1));
+        target.minPrecisionBits        = static_cast<double>(state.range(2));
+        target.minLevelsAfterBootstrap = static_cast<uint32_t>(state.range(3));
+        target.numLargeDigits          = 3;
+        m_choice                       = fhebench::TuneCKKSBootstrap(target);
+        if (m_choice)
+            m_setup = fhebench::GetCKKSBootstrapSetup(m_choice->Params(target));
     }
 
-    // Encoding as plaintexts
-    // We specify the number of slots as numSlots to achieve a performance improvement.
-    // We use the other default values of depth 1, levels 0, and no params.
-    // Alternatively, you can also set batch size as a parameter in the CryptoContext as follows:
-    // parameters.SetBatchSize(numSlots);
-    // Here, we assume all ciphertexts in the cryptoContext will have numSlots slots.
-    // We start with a depleted ciphertext that has used up all of its levels.
-    Plaintext ptxt = cryptoContext->MakeCKKSPackedPlaintext(x, 1, depth - 1, nullptr, numSlots);
-    ptxt->SetLength(numSlots);
-    std::cout << "Input: " << ptxt << std::endl;
-
-    // Encrypt the encoded vectors
-    Ciphertext<DCRTPoly> ciph = cryptoContext->Encrypt(keyPair.publicKey, ptxt);
-
-    std::cout << "Initial number of levels remaining: " << depth - ciph->GetLevel() << std::endl;
-
-    // Step 5: Perform the bootstrapping operation. The goal is to increase the number of levels remaining
-    // for HE computation.
-    auto start_time =  std::chrono::system_clock::now();
-    auto ciphertextAfter = cryptoContext->EvalBootstrap(ciph);
-    auto end_time = std::chrono::system_clock::now();
-    long long duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-    std::cout << "Number of levels remaining after bootstrapping: " << depth - ciphertextAfter->GetLevel() << std::endl
-              << std::endl;
-    std::cout << "latency of the bootstrapping operation: " << duration << " microseconds" << std::endl;
-
-    // Step 7: Decryption and output
-    Plaintext result;
-    cryptoContext->Decrypt(keyPair.secretKey, ciphertextAfter, &result);
-    result->SetLength(numSlots);
-    std::cout << "Output after bootstrapping \n\t" << result << std::endl;
+protected:
+    std::optional<fhebench::CKKSTuneCandidate> m_choice;
+};
+
+BENCHMARK_DEFINE_F(TunedCKKSBootstrap, EvalBootstrap)(benchmark::State& state) {
+    if (!m_setup) {
+        state.SkipWithError("no level budget / bsgsDim configuration meets the target");
+        return;
+    }
+    RunEvalBootstrap(state);
+    state.counters["Budget_enc"] = m_choice->levelBudget[0];
+    state.counters["Budget_dec"] = m_choice->levelBudget[1];
+    state.counters["BSGS_enc"]   = m_choice->bsgsDim[0];
+    state.counters["BSGS_dec"]   = m_choice->bsgsDim[1];
+    state.counters["RotKey_MB"]  = m_choice->rotationKeyBytes / 1048576.0;
 }
+
+BENCHMARK_REGISTER_F(TunedCKKSBootstrap, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "minPrecision", "minLevels"})
+    ->Args({12, 8, 20, 10})
+    ->Args({12, 32, 20, 10})
+    ->Unit(benchmark::kMillisecond);
+
+/*
+ * A batch of independent bootstraps per iteration, with the cores split between
+ * concurrent bootstraps (workers) and OpenMP threads per bootstrap (ckks_batch.h).
+ * Arguments: the four above, then batch size, workers and OpenMP threads; workers = 0
+ * lets ChooseBatchSplit pick the split for the batch and core budget. The Throughput
+ * column reads ciphertexts/second, and the latency percentiles are those of a single
+ * bootstrap within the batch.
+ */
+class BatchCKKSBootstrap : public AdvancedCKKSBootstrap {};
+
+BENCHMARK_DEFINE_F(BatchCKKSBootstrap, EvalBootstrap)(benchmark::State& state) {
+    const size_t batchSize = static_cast<size_t>(state.range(4));
+    fhebench::BatchSplit split{static_cast<uint32_t>(state.range(5)), static_cast<uint32_t>(state.range(6))};
+    if (split.workers == 0)
+        split = fhebench::ChooseBatchSplit(*m_setup, batchSize, fhebench::AvailableCores()).split;
+    if (split.ompThreads > 1 && !fhebench::HaveOpenMP()) {
+        state.SkipWithError("built without OpenMP");
+        return;
+    }
+
+    fhebench::BatchBootstrapper batch(*m_setup, batchSize);
+    batch.SetSplit(split);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        std::mutex mutex;
+        for (auto _ : state) {
+            batch.Run([&](std::chrono::steady_clock::duration elapsed) {
+                std::lock_guard<std::mutex> lock(mutex);
+                latency.Record(elapsed);
+            });
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Ops makes the reporter's Throughput column read ciphertexts/second.
+    state.counters["Ops"]         = static_cast<double>(batchSize);
+    state.counters["Workers"]     = split.workers;
+    state.counters["OMP_threads"] = split.ompThreads;
+    state.counters["Ctxts_per_s"] = static_cast<double>(batchSize) * static_cast<double>(state.iterations()) / seconds;
+    state.counters["Precision"]   = m_setup->precisionBits;
+    state.counters["Levels"]      = m_setup->levelsAfterBootstrap;
+}
+
+// Every split of the core budget, then the automatic choice, for each configuration of
+// AdvancedCKKSBootstrap.
+void BatchSplitArgs(benchmark::internal::Benchmark* b) {
+    const int64_t batchSize = 16;
+    for (int64_t slots : {8, 16, 32}) {
+        for (const auto& split : fhebench::BatchSplits(fhebench::AvailableCores(), batchSize))
+            b->Args({12, slots, 3, 1, batchSize, split.workers, split.ompThreads});
+        b->Args({12, slots, 3, 1, batchSize, 0, 0});
+    }
+}
+
+BENCHMARK_REGISTER_F(BatchCKKSBootstrap, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations", "batch", "workers", "omp"})
+    ->Apply(BatchSplitArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+/*
+ * Many short vectors: V vectors of `slots` slots each, bootstrapped one sparse ciphertext
+ * at a time (Separate) or packed into one ciphertext of `packed` slots, bootstrapped once
+ * and unpacked into V ciphertexts again (Packed, ckks_packing.h). In both, Slots counts the
+ * useful slots of one iteration, so the Throughput column reads useful slots/second, and
+ * Per_slot is the time per useful slot. The packed runs also split their time into
+ * Pack_ms, Bootstrap_ms and Unpack_ms; Precision is that of the worst vector.
+ */
+struct PackingComparison {
+    fhebench::CKKSBootstrapParams separate;
+    fhebench::LatencyHistogram packed;
+    uint32_t vectors = 0;
+};
+
+// By vector slots.
+static std::map<uint32_t, PackingComparison>& PackingResults() {
+    static std::map<uint32_t, PackingComparison> results;
+    return results;
+}
+
+static void PublishUsefulSlots(benchmark::State& state, uint32_t slots) {
+    state.counters["Slots"] = slots;
+    state.counters["Per_slot"] =
+        benchmark::Counter(slots, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+class SeparateCKKSBootstrap : public AdvancedCKKSBootstrap {};
+
+BENCHMARK_DEFINE_F(SeparateCKKSBootstrap, EvalBootstrap)(benchmark::State& state) {
+    RunEvalBootstrap(state);
+    PublishUsefulSlots(state, m_setup->numSlots);
+    PackingResults()[m_setup->numSlots].separate = m_setup->params;
+}
+
+class PackedCKKSBootstrap : public AdvancedCKKSBootstrap {
+public:
+    void SetUp(benchmark::State& state) override {
+        fhebench::CKKSBootstrapParams params = ParamsFromArgs(state);
+        params.numSlots                      = static_cast<uint32_t>(state.range(4));
+        Configure(params);
+        m_packing = fhebench::GetSparsePackingSetup(params, static_cast<uint32_t>(state.range(1)));
+    }
+
+    void TearDown(benchmark::State& state) override {
+        m_packing.reset();
+        AdvancedCKKSBootstrap::TearDown(state);
+    }
+
+protected:
+    std::shared_ptr<fhebench::SparsePackingSetup> m_packing;
+};
+
+BENCHMARK_DEFINE_F(PackedCKKSBootstrap, EvalBootstrap)(benchmark::State& state) {
+    using Clock = std::chrono::steady_clock;
+
+    const fhebench::SparsePackingSetup& packing = *m_packing;
+    const fhebench::CKKSBootstrapSetup& setup   = *packing.base;
+    Clock::duration pack{}, bootstrap{}, unpack{};
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::FrequencyCounters frequency(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            auto sample   = latency.Measure();
+            auto start    = Clock::now();
+            auto packed   = packing.packer->Pack(packing.inputs);
+            auto packedAt = Clock::now();
+            auto refreshed =
+                setup.cryptoContext->EvalBootstrap(packed, setup.params.numIterations, setup.iterationPrecision);
+            auto refreshedAt = Clock::now();
+            auto outputs     = packing.packer->UnpackAll(refreshed);
+            benchmark::DoNotOptimize(outputs);
+            pack += packedAt - start;
+            bootstrap += refreshedAt - packedAt;
+            unpack += Clock::now() - refreshedAt;
+        }
+        PackingComparison& result = PackingResults()[packing.packer->VectorSlots()];
+        result.packed.Merge(latency.Histogram());
+        result.vectors = packing.packer->NumVectors();
+    }
+
+    const double iterations = static_cast<double>(state.iterations());
+    auto perIteration = [&](Clock::duration elapsed) {
+        return std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+    };
+
+    PublishUsefulSlots(state, packing.packer->PackedSlots());
+    state.counters["Vectors"]      = packing.packer->NumVectors();
+    state.counters["Pack_ms"]      = perIteration(pack);
+    state.counters["Bootstrap_ms"] = perIteration(bootstrap);
+    state.counters["Unpack_ms"]    = perIteration(unpack);
+    state.counters["Precision"]    = packing.precisionBits;
+    state.counters["Levels"]       = packing.levelsAfterUnpack;
+}
+
+// 8, 16, ..., 2048 slots per vector; the packed runs fill all N/2 = 2048 slots of logN 12.
+static void SeparateSlotArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t slots = 8; slots <= 2048; slots *= 2)
+        b->Args({12, slots, 3, 1});
+}
+
+static void PackedSlotArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t slots = 8; slots <= 2048; slots *= 2)
+        b->Args({12, slots, 3, 1, 2048});
+}
+
+BENCHMARK_REGISTER_F(SeparateCKKSBootstrap, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations"})
+    ->Apply(SeparateSlotArgs)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_REGISTER_F(PackedCKKSBootstrap, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations", "packed"})
+    ->Apply(PackedSlotArgs)
+    ->Unit(benchmark::kMillisecond);
+
+/*
+ * Per vector size, the p50 time per useful slot of both methods: one bootstrap over its s
+ * slots when bootstrapping separately, one pack, bootstrap and unpack over V * s slots
+ * when packed.
+ */
+static void PrintPackingComparison(std::ostream& out) {
+    const auto& results = PackingResults();
+    if (results.empty())
+        return;
+
+    out << "\nShort vectors bootstrapped separately or packed into one ciphertext (p50 per useful slot):\n";
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %8s %8s %13s %13s %13s %13s %8s\n", "slots", "vectors", "separate_ms",
+                  "sep_us/slot", "packed_ms", "pack_us/slot", "speedup");
+    out << line;
+    for (const auto& entry : results) {
+        const uint32_t slots = entry.first;
+        double separateNs    = NAN;
+        for (const auto& result : fhebench::CKKSBootstrapResults()) {
+            if (result.params.Key() == entry.second.separate.Key())
+                separateNs = static_cast<double>(result.latency.Quantile(0.5));
+        }
+        const double packedNs     = entry.second.vectors ? static_cast<double>(entry.second.packed.Quantile(0.5)) : NAN;
+        const double packedSlots  = static_cast<double>(slots) * entry.second.vectors;
+        const double separateSlot = separateNs / slots;
+        const double packedSlot   = packedNs / packedSlots;
+        std::snprintf(line, sizeof(line), "  %8u %8u %13.3f %13.4f %13.3f %13.4f %8.2f\n", slots,
+                      entry.second.vectors, separateNs * 1e-6, separateSlot * 1e-3, packedNs * 1e-6,
+                      packedSlot * 1e-3, separateSlot / packedSlot);
+        out << line;
+    }
+}
+
+static const bool g_packingComparisonRegistered = fhebench::AddEpilogue(PrintPackingComparison);
+
+FHEBENCH_MAIN();
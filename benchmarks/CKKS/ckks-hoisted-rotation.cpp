@@ -0,0 +1,129 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+
+k rotations of one ciphertext by distinct amounts: k independent EvalRotate calls against
+hoisted rotation, where EvalFastRotationPrecompute decomposes the ciphertext for key
+switching once and EvalFastRotation applies each rotation to the shared digits. The
+arguments are logN/indices/k/hoisted: log2 of the ring dimension, the rotation amounts
+(0: 1..k, 1: spread over the slots), the number of rotations and the method. The context
+is leveled at depth 10 with full packing (ckks_common.h). See common/rotations.h for the
+counters and the break-even table printed after the run.
+
+*/
+
+#define PROFILE
+
+#include "ckks_common.h"
+#include "../common/rotations.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace lbcrypto;
+
+static const std::vector<int64_t> kRotationCounts = {1, 2, 4, 8, 16, 32};
+
+static void CKKS_ROTATIONS(benchmark::State& state) {
+    const int indexSet = static_cast<int>(state.range(1));
+    const size_t k     = static_cast<size_t>(state.range(2));
+    const bool hoisted = state.range(3) != 0;
+
+    // One set of rotation keys serves every k of an index set.
+    fhebench::CKKSLeveledParams params;
+    params.logRingDim  = static_cast<uint32_t>(state.range(0));
+    params.depth       = 10;
+    const size_t slots = size_t(1) << (params.logRingDim - 1);
+    std::set<int32_t> keyIndices;
+    for (int64_t count : kRotationCounts) {
+        for (int32_t index : fhebench::RotationIndices(indexSet, count, slots))
+            keyIndices.insert(index);
+    }
+    params.rotations.assign(keyIndices.begin(), keyIndices.end());
+    auto setup = fhebench::GetCKKSLeveledSetup(params);
+
+    const CryptoContext<DCRTPoly>& cc  = setup->cryptoContext;
+    const std::vector<int32_t> indices = fhebench::RotationIndices(indexSet, k, slots);
+    const usint m                      = cc->GetCyclotomicOrder();
+
+    double digitsMB = 0;
+    if (hoisted) {
+        const int64_t liveBefore = fhebench::g_allocationCounters.liveBytes.load(std::memory_order_relaxed);
+        auto digits              = cc->EvalFastRotationPrecompute(setup->ciph);
+        digitsMB =
+            (fhebench::g_allocationCounters.liveBytes.load(std::memory_order_relaxed) - liveBefore) / 1048576.0;
+    }
+
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::FrequencyCounters frequency(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            auto sample = latency.Measure();
+            if (hoisted) {
+                auto digits = cc->EvalFastRotationPrecompute(setup->ciph);
+                for (int32_t index : indices) {
+                    auto rotated = cc->EvalFastRotation(setup->ciph, index, m, digits);
+                    benchmark::DoNotOptimize(rotated);
+                }
+            }
+            else {
+                for (int32_t index : indices) {
+                    auto rotated = cc->EvalRotate(setup->ciph, index);
+                    benchmark::DoNotOptimize(rotated);
+                }
+            }
+        }
+        fhebench::RecordRotations("CKKS logN:" + std::to_string(params.logRingDim) +
+                                      " indices:" + std::to_string(indexSet),
+                                  hoisted, static_cast<int64_t>(k), latency.Histogram(), digitsMB);
+    }
+    fhebench::PublishRotationCounters(state, k, digitsMB);
+}
+
+// Ring dimension and index set outermost, so that each set of keys is generated once.
+static void RotationArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t logN : {13, 14})
+        for (int64_t indexSet : {0, 1})
+            for (int64_t k : kRotationCounts)
+                for (int64_t hoisted : {0, 1})
+                    b->Args({logN, indexSet, k, hoisted});
+}
+
+BENCHMARK(CKKS_ROTATIONS)
+    ->ArgNames({"logN", "indices", "k", "hoisted"})
+    ->Apply(RotationArgs)
+    ->Unit(benchmark::kMillisecond);
+
+FHEBENCH_MAIN();
@@ -0,0 +1,261 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+
+Cost of the CKKS operations as a function of the ring dimension N = 2^12 .. 2^17, at
+fixed multiplicative depth: Encrypt, EvalMult (with relinearization), EvalRotate and
+EvalBootstrap. Every (operation, depth) pair is one benchmark family over logN, and
+Google Benchmark fits it to O(N log N), printing the coefficient (time per N*lgN) and
+the RMS of the fit after the family.
+
+The contexts use HEStd_NotSet so that every depth runs at every ring dimension. After
+the run, each family's fit is evaluated at the smallest ring dimension that the HE
+standard deems 128-bit secure for its modulus QP, which is the cost at the same depth
+in a production setting. Bootstrapping uses 8 slots: at full packing its rotation keys
+alone outgrow the memory of a desktop at N = 2^16. FHEBENCH_MAX_LOGN lowers the top of
+the sweep.
+
+*/
+
+#define PROFILE
+
+#include "ckks_common.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace lbcrypto;
+
+static constexpr uint32_t kMinLogRingDim = 12;
+
+static uint32_t MaxLogRingDim() {
+    const char* env = std::getenv("FHEBENCH_MAX_LOGN");
+    if (env != nullptr && std::atoi(env) >= static_cast<int>(kMinLogRingDim) + 1)
+        return static_cast<uint32_t>(std::min(std::atoi(env), 17));
+    return 17;
+}
+
+// The p50 latencies of one family per ring dimension, for the extrapolation after the run.
+struct ScalingSeries {
+    std::string family;
+    uint32_t logQP = 0;
+    std::vector<std::pair<uint32_t, fhebench::LatencyHistogram>> latency;
+};
+
+static std::vector<ScalingSeries>& ScalingResults() {
+    static std::vector<ScalingSeries> results;
+    return results;
+}
+
+static void RecordScalingResult(const std::string& family, uint32_t logRingDim, uint32_t logQP,
+                                const fhebench::LatencyHistogram& latency) {
+    auto& results = ScalingResults();
+    auto series   = std::find_if(results.begin(), results.end(),
+                                 [&](const ScalingSeries& candidate) { return candidate.family == family; });
+    if (series == results.end())
+        series = results.insert(results.end(), {family, logQP, {}});
+    for (auto& entry : series->latency) {
+        if (entry.first == logRingDim) {
+            entry.second.Merge(latency);
+            return;
+        }
+    }
+    series->latency.emplace_back(logRingDim, latency);
+}
+
+typedef Ciphertext<DCRTPoly> (*LeveledOperation)(const fhebench::CKKSLeveledSetup&);
+
+struct LeveledBenchmark {
+    const char* name;
+    LeveledOperation operation;
+};
+
+static const LeveledBenchmark kLeveledBenchmarks[] = {
+    {"ENCRYPT",
+     [](const fhebench::CKKSLeveledSetup& setup) {
+         return setup.cryptoContext->Encrypt(setup.keyPair.publicKey, setup.ptxt);
+     }},
+    {"MULT",
+     [](const fhebench::CKKSLeveledSetup& setup) { return setup.cryptoContext->EvalMult(setup.ciph, setup.ciph); }},
+    {"ROTATE",
+     [](const fhebench::CKKSLeveledSetup& setup) { return setup.cryptoContext->EvalRotate(setup.ciph, 1); }},
+};
+
+static void CKKS_SCALING_LEVELED(benchmark::State& state, const std::string& family, LeveledOperation operation,
+                                 uint32_t depth) {
+    fhebench::CKKSLeveledParams params;
+    params.logRingDim    = static_cast<uint32_t>(state.range(0));
+    params.depth         = depth;
+    auto setup           = fhebench::GetCKKSLeveledSetup(params);
+    const uint32_t logQP = fhebench::CKKSLogQP(setup->cryptoContext);
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::FrequencyCounters frequency(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            auto sample                 = latency.Measure();
+            Ciphertext<DCRTPoly> result = operation(*setup);
+            benchmark::DoNotOptimize(result);
+        }
+        RecordScalingResult(family, params.logRingDim, logQP, latency.Histogram());
+    }
+    state.SetComplexityN(int64_t(1) << params.logRingDim);
+    state.counters["Slots"] = setup->numSlots;
+    state.counters["LogQP"] = logQP;
+}
+
+static void CKKS_SCALING_BOOTSTRAP(benchmark::State& state, const std::string& family, uint32_t levelsAfter) {
+    fhebench::CKKSBootstrapParams params;
+    params.logRingDim                    = static_cast<uint32_t>(state.range(0));
+    params.numSlots                      = 8;
+    params.levelBudget                   = {3, 3};
+    params.levelsAvailableAfterBootstrap = levelsAfter;
+    auto setup                           = fhebench::GetCKKSBootstrapSetup(params);
+    const uint32_t logQP                 = fhebench::CKKSLogQP(setup->cryptoContext);
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::FrequencyCounters frequency(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            auto sample          = latency.Measure();
+            auto ciphertextAfter = setup->cryptoContext->EvalBootstrap(setup->ciph);
+            benchmark::DoNotOptimize(ciphertextAfter);
+        }
+        RecordScalingResult(family, params.logRingDim, logQP, latency.Histogram());
+    }
+    state.SetComplexityN(int64_t(1) << params.logRingDim);
+    state.counters["Slots"]     = setup->numSlots;
+    state.counters["Precision"] = setup->precisionBits;
+    state.counters["Levels"]    = setup->levelsAfterBootstrap;
+    state.counters["LogQP"]     = logQP;
+}
+
+// One family per operation and depth, so that each is fitted over the ring dimension alone.
+static bool RegisterScalingBenchmarks() {
+    const int maxLogRingDim = static_cast<int>(MaxLogRingDim());
+    for (uint32_t depth : {2u, 10u, 20u}) {
+        for (const auto& leveled : kLeveledBenchmarks) {
+            const std::string family = std::string("CKKS_SCALING_") + leveled.name + "/depth:" + std::to_string(depth);
+            benchmark::RegisterBenchmark(family.c_str(),
+                                         [=](benchmark::State& state) {
+                                             CKKS_SCALING_LEVELED(state, family, leveled.operation, depth);
+                                         })
+                ->ArgName("logN")
+                ->DenseRange(kMinLogRingDim, maxLogRingDim)
+                ->Complexity(benchmark::oNLogN)
+                ->Unit(benchmark::kMicrosecond);
+        }
+    }
+    for (uint32_t levelsAfter : {2u, 10u}) {
+        const std::string family = "CKKS_SCALING_BOOTSTRAP/levelsAfter:" + std::to_string(levelsAfter);
+        benchmark::RegisterBenchmark(family.c_str(),
+                                     [=](benchmark::State& state) {
+                                         CKKS_SCALING_BOOTSTRAP(state, family, levelsAfter);
+                                     })
+            ->ArgName("logN")
+            ->DenseRange(kMinLogRingDim, maxLogRingDim)
+            ->Complexity(benchmark::oNLogN)
+            ->Unit(benchmark::kMillisecond);
+    }
+    return true;
+}
+
+static const bool g_scalingRegistered = RegisterScalingBenchmarks();
+
+/*
+ * Fits each family's p50 latencies to c*N*log2(N), the model Google Benchmark fits to the
+ * means, and prints its cost at the 128-bit secure ring dimension of its modulus: the
+ * measured p50 when that dimension was swept, the fitted value (marked '*') otherwise.
+ */
+static void PrintSecureExtrapolation(std::ostream& out) {
+    const auto& results = ScalingResults();
+    if (results.empty())
+        return;
+
+    out << "\nCost at the smallest 128-bit secure ring dimension (HE standard, ternary secrets) for each modulus\n"
+        << "(* = extrapolated from the fit of the p50 latencies to c*N*log2(N)):\n";
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-38s %6s %11s %12s %8s %12s\n", "family", "logQP", "secure_logN",
+                  "c_ns/NlgN", "rms_pct", "p50_ms");
+    out << line;
+    for (const auto& series : results) {
+        double sumTF = 0, sumFF = 0, sumT = 0;
+        for (const auto& entry : series.latency) {
+            const double n = std::ldexp(1.0, static_cast<int>(entry.first));
+            const double f = n * entry.first;
+            const double t = static_cast<double>(entry.second.Quantile(0.5));
+            sumTF += t * f;
+            sumFF += f * f;
+            sumT += t;
+        }
+        const double coefficient = sumTF / sumFF;
+        double sumSquares        = 0;
+        for (const auto& entry : series.latency) {
+            const double f = std::ldexp(1.0, static_cast<int>(entry.first)) * entry.first;
+            const double t = static_cast<double>(entry.second.Quantile(0.5));
+            sumSquares += (t - coefficient * f) * (t - coefficient * f);
+        }
+        const double count = static_cast<double>(series.latency.size());
+        const double rms   = std::sqrt(sumSquares / count) / (sumT / count);
+
+        const uint32_t secureLogRingDim = fhebench::SecureLogRingDim(series.logQP);
+        if (secureLogRingDim == 0) {
+            std::snprintf(line, sizeof(line), "  %-38s %6u %11s %12.4g %8.1f %12s\n", series.family.c_str(),
+                          series.logQP, "> table", coefficient, rms * 100, "n/a");
+            out << line;
+            continue;
+        }
+        double p50Ns      = coefficient * std::ldexp(1.0, static_cast<int>(secureLogRingDim)) * secureLogRingDim;
+        bool extrapolated = true;
+        for (const auto& entry : series.latency) {
+            if (entry.first == secureLogRingDim) {
+                p50Ns        = static_cast<double>(entry.second.Quantile(0.5));
+                extrapolated = false;
+            }
+        }
+        std::snprintf(line, sizeof(line), "  %-38s %6u %11u %12.4g %8.1f %11.3f%c\n", series.family.c_str(),
+                      series.logQP, secureLogRingDim, coefficient, rms * 100, p50Ns * 1e-6,
+                      extrapolated ? '*' : ' ');
+        out << line;
+    }
+}
+
+static const bool g_extrapolationRegistered = fhebench::AddEpilogue(PrintSecureExtrapolation);
+
+FHEBENCH_MAIN();
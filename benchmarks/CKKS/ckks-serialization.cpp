@@ -0,0 +1,150 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+
+Serialization and deserialization of the CKKS objects that are shipped between client
+and server: ciphertexts (public-key and secret-key encryptions at full level, and a
+bootstrapped ciphertext) and the rotation keys generated by EvalBootstrapKeyGen, in
+OpenFHE's binary and JSON formats, optionally compressed. See common/serialization.h for
+the counters.
+
+*/
+
+#define PROFILE
+
+#include "ckks_common.h"
+#include "../common/openfhe_serialization.h"
+
+#include <map>
+
+using namespace lbcrypto;
+
+enum class CKKSObject { PublicKeyCiphertext, SecretKeyCiphertext, BootstrappedCiphertext, RotationKeys };
+
+// The sparse configuration of advanced-ckks-bootstrapping: N = 2^12, 8 slots, level budget 3.
+static const fhebench::CKKSBootstrapSetup& SerializationSetup() {
+    static std::shared_ptr<fhebench::CKKSBootstrapSetup> setup = [] {
+        fhebench::CKKSBootstrapParams params;
+        params.logRingDim     = 12;
+        params.numSlots       = 8;
+        params.levelBudget    = {3, 3};
+        params.numLargeDigits = 3;
+        return fhebench::GetCKKSBootstrapSetup(params);
+    }();
+    return *setup;
+}
+
+template <typename ST>
+static fhebench::SerializedObject MakeCKKSObject(CKKSObject kind, const ST& sertype) {
+    const fhebench::CKKSBootstrapSetup& setup = SerializationSetup();
+    CryptoContext<DCRTPoly> cryptoContext     = setup.cryptoContext;
+
+    if (kind == CKKSObject::RotationKeys) {
+        // A copy of the key map; the keys themselves are shared.
+        const std::map<uint32_t, EvalKey<DCRTPoly>> keys =
+            CryptoContextImpl<DCRTPoly>::GetEvalAutomorphismKeyMap(setup.keyPair.secretKey->GetKeyTag());
+        fhebench::SerializedObject serialized = fhebench::Serialized(keys, sertype);
+        // Every hybrid key-switching key has one uniform `a` polynomial per digit.
+        for (const auto& key : keys) {
+            serialized.uniformBytes += fhebench::SerializedBytes(key.second->GetAVector(), sertype);
+            serialized.numSeeds++;
+        }
+        return serialized;
+    }
+
+    std::vector<double> x(setup.numSlots);
+    for (size_t i = 0; i < x.size(); ++i)
+        x[i] = static_cast<double>(i) / x.size();
+    Plaintext ptxt = cryptoContext->MakeCKKSPackedPlaintext(x, 1, 0, nullptr, setup.numSlots);
+
+    Ciphertext<DCRTPoly> ciphertext;
+    switch (kind) {
+        case CKKSObject::PublicKeyCiphertext:
+            ciphertext = cryptoContext->Encrypt(setup.keyPair.publicKey, ptxt);
+            break;
+        case CKKSObject::SecretKeyCiphertext:
+            ciphertext = cryptoContext->Encrypt(setup.keyPair.secretKey, ptxt);
+            break;
+        default:
+            ciphertext = cryptoContext->EvalBootstrap(setup.ciph, setup.params.numIterations, setup.iterationPrecision);
+            break;
+    }
+    fhebench::SerializedObject serialized = fhebench::Serialized(ciphertext, sertype);
+    // Only the second component of a secret-key encryption is uniform.
+    if (kind == CKKSObject::SecretKeyCiphertext) {
+        serialized.uniformBytes = fhebench::SerializedBytes(ciphertext->GetElements()[1], sertype);
+        serialized.numSeeds     = 1;
+    }
+    return serialized;
+}
+
+static fhebench::SerializedObject MakeCKKSObject(CKKSObject kind, bool json) {
+    return json ? MakeCKKSObject(kind, SerType::JSON) : MakeCKKSObject(kind, SerType::BINARY);
+}
+
+static void CKKS_SERIALIZE(benchmark::State& state, CKKSObject kind) {
+    fhebench::RunSerialization(state, MakeCKKSObject(kind, state.range(0) != 0), false,
+                               static_cast<int>(state.range(1)));
+}
+
+static void CKKS_DESERIALIZE(benchmark::State& state, CKKSObject kind) {
+    fhebench::RunSerialization(state, MakeCKKSObject(kind, state.range(0) != 0), true,
+                               static_cast<int>(state.range(1)));
+}
+
+BENCHMARK_CAPTURE(CKKS_SERIALIZE, Ciphertext, CKKSObject::PublicKeyCiphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CKKS_SERIALIZE, SecretKeyCiphertext, CKKSObject::SecretKeyCiphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CKKS_SERIALIZE, BootstrappedCiphertext, CKKSObject::BootstrappedCiphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CKKS_SERIALIZE, RotationKeys, CKKSObject::RotationKeys)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(CKKS_DESERIALIZE, Ciphertext, CKKSObject::PublicKeyCiphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CKKS_DESERIALIZE, SecretKeyCiphertext, CKKSObject::SecretKeyCiphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CKKS_DESERIALIZE, BootstrappedCiphertext, CKKSObject::BootstrappedCiphertext)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(CKKS_DESERIALIZE, RotationKeys, CKKSObject::RotationKeys)
+    ->Apply(fhebench::SerializationArgs)
+    ->Unit(benchmark::kMillisecond);
+
+FHEBENCH_MAIN();
@@ -0,0 +1,208 @@
+/*
+  Batched CKKS bootstrapping with the cores split between concurrent bootstraps and
+  OpenMP threads inside each bootstrap.
+
+  OpenFHE parallelizes one EvalBootstrap over the RNS limbs with OpenMP, which stops
+  scaling well before the core count of a large machine. A batch of independent
+  ciphertexts can instead be bootstrapped several at a time. A BatchSplit of W x T runs W
+  bootstraps concurrently on a work-stealing pool (common/thread_pool.h), each with T
+  OpenMP threads: omp_set_num_threads only affects the calling thread, so every pool
+  worker sets it for the parallel regions it starts. W x T is the core budget, e.g.
+  1x16, 4x4 or 16x1 on 16 cores.
+
+  ChooseBatchSplit measures every split of a core budget on the batch and returns the
+  one with the highest ciphertext throughput, preferring the lower p99 bootstrap latency
+  among near-ties.
+ */
+
+#ifndef FHEBENCH_CKKS_BATCH_H
+#define FHEBENCH_CKKS_BATCH_H
+
+#include "ckks_common.h"
+#include "../common/thread_pool.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace fhebench {
+
+struct BatchSplit {
+    uint32_t workers    = 1;
+    uint32_t ompThreads = 1;
+};
+
+// Core budget: FHEBENCH_CORES if set, otherwise the hardware threads (of the
+// FHEBENCH_AFFINITY policy, if one is set).
+inline uint32_t AvailableCores() {
+    const char* cores = std::getenv("FHEBENCH_CORES");
+    if (cores != nullptr && std::atoi(cores) > 0)
+        return static_cast<uint32_t>(std::atoi(cores));
+    return AvailableThreads();
+}
+
+inline bool HaveOpenMP() {
+#ifdef _OPENMP
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Every W x T == cores with W <= batchSize (more workers than ciphertexts only idle).
+// Without OpenMP only T == 1 is possible.
+inline std::vector<BatchSplit> BatchSplits(uint32_t cores, size_t batchSize) {
+    std::vector<BatchSplit> splits;
+    for (uint32_t workers = 1; workers <= cores; ++workers) {
+        if (cores % workers != 0 || workers > batchSize)
+            continue;
+        if (!HaveOpenMP() && cores / workers > 1)
+            continue;
+        splits.push_back({workers, cores / workers});
+    }
+    if (splits.empty())
+        splits.push_back({std::min<uint32_t>(cores, static_cast<uint32_t>(batchSize)), 1});
+    return splits;
+}
+
+/*
+ * Bootstraps a batch of freshly encrypted, depleted ciphertexts. The setup's context and
+ * keys are shared by all workers; EvalBootstrap only reads them.
+ */
+class BatchBootstrapper {
+public:
+    BatchBootstrapper(const CKKSBootstrapSetup& setup, size_t batchSize)
+        : m_setup(setup), m_outputs(batchSize) {
+        for (size_t i = 0; i < batchSize; ++i)
+            m_inputs.push_back(setup.cryptoContext->Encrypt(setup.keyPair.publicKey, setup.ptxt));
+#ifdef _OPENMP
+        m_defaultThreads = omp_get_max_threads();
+#endif
+    }
+
+    ~BatchBootstrapper() {
+#ifdef _OPENMP
+        omp_set_num_threads(m_defaultThreads);
+#endif
+    }
+
+    BatchBootstrapper(const BatchBootstrapper&)            = delete;
+    BatchBootstrapper& operator=(const BatchBootstrapper&) = delete;
+
+    void SetSplit(const BatchSplit& split) {
+        m_split = split;
+        if (!m_pool || m_pool->Size() != split.workers)
+            m_pool = std::make_unique<WorkStealingPool>(split.workers);
+    }
+
+    const BatchSplit& Split() const {
+        return m_split;
+    }
+
+    size_t Size() const {
+        return m_inputs.size();
+    }
+
+    // Bootstraps every ciphertext once; record receives the duration of each bootstrap
+    // and may be called from several threads at once.
+    void Run(const std::function<void(std::chrono::steady_clock::duration)>& record) {
+        const int ompThreads = static_cast<int>(m_split.ompThreads);
+        m_pool->ParallelFor(m_inputs.size(), [&](size_t i) {
+#ifdef _OPENMP
+            omp_set_num_threads(ompThreads);
+#else
+            (void)ompThreads;
+#endif
+            auto start = std::chrono::steady_clock::now();
+            m_outputs[i] =
+                m_setup.cryptoContext->EvalBootstrap(m_inputs[i], m_setup.params.numIterations, m_setup.iterationPrecision);
+            record(std::chrono::steady_clock::now() - start);
+        });
+    }
+
+private:
+    const CKKSBootstrapSetup& m_setup;
+    std::vector<Ciphertext<DCRTPoly>> m_inputs;
+    std::vector<Ciphertext<DCRTPoly>> m_outputs;
+    BatchSplit m_split;
+    std::unique_ptr<WorkStealingPool> m_pool;
+    int m_defaultThreads = 1;
+};
+
+struct BatchSplitResult {
+    BatchSplit split;
+    double ciphertextsPerSecond = 0;
+    double p99Seconds           = 0;
+};
+
+// Splits within this fraction of the best throughput count as tied with it.
+constexpr double kBatchThroughputTolerance = 0.03;
+
+/*
+ * Measures every split of cores on batchSize ciphertexts (one warm-up batch and `rounds`
+ * timed ones each) and returns the fastest. Decisions are remembered per parameter set,
+ * batch size and core budget for the rest of the process.
+ */
+inline BatchSplitResult ChooseBatchSplit(const CKKSBootstrapSetup& setup, size_t batchSize, uint32_t cores,
+                                         uint32_t rounds = 2) {
+    static std::mutex mutex;
+    static std::map<std::tuple<decltype(setup.params.Key()), size_t, uint32_t>, BatchSplitResult> decisions;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto key   = std::make_tuple(setup.params.Key(), batchSize, cores);
+    auto known = decisions.find(key);
+    if (known != decisions.end())
+        return known->second;
+
+    BatchBootstrapper batch(setup, batchSize);
+    BatchSplitResult best;
+    for (const BatchSplit& split : BatchSplits(cores, batchSize)) {
+        batch.SetSplit(split);
+        batch.Run([](std::chrono::steady_clock::duration) {});
+
+        LatencyHistogram latency;
+        std::mutex latencyMutex;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t r = 0; r < rounds; ++r) {
+            batch.Run([&](std::chrono::steady_clock::duration elapsed) {
+                std::lock_guard<std::mutex> guard(latencyMutex);
+                latency.Record(
+                    static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            });
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        BatchSplitResult result;
+        result.split                = split;
+        result.ciphertextsPerSecond = static_cast<double>(batchSize * rounds) / seconds;
+        result.p99Seconds           = latency.Quantile(0.99) * 1e-9;
+        std::fprintf(stderr, "batch split %ux%u (batch %zu): %.2f ciphertexts/s, p99 %.3f ms\n", split.workers,
+                     split.ompThreads, batchSize, result.ciphertextsPerSecond, result.p99Seconds * 1e3);
+
+        bool faster = result.ciphertextsPerSecond > best.ciphertextsPerSecond * (1 + kBatchThroughputTolerance);
+        bool tied   = result.ciphertextsPerSecond >= best.ciphertextsPerSecond * (1 - kBatchThroughputTolerance);
+        if (best.ciphertextsPerSecond == 0 || faster || (tied && result.p99Seconds < best.p99Seconds))
+            best = result;
+    }
+    std::fprintf(stderr, "batch split: picked %ux%u for batch %zu on %u cores\n", best.split.workers,
+                 best.split.ompThreads, batchSize, cores);
+    decisions[key] = best;
+    return best;
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CKKS_BATCH_H
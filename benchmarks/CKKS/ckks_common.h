@@ -0,0 +1,644 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+  Shared setup for the CKKS bootstrapping benchmarks: parameter selection, context and
+  key generation, and the EvalBootstrap loop. Context and keys are built once per
+  argument tuple and reused across Google Benchmark's iteration-count probing and
+  repetitions, so only EvalBootstrap itself is timed. Across runs they are kept in the
+  key store (common/keystore.h). Leveled contexts without bootstrapping are set up the
+  same way for the operations around it.
+ */
+
+#ifndef FHEBENCH_CKKS_COMMON_H
+#define FHEBENCH_CKKS_COMMON_H
+
+#include "benchmark/benchmark.h"
+#include "openfhe.h"
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include "../common/energy.h"
+#include "../common/frequency.h"
+#include "../common/perf_counters.h"
+#include "../common/latency.h"
+#include "../common/keystore.h"
+#include "../common/memory.h"
+#include "../common/results.h"
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace fhebench {
+
+using namespace lbcrypto;
+
+#ifdef BASE_OPENFHE_VERSION
+inline const bool g_openfheVersionRegistered = RegisterLibraryVersion("openfhe", BASE_OPENFHE_VERSION);
+#endif
+
+
+struct CKKSBootstrapParams {
+    uint32_t logRingDim = 12;
+    // 0 selects full packing (ringDim / 2 slots).
+    uint32_t numSlots                      = 0;
+    std::vector<uint32_t> levelBudget      = {4, 4};
+    std::vector<uint32_t> bsgsDim          = {0, 0};
+    uint32_t levelsAvailableAfterBootstrap = 10;
+    uint32_t numIterations                 = 1;
+    // Precision of a single bootstrap, passed to EvalBootstrap when numIterations > 1;
+    // 0 measures it on the benchmarked context first.
+    uint32_t precision = 0;
+    // 0 keeps the library default.
+    uint32_t numLargeDigits = 0;
+    // Automorphism indices to generate rotation keys for; empty generates the keys of
+    // EvalBootstrapKeyGen.
+    std::vector<uint32_t> rotationIndices;
+
+    auto Key() const {
+        return std::make_tuple(logRingDim, numSlots, levelBudget, bsgsDim, levelsAvailableAfterBootstrap,
+                               numIterations, precision, numLargeDigits, rotationIndices);
+    }
+};
+
+// CalculateApproximationError() calculates the precision number (or approximation error).
+// The higher the precision, the less the error.
+inline double CalculateApproximationError(const std::vector<std::complex<double>>& result,
+                                          const std::vector<std::complex<double>>& expectedResult) {
+    if (result.size() != expectedResult.size())
+        OPENFHE_THROW("Cannot compare vectors with different numbers of elements");
+
+    // using the infinity norm
+    double maxError = 0;
+    for (size_t i = 0; i < result.size(); ++i) {
+        double error = std::abs(result[i].real() - expectedResult[i].real());
+        if (maxError < error)
+            maxError = error;
+    }
+
+    return std::abs(std::log2(maxError));
+}
+
+/*
+ * Evaluation keys live in static maps of CryptoContextImpl, indexed by the tag of the
+ * secret key. Setups loaded from the same key store entry share that tag, so each setup
+ * that inserts keys holds a reference to its tag, and the keys are cleared when the last
+ * reference goes rather than when the first of those setups is destroyed.
+ */
+class EvalKeyReference {
+public:
+    EvalKeyReference() = default;
+    explicit EvalKeyReference(const std::string& keyTag) : m_keyTag(keyTag) {
+        std::lock_guard<std::mutex> lock(Mutex());
+        ++Counts()[m_keyTag];
+    }
+
+    EvalKeyReference(EvalKeyReference&& other) noexcept : m_keyTag(std::move(other.m_keyTag)) {
+        other.m_keyTag.clear();
+    }
+    EvalKeyReference& operator=(EvalKeyReference&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            m_keyTag = std::move(other.m_keyTag);
+            other.m_keyTag.clear();
+        }
+        return *this;
+    }
+
+    ~EvalKeyReference() {
+        Reset();
+    }
+
+    void Reset() {
+        if (m_keyTag.empty())
+            return;
+        std::lock_guard<std::mutex> lock(Mutex());
+        auto count = Counts().find(m_keyTag);
+        if (count != Counts().end() && --count->second == 0) {
+            Counts().erase(count);
+            CryptoContextImpl<DCRTPoly>::ClearEvalMultKeys(m_keyTag);
+            CryptoContextImpl<DCRTPoly>::ClearEvalAutomorphismKeys(m_keyTag);
+        }
+        m_keyTag.clear();
+    }
+
+    EvalKeyReference(const EvalKeyReference&)            = delete;
+    EvalKeyReference& operator=(const EvalKeyReference&) = delete;
+
+private:
+    static std::mutex& Mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+    static std::map<std::string, size_t>& Counts() {
+        static std::map<std::string, size_t> counts;
+        return counts;
+    }
+
+    std::string m_keyTag;
+};
+
+/*
+ * The factory keeps every context generated or deserialized in the process, and
+ * GenCryptoContext hands an existing one back for equal parameters. The setup caches call
+ * this when they drop a setup, so a sweep does not accumulate a context per parameter set;
+ * live setups keep their contexts through their own pointers.
+ */
+inline void ReleaseCKKSContexts() {
+    CryptoContextFactory<DCRTPoly>::ReleaseAllContexts();
+}
+
+struct CKKSBootstrapSetup {
+    CKKSBootstrapParams params;
+    CryptoContext<DCRTPoly> cryptoContext;
+    KeyPair<DCRTPoly> keyPair;
+    usint depth;
+    uint32_t numSlots;
+    Plaintext ptxt;
+    // A depleted ciphertext that has used up all of its levels.
+    Ciphertext<DCRTPoly> ciph;
+    // Precision passed to EvalBootstrap: params.precision, or the measured precision of a
+    // single bootstrap (rounded down) when that is 0 and numIterations > 1.
+    uint32_t iterationPrecision;
+    // Measured on one untimed run of the benchmarked EvalBootstrap configuration.
+    double precisionBits;
+    usint levelsAfterBootstrap;
+    // Set once the evaluation keys are inserted, generated or loaded.
+    EvalKeyReference evalKeys;
+};
+
+// Scaling technique and modulus sizes shared by every CKKS context of the benchmarks.
+inline void SetCKKSScaling(CCParams<CryptoContextCKKSRNS>& parameters) {
+#if NATIVEINT == 128 && !defined(__EMSCRIPTEN__)
+    // Currently, only FIXEDMANUAL and FIXEDAUTO modes are supported for 128-bit CKKS bootstrapping.
+    ScalingTechnique rescaleTech = FIXEDAUTO;
+    usint dcrtBits               = 78;
+    usint firstMod               = 89;
+#else
+    // All modes are supported for 64-bit CKKS bootstrapping.
+    ScalingTechnique rescaleTech = FLEXIBLEAUTO;
+    usint dcrtBits               = 59;
+    usint firstMod               = 60;
+#endif
+
+    parameters.SetScalingModSize(dcrtBits);
+    parameters.SetScalingTechnique(rescaleTech);
+    parameters.SetFirstModSize(firstMod);
+}
+
+// log2 of the full key-switching modulus QP, which the HE standard bounds per ring dimension.
+inline uint32_t CKKSLogQP(const CryptoContext<DCRTPoly>& cryptoContext) {
+    const auto cryptoParams = std::dynamic_pointer_cast<CryptoParametersRNS>(cryptoContext->GetCryptoParameters());
+    uint32_t logQP          = cryptoParams->GetElementParams()->GetModulus().GetMsb();
+    if (cryptoParams->GetParamsP() != nullptr)
+        logQP += cryptoParams->GetParamsP()->GetModulus().GetMsb();
+    return logQP;
+}
+
+/*
+ * The smallest ring dimension the HE standard deems 128-bit secure (classical, ternary
+ * secrets) for a modulus of logQP bits, as log2; 0 beyond its table.
+ */
+inline uint32_t SecureLogRingDim(uint32_t logQP) {
+    const usint ringDim = StdLatticeParm::FindRingDim(HEStd_ternary, HEStd_128_classic, logQP);
+    return ringDim == 0 ? 0 : static_cast<uint32_t>(std::log2(ringDim));
+}
+
+// Everything the cached context and keys depend on; an entry from another library build is never reused.
+inline std::string CKKSKeyDescription(const CKKSBootstrapParams& params) {
+    auto join = [](const std::vector<uint32_t>& v) {
+        std::string out;
+        for (auto x : v)
+            out += std::to_string(x) + ",";
+        return out;
+    };
+    std::string description = "ckks logN=" + std::to_string(params.logRingDim) +
+                              " slots=" + std::to_string(params.numSlots) + " levelBudget=" + join(params.levelBudget) +
+                              " bsgsDim=" + join(params.bsgsDim) +
+                              " levelsAfter=" + std::to_string(params.levelsAvailableAfterBootstrap) +
+                              " iterations=" + std::to_string(params.numIterations) +
+                              " digits=" + std::to_string(params.numLargeDigits) +
+                              " nativeint=" + std::to_string(NATIVEINT);
+    if (!params.rotationIndices.empty())
+        description += " rotations=" + join(params.rotationIndices);
+#ifdef BASE_OPENFHE_VERSION
+    description += " openfhe=" BASE_OPENFHE_VERSION;
+#endif
+    return description;
+}
+
+/*
+ * Fills in cryptoContext, keyPair, depth and numSlots, and runs EvalBootstrapSetup. With
+ * useKeyStore the context, key pair and the multiplication and rotation keys are loaded from
+ * the key store when an entry exists, and generated and stored otherwise. The bootstrapping
+ * precomputations are not serializable and are always recomputed.
+ */
+inline void InitCKKSContextAndKeys(CKKSBootstrapSetup& setup, bool useKeyStore) {
+    const CKKSBootstrapParams& params = setup.params;
+    SecretKeyDist secretKeyDist       = UNIFORM_TERNARY;
+
+    /*  Bootstrapping consumes GetBootstrapDepth levels (plus one per extra iteration), which
+    * are added to levelsAvailableAfterBootstrap to obtain the multiplicative depth.
+    */
+    setup.depth = params.levelsAvailableAfterBootstrap +
+                  FHECKKSRNS::GetBootstrapDepth(params.levelBudget, secretKeyDist) + (params.numIterations - 1);
+
+    const std::string description = CKKSKeyDescription(params);
+    bool loaded                   = useKeyStore && KeyStore::Load(description, [&](std::istream& in) {
+        Serial::Deserialize(setup.cryptoContext, in, SerType::BINARY);
+        Serial::Deserialize(setup.keyPair.publicKey, in, SerType::BINARY);
+        Serial::Deserialize(setup.keyPair.secretKey, in, SerType::BINARY);
+        if (!CryptoContextImpl<DCRTPoly>::DeserializeEvalMultKey(in, SerType::BINARY) ||
+            !CryptoContextImpl<DCRTPoly>::DeserializeEvalAutomorphismKey(in, SerType::BINARY))
+            OPENFHE_THROW("cannot deserialize evaluation keys");
+    });
+    if (!loaded) {
+        setup.keyPair = KeyPair<DCRTPoly>();
+
+        CCParams<CryptoContextCKKSRNS> parameters;
+        /*  The secret key distribution for CKKS should either be SPARSE_TERNARY or UNIFORM_TERNARY.
+        * We use UNIFORM_TERNARY because this is included in the homomorphic encryption standard.
+        */
+        parameters.SetSecretKeyDist(secretKeyDist);
+
+        /*  "NotSet" lets the ring dimension be chosen freely so the benchmarks can run at
+        * small sizes. This should be used only in non-production environments.
+        */
+        parameters.SetSecurityLevel(HEStd_NotSet);
+        parameters.SetRingDim(1 << params.logRingDim);
+
+        if (params.numLargeDigits != 0) {
+            parameters.SetNumLargeDigits(params.numLargeDigits);
+            parameters.SetKeySwitchTechnique(HYBRID);
+        }
+
+        SetCKKSScaling(parameters);
+        parameters.SetMultiplicativeDepth(setup.depth);
+
+        setup.cryptoContext = GenCryptoContext(parameters);
+    }
+
+    CryptoContext<DCRTPoly> cryptoContext = setup.cryptoContext;
+
+    // Enable features that you wish to use. Note, we must enable FHE to use bootstrapping.
+    cryptoContext->Enable(PKE);
+    cryptoContext->Enable(KEYSWITCH);
+    cryptoContext->Enable(LEVELEDSHE);
+    cryptoContext->Enable(ADVANCEDSHE);
+    cryptoContext->Enable(FHE);
+
+    uint32_t numSlots = (params.numSlots != 0) ? params.numSlots : cryptoContext->GetRingDimension() / 2;
+    setup.numSlots    = numSlots;
+
+    {
+        MemoryPhase phase("EvalBootstrapSetup");
+        cryptoContext->EvalBootstrapSetup(params.levelBudget, params.bsgsDim, numSlots);
+    }
+    if (loaded) {
+        setup.evalKeys = EvalKeyReference(setup.keyPair.secretKey->GetKeyTag());
+        return;
+    }
+
+    {
+        MemoryPhase phase("KeyGen");
+        setup.keyPair = cryptoContext->KeyGen();
+    }
+    setup.evalKeys = EvalKeyReference(setup.keyPair.secretKey->GetKeyTag());
+    {
+        MemoryPhase phase("EvalMultKeyGen");
+        cryptoContext->EvalMultKeyGen(setup.keyPair.secretKey);
+    }
+    if (params.rotationIndices.empty()) {
+        MemoryPhase phase("EvalBootstrapKeyGen");
+        cryptoContext->EvalBootstrapKeyGen(setup.keyPair.secretKey, numSlots);
+    }
+    else {
+        MemoryPhase phase("EvalAutomorphismKeyGen");
+        CryptoContextImpl<DCRTPoly>::InsertEvalAutomorphismKey(
+            cryptoContext->EvalAutomorphismKeyGen(setup.keyPair.secretKey, params.rotationIndices),
+            setup.keyPair.secretKey->GetKeyTag());
+    }
+
+    if (useKeyStore) {
+        const std::string keyTag = setup.keyPair.secretKey->GetKeyTag();
+        KeyStore::Store(description, [&](std::ostream& out) {
+            Serial::Serialize(cryptoContext, out, SerType::BINARY);
+            Serial::Serialize(setup.keyPair.publicKey, out, SerType::BINARY);
+            Serial::Serialize(setup.keyPair.secretKey, out, SerType::BINARY);
+            CryptoContextImpl<DCRTPoly>::SerializeEvalMultKey(out, SerType::BINARY, keyTag);
+            CryptoContextImpl<DCRTPoly>::SerializeEvalAutomorphismKey(out, SerType::BINARY, keyTag);
+        });
+    }
+}
+
+inline std::shared_ptr<CKKSBootstrapSetup> BuildCKKSBootstrapSetup(const CKKSBootstrapParams& params,
+                                                                   bool useKeyStore = true) {
+    auto setup    = std::make_shared<CKKSBootstrapSetup>();
+    setup->params = params;
+    InitCKKSContextAndKeys(*setup, useKeyStore);
+    CryptoContext<DCRTPoly> cryptoContext = setup->cryptoContext;
+    uint32_t numSlots                     = setup->numSlots;
+
+    std::vector<double> x;
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    for (size_t i = 0; i < numSlots; i++) {
+        x.push_back(dis(gen));
+    }
+
+    // We start with a depleted ciphertext that has used up all of its levels.
+    setup->ptxt = cryptoContext->MakeCKKSPackedPlaintext(x, 1, setup->depth - 1, nullptr, numSlots);
+    setup->ptxt->SetLength(numSlots);
+    setup->ciph = cryptoContext->Encrypt(setup->keyPair.publicKey, setup->ptxt);
+
+    auto measurePrecision = [&](const Ciphertext<DCRTPoly>& ciphertext) {
+        Plaintext result;
+        cryptoContext->Decrypt(setup->keyPair.secretKey, ciphertext, &result);
+        result->SetLength(numSlots);
+        return CalculateApproximationError(result->GetCKKSPackedValue(), setup->ptxt->GetCKKSPackedValue());
+    };
+
+    // Iterative bootstrapping needs the precision of one iteration as input; measure it
+    // with these exact parameters rather than relying on a value from another setup.
+    setup->iterationPrecision = params.precision;
+    if (params.numIterations > 1 && params.precision == 0)
+        setup->iterationPrecision =
+            static_cast<uint32_t>(std::floor(measurePrecision(cryptoContext->EvalBootstrap(setup->ciph))));
+
+    auto ciphertextAfter = cryptoContext->EvalBootstrap(setup->ciph, params.numIterations, setup->iterationPrecision);
+    setup->levelsAfterBootstrap =
+        setup->depth - ciphertextAfter->GetLevel() - (ciphertextAfter->GetNoiseScaleDeg() - 1);
+    setup->precisionBits = measurePrecision(ciphertextAfter);
+
+    return setup;
+}
+
+// Measurements of every configuration run in this process, for summaries such as the
+// Pareto frontier of a parameter sweep.
+struct CKKSBootstrapResult {
+    CKKSBootstrapParams params;
+    uint32_t numSlots;
+    uint32_t iterationPrecision;
+    double precisionBits;
+    usint levelsAfterBootstrap;
+    // All timed iterations of all repetitions.
+    LatencyHistogram latency;
+};
+
+inline std::vector<CKKSBootstrapResult>& CKKSBootstrapResults() {
+    static std::vector<CKKSBootstrapResult> results;
+    return results;
+}
+
+inline void RecordCKKSBootstrapResult(const CKKSBootstrapSetup& setup, const LatencyHistogram& latency) {
+    auto& results = CKKSBootstrapResults();
+    for (auto& result : results) {
+        if (result.params.Key() == setup.params.Key()) {
+            result.latency.Merge(latency);
+            return;
+        }
+    }
+    results.push_back(
+        {setup.params, setup.numSlots, setup.iterationPrecision, setup.precisionBits, setup.levelsAfterBootstrap, latency});
+}
+
+/*
+ * Returns the setup for params, building it on first use. Only the most recent setup is
+ * kept: Google Benchmark runs all iterations and repetitions of one argument tuple
+ * back to back, and key sets at large ring dimensions do not fit in memory together.
+ */
+inline std::shared_ptr<CKKSBootstrapSetup> GetCKKSBootstrapSetup(const CKKSBootstrapParams& params) {
+    static std::mutex mutex;
+    static std::shared_ptr<CKKSBootstrapSetup> cached;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cached || cached->params.Key() != params.Key()) {
+        cached.reset();
+        ReleaseCKKSContexts();
+        cached = BuildCKKSBootstrapSetup(params);
+    }
+    return cached;
+}
+
+/*
+ * A leveled CKKS context without bootstrapping, for the homomorphic operations around it:
+ * full packing, the given multiplicative depth, the relinearization key and rotation
+ * keys for the given indices. ptxt and ciph hold random values at the top level. The
+ * keys are not cached in the key store; without the bootstrapping keys they are quick
+ * to generate.
+ */
+struct CKKSLeveledParams {
+    uint32_t logRingDim            = 12;
+    uint32_t depth                 = 10;
+    std::vector<int32_t> rotations = {1};
+    // 0 keeps the library default.
+    uint32_t numLargeDigits = 0;
+
+    auto Key() const {
+        return std::make_tuple(logRingDim, depth, rotations, numLargeDigits);
+    }
+};
+
+struct CKKSLeveledSetup {
+    CKKSLeveledParams params;
+    CryptoContext<DCRTPoly> cryptoContext;
+    KeyPair<DCRTPoly> keyPair;
+    uint32_t numSlots;
+    Plaintext ptxt;
+    Ciphertext<DCRTPoly> ciph;
+    EvalKeyReference evalKeys;
+};
+
+inline std::shared_ptr<CKKSLeveledSetup> BuildCKKSLeveledSetup(const CKKSLeveledParams& params) {
+    auto setup    = std::make_shared<CKKSLeveledSetup>();
+    setup->params = params;
+
+    CCParams<CryptoContextCKKSRNS> parameters;
+    parameters.SetSecretKeyDist(UNIFORM_TERNARY);
+    // As for bootstrapping, the ring dimension is free so that it can be swept.
+    parameters.SetSecurityLevel(HEStd_NotSet);
+    parameters.SetRingDim(1 << params.logRingDim);
+    if (params.numLargeDigits != 0) {
+        parameters.SetNumLargeDigits(params.numLargeDigits);
+        parameters.SetKeySwitchTechnique(HYBRID);
+    }
+    SetCKKSScaling(parameters);
+    parameters.SetMultiplicativeDepth(params.depth);
+
+    CryptoContext<DCRTPoly> cryptoContext = GenCryptoContext(parameters);
+    cryptoContext->Enable(PKE);
+    cryptoContext->Enable(KEYSWITCH);
+    cryptoContext->Enable(LEVELEDSHE);
+    setup->cryptoContext = cryptoContext;
+    setup->numSlots      = cryptoContext->GetRingDimension() / 2;
+
+    {
+        MemoryPhase phase("KeyGen");
+        setup->keyPair = cryptoContext->KeyGen();
+    }
+    setup->evalKeys = EvalKeyReference(setup->keyPair.secretKey->GetKeyTag());
+    {
+        MemoryPhase phase("EvalMultKeyGen");
+        cryptoContext->EvalMultKeyGen(setup->keyPair.secretKey);
+    }
+    if (!params.rotations.empty()) {
+        MemoryPhase phase("EvalRotateKeyGen");
+        cryptoContext->EvalRotateKeyGen(setup->keyPair.secretKey, params.rotations);
+    }
+
+    std::vector<double> x;
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    for (size_t i = 0; i < setup->numSlots; i++) {
+        x.push_back(dis(gen));
+    }
+    setup->ptxt = cryptoContext->MakeCKKSPackedPlaintext(x);
+    setup->ciph = cryptoContext->Encrypt(setup->keyPair.publicKey, setup->ptxt);
+    return setup;
+}
+
+// As GetCKKSBootstrapSetup: only the most recent setup is kept.
+inline std::shared_ptr<CKKSLeveledSetup> GetCKKSLeveledSetup(const CKKSLeveledParams& params) {
+    static std::mutex mutex;
+    static std::shared_ptr<CKKSLeveledSetup> cached;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cached || cached->params.Key() != params.Key()) {
+        cached.reset();
+        ReleaseCKKSContexts();
+        cached = BuildCKKSLeveledSetup(params);
+    }
+    return cached;
+}
+
+/*
+ * Benchmark arguments, in order: log2 of the ring dimension, number of slots (0 for full
+ * packing), level budget (used for both encoding and decoding) and number of
+ * bootstrapping iterations. Subclasses fill in the remaining parameters.
+ */
+class CKKSBootstrapFixture : public benchmark::Fixture {
+public:
+    void SetUp(benchmark::State& state) override {
+        CKKSBootstrapParams params = ParamsFromArgs(state);
+        Configure(params);
+        m_setup = GetCKKSBootstrapSetup(params);
+    }
+
+    void TearDown(benchmark::State&) override {
+        m_setup.reset();
+    }
+
+protected:
+    static CKKSBootstrapParams ParamsFromArgs(const benchmark::State& state) {
+        CKKSBootstrapParams params;
+        params.logRingDim    = static_cast<uint32_t>(state.range(0));
+        params.numSlots      = static_cast<uint32_t>(state.range(1));
+        params.levelBudget   = {static_cast<uint32_t>(state.range(2)), static_cast<uint32_t>(state.range(2))};
+        params.numIterations = static_cast<uint32_t>(state.range(3));
+        return params;
+    }
+
+    virtual void Configure(CKKSBootstrapParams&) const {}
+
+    void RunEvalBootstrap(benchmark::State& state) {
+        const CKKSBootstrapSetup& setup = *m_setup;
+        {
+            EnergyCounters energy(state);
+            FrequencyCounters frequency(state);
+            PerfCounters perf(state);
+            LatencyRecorder latency(state);
+            for (auto _ : state) {
+                auto sample = latency.Measure();
+                auto ciphertextAfter =
+                    setup.cryptoContext->EvalBootstrap(setup.ciph, setup.params.numIterations, setup.iterationPrecision);
+                benchmark::DoNotOptimize(ciphertextAfter);
+            }
+            RecordCKKSBootstrapResult(setup, latency.Histogram());
+        }
+        // Slots lets the reporter compute slots/second instead of bootstraps/second.
+        state.counters["Slots"]     = setup.numSlots;
+        state.counters["Precision"] = setup.precisionBits;
+        state.counters["Levels"]    = setup.levelsAfterBootstrap;
+        if (setup.params.numIterations > 1)
+            state.counters["Iter_precision"] = setup.iterationPrecision;
+    }
+
+    std::shared_ptr<CKKSBootstrapSetup> m_setup;
+};
+
+/*
+ * Start-up cost of a bootstrapping-capable context: generating context and keys (cold)
+ * versus loading them from the key store (cached). Both include EvalBootstrapSetup.
+ */
+inline void RunCKKSStartup(benchmark::State& state, const CKKSBootstrapParams& params, bool cached) {
+    if (cached) {
+        if (!KeyStore::Enabled()) {
+            state.SkipWithError("key store disabled (FHEBENCH_KEY_CACHE=off)");
+            return;
+        }
+        // Make sure an entry exists before timing.
+        CKKSBootstrapSetup warm;
+        warm.params = params;
+        InitCKKSContextAndKeys(warm, true);
+    }
+    // Neither path may get an existing context back from the factory, be it the warm-up's
+    // or that of a setup cached by another benchmark with the same parameters: the first
+    // iteration would time a lookup instead of generating or deserializing it.
+    ReleaseCKKSContexts();
+
+    for (auto _ : state) {
+        auto setup    = std::make_unique<CKKSBootstrapSetup>();
+        setup->params = params;
+        InitCKKSContextAndKeys(*setup, cached);
+        benchmark::DoNotOptimize(setup->keyPair);
+        // Releasing the keys and context is not part of start-up; neither is the context
+        // of this iteration, which the next one must not get back from the factory.
+        state.PauseTiming();
+        setup.reset();
+        ReleaseCKKSContexts();
+        state.ResumeTiming();
+    }
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CKKS_COMMON_H
@@ -0,0 +1,174 @@
+/*
+  Many short vectors bootstrapped together: a packing layer that places V vectors of s
+  slots side by side in one ciphertext of n = V * s slots, bootstraps that ciphertext
+  once and splits it back into V ciphertexts of s slots.
+
+  OpenFHE encodes a vector of s < N/2 slots so that it repeats with period s across the
+  slots of the ring. Read as a ciphertext of n slots, input i therefore already holds its
+  vector in every block of s slots, and packing only has to keep block i of input i: V
+  plaintext multiplications by 0/1 masks and their sum, without rotations. Unpacking
+  vector i masks block i of the bootstrapped ciphertext and copies it into the other
+  blocks with log2(V) rotations by s, 2s, ..., n/2, which restores the period-s layout of
+  an s-slot ciphertext. Each mask consumes a level: the inputs need one level left before
+  bootstrapping, and the outputs keep one level less than a bootstrapped ciphertext.
+ */
+
+#ifndef FHEBENCH_CKKS_PACKING_H
+#define FHEBENCH_CKKS_PACKING_H
+
+#include "ckks_common.h"
+
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace fhebench {
+
+class SparseSlotPacker {
+public:
+    // vectorSlots and packedSlots are powers of two, vectorSlots <= packedSlots <= N/2.
+    SparseSlotPacker(CryptoContext<DCRTPoly> cryptoContext, uint32_t vectorSlots, uint32_t packedSlots)
+        : m_cryptoContext(std::move(cryptoContext)), m_vectorSlots(vectorSlots), m_packedSlots(packedSlots) {}
+
+    uint32_t VectorSlots() const {
+        return m_vectorSlots;
+    }
+    uint32_t PackedSlots() const {
+        return m_packedSlots;
+    }
+    uint32_t NumVectors() const {
+        return m_packedSlots / m_vectorSlots;
+    }
+
+    // The rotations Unpack() needs keys for.
+    std::vector<int32_t> RotationIndices() const {
+        std::vector<int32_t> indices;
+        for (uint32_t shift = m_vectorSlots; shift < m_packedSlots; shift *= 2)
+            indices.push_back(static_cast<int32_t>(shift));
+        return indices;
+    }
+
+    // Up to NumVectors() ciphertexts of VectorSlots() slots, all at the same level.
+    Ciphertext<DCRTPoly> Pack(const std::vector<Ciphertext<DCRTPoly>>& inputs) const {
+        const std::vector<Plaintext>& masks = Masks(inputs.front()->GetLevel());
+        Ciphertext<DCRTPoly> packed         = m_cryptoContext->EvalMult(inputs[0], masks[0]);
+        for (size_t i = 1; i < inputs.size(); ++i)
+            m_cryptoContext->EvalAddInPlace(packed, m_cryptoContext->EvalMult(inputs[i], masks[i]));
+        packed->SetSlots(m_packedSlots);
+        return packed;
+    }
+
+    Ciphertext<DCRTPoly> Unpack(const Ciphertext<DCRTPoly>& packed, uint32_t index) const {
+        Ciphertext<DCRTPoly> unpacked = m_cryptoContext->EvalMult(packed, Masks(packed->GetLevel())[index]);
+        for (int32_t shift : RotationIndices())
+            m_cryptoContext->EvalAddInPlace(unpacked, m_cryptoContext->EvalRotate(unpacked, shift));
+        unpacked->SetSlots(m_vectorSlots);
+        return unpacked;
+    }
+
+    std::vector<Ciphertext<DCRTPoly>> UnpackAll(const Ciphertext<DCRTPoly>& packed) const {
+        std::vector<Ciphertext<DCRTPoly>> vectors;
+        for (uint32_t i = 0; i < NumVectors(); ++i)
+            vectors.push_back(Unpack(packed, i));
+        return vectors;
+    }
+
+private:
+    // The 0/1 mask of every block, encoded at a ciphertext level on first use.
+    const std::vector<Plaintext>& Masks(size_t level) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<Plaintext>& masks = m_masks[level];
+        if (masks.empty()) {
+            for (uint32_t i = 0; i < NumVectors(); ++i) {
+                std::vector<double> mask(m_packedSlots, 0.0);
+                std::fill(mask.begin() + i * m_vectorSlots, mask.begin() + (i + 1) * m_vectorSlots, 1.0);
+                masks.push_back(m_cryptoContext->MakeCKKSPackedPlaintext(mask, 1, level, nullptr, m_packedSlots));
+            }
+        }
+        return masks;
+    }
+
+    CryptoContext<DCRTPoly> m_cryptoContext;
+    uint32_t m_vectorSlots;
+    uint32_t m_packedSlots;
+    mutable std::mutex m_mutex;
+    mutable std::map<size_t, std::vector<Plaintext>> m_masks;
+};
+
+/*
+ * A bootstrapping setup at packedSlots (params.numSlots) with the rotation keys of the
+ * packer, and one full set of random inputs of vectorSlots slots with one level left.
+ */
+struct SparsePackingSetup {
+    std::shared_ptr<CKKSBootstrapSetup> base;
+    std::shared_ptr<SparseSlotPacker> packer;
+    std::vector<Ciphertext<DCRTPoly>> inputs;
+    std::vector<std::vector<std::complex<double>>> values;
+    // Worst vector, measured on one untimed pack, bootstrap and unpack.
+    double precisionBits;
+    usint levelsAfterUnpack;
+};
+
+inline std::shared_ptr<SparsePackingSetup> BuildSparsePackingSetup(const CKKSBootstrapParams& params,
+                                                                   uint32_t vectorSlots) {
+    auto setup  = std::make_shared<SparsePackingSetup>();
+    setup->base = BuildCKKSBootstrapSetup(params);
+
+    const CryptoContext<DCRTPoly>& cryptoContext = setup->base->cryptoContext;
+    const KeyPair<DCRTPoly>& keyPair             = setup->base->keyPair;
+
+    setup->packer = std::make_shared<SparseSlotPacker>(cryptoContext, vectorSlots, setup->base->numSlots);
+    if (setup->packer->NumVectors() > 1)
+        cryptoContext->EvalRotateKeyGen(keyPair.secretKey, setup->packer->RotationIndices());
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    for (uint32_t i = 0; i < setup->packer->NumVectors(); ++i) {
+        std::vector<double> x(vectorSlots);
+        for (double& value : x)
+            value = dis(gen);
+        Plaintext ptxt = cryptoContext->MakeCKKSPackedPlaintext(x, 1, setup->base->depth - 2, nullptr, vectorSlots);
+        ptxt->SetLength(vectorSlots);
+        setup->values.push_back(ptxt->GetCKKSPackedValue());
+        setup->inputs.push_back(cryptoContext->Encrypt(keyPair.publicKey, ptxt));
+    }
+
+    auto outputs = setup->packer->UnpackAll(cryptoContext->EvalBootstrap(setup->packer->Pack(setup->inputs)));
+    setup->precisionBits = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        Plaintext result;
+        cryptoContext->Decrypt(keyPair.secretKey, outputs[i], &result);
+        result->SetLength(vectorSlots);
+        setup->precisionBits =
+            std::min(setup->precisionBits, CalculateApproximationError(result->GetCKKSPackedValue(), setup->values[i]));
+    }
+    setup->levelsAfterUnpack =
+        setup->base->depth - outputs[0]->GetLevel() - (outputs[0]->GetNoiseScaleDeg() - 1);
+    return setup;
+}
+
+// As GetCKKSBootstrapSetup: only the most recent setup is kept.
+inline std::shared_ptr<SparsePackingSetup> GetSparsePackingSetup(const CKKSBootstrapParams& params,
+                                                                 uint32_t vectorSlots) {
+    static std::mutex mutex;
+    static std::shared_ptr<SparsePackingSetup> cached;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cached || cached->base->params.Key() != params.Key() || cached->packer->VectorSlots() != vectorSlots) {
+        cached.reset();
+        ReleaseCKKSContexts();
+        cached = BuildSparsePackingSetup(params, vectorSlots);
+    }
+    return cached;
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CKKS_PACKING_H
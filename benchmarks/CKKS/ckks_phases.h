@@ -0,0 +1,274 @@
+/*
+  Where the time of a CKKS bootstrap goes: EvalBootstrap split into its four phases,
+
+    ModRaise       from the call to the start of CoeffsToSlots: raising the depleted
+                   ciphertext to the full modulus
+    CoeffsToSlots  the homomorphic encoding transform
+    EvalMod        from the end of CoeffsToSlots to the start of SlotsToCoeffs: the
+                   approximate modular reduction (Chebyshev series and double-angle
+                   iterations), plus the conjugation that precedes it with full packing
+    SlotsToCoeffs  the decoding transform to the end of the call
+
+  with wall time, CPU time of the process (all OpenMP threads), key switches and NTTs of
+  each. OpenFHE does not expose the phases, so BootstrapPhaseProfiler hooks the library's
+  own calls (see symbol_hooks.h): FHECKKSRNS::EvalCoeffsToSlots, EvalSlotsToCoeffs and
+  EvalLinearTransform (the transforms for a level budget of 1) mark the boundaries, the
+  fast key-switching cores of KeySwitchHYBRID and KeySwitchBV count key switches, and
+  DCRTPoly::SwitchFormat counts NTTs, one per tower transformed in either direction.
+  Transforms OpenFHE runs on single towers without going through DCRTPoly::SwitchFormat
+  (inside ModDown and rescaling) are not counted, so NTT is a lower bound that is
+  comparable across phases and configurations.
+
+  The phases are split for single-iteration bootstrapping; the counters that could not
+  be hooked in the linked library are left out.
+ */
+
+#ifndef FHEBENCH_CKKS_PHASES_H
+#define FHEBENCH_CKKS_PHASES_H
+
+#include "ckks_common.h"
+#include "../common/symbol_hooks.h"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace fhebench {
+
+enum BootstrapPhase { kModRaise, kCoeffsToSlots, kEvalMod, kSlotsToCoeffs, kNumBootstrapPhases };
+
+constexpr const char* kBootstrapPhaseNames[kNumBootstrapPhases] = {"ModRaise", "CoeffsToSlots", "EvalMod",
+                                                                   "SlotsToCoeffs"};
+
+struct BootstrapPhaseTotals {
+    double wallSeconds[kNumBootstrapPhases]   = {};
+    double cpuSeconds[kNumBootstrapPhases]    = {};
+    uint64_t keySwitches[kNumBootstrapPhases] = {};
+    uint64_t ntts[kNumBootstrapPhases]        = {};
+    uint64_t bootstraps                       = 0;
+};
+
+class BootstrapPhaseProfiler {
+public:
+    // The profiler of the process; hooks the OpenFHE libraries on first use.
+    static BootstrapPhaseProfiler& Instance() {
+        static BootstrapPhaseProfiler profiler;
+        return profiler;
+    }
+
+    bool TracksPhases() const {
+        return m_tracksPhases;
+    }
+    bool CountsKeySwitches() const {
+        return m_countsKeySwitches;
+    }
+    bool CountsNTTs() const {
+        return m_countsNTTs;
+    }
+
+    /*
+     * Runs bootstrap, which makes one single-iteration EvalBootstrap call, and adds its
+     * phases to totals. Returns false if the call did not pass through both transforms.
+     * One profiled call at a time.
+     */
+    template <typename Bootstrap>
+    bool Profile(Bootstrap&& bootstrap, BootstrapPhaseTotals& totals) {
+        for (int p = 0; p < kNumBootstrapPhases; ++p) {
+            s_keySwitches[p].store(0, std::memory_order_relaxed);
+            s_ntts[p].store(0, std::memory_order_relaxed);
+        }
+        s_totals     = &totals;
+        s_transforms = 0;
+        Begin(kModRaise);
+        bootstrap();
+        Transition(kNumBootstrapPhases);
+        s_totals = nullptr;
+
+        for (int p = 0; p < kNumBootstrapPhases; ++p) {
+            totals.keySwitches[p] += s_keySwitches[p].load(std::memory_order_relaxed);
+            totals.ntts[p] += s_ntts[p].load(std::memory_order_relaxed);
+        }
+        totals.bootstraps++;
+        return s_transforms == 2;
+    }
+
+private:
+    using Transform       = Ciphertext<DCRTPoly> (*)(const void*, const std::vector<std::vector<ConstPlaintext>>&,
+                                                     ConstCiphertext<DCRTPoly>);
+    using LinearTransform = Ciphertext<DCRTPoly> (*)(const void*, const std::vector<ConstPlaintext>&,
+                                                     ConstCiphertext<DCRTPoly>);
+    using KeySwitchCore   = std::shared_ptr<std::vector<DCRTPoly>> (*)(const void*,
+                                                                       std::shared_ptr<std::vector<DCRTPoly>>,
+                                                                       EvalKey<DCRTPoly>,
+                                                                       std::shared_ptr<DCRTPoly::Params>);
+    using SwitchFormat    = void (*)(void*);
+
+    enum { kHybridCore, kHybridCoreExt, kBVCore, kNumKeySwitchCores };
+
+    BootstrapPhaseProfiler() {
+        const std::string library = "OPENFHE";
+        const std::string scheme  = "lbcrypto::FHECKKSRNS::";
+        m_tracksPhases = HookSymbol(library, scheme + "EvalCoeffsToSlots", HookCoeffsToSlots, &s_coeffsToSlots) &&
+                         HookSymbol(library, scheme + "EvalSlotsToCoeffs", HookSlotsToCoeffs, &s_slotsToCoeffs);
+        // Level budget 1 uses plain linear transforms; without the hook those runs have no boundaries.
+        HookSymbol(library, scheme + "EvalLinearTransform", HookLinearTransform, &s_linearTransform);
+
+        m_countsKeySwitches =
+            HookSymbol(library, "lbcrypto::KeySwitchHYBRID::EvalFastKeySwitchCore", HookKeySwitch<kHybridCore>,
+                       &s_keySwitchCores[kHybridCore]) |
+            HookSymbol(library, "lbcrypto::KeySwitchHYBRID::EvalFastKeySwitchCoreExt", HookKeySwitch<kHybridCoreExt>,
+                       &s_keySwitchCores[kHybridCoreExt]) |
+            HookSymbol(library, "lbcrypto::KeySwitchBV::EvalFastKeySwitchCore", HookKeySwitch<kBVCore>,
+                       &s_keySwitchCores[kBVCore]);
+
+        m_countsNTTs = HookSymbol(library, Demangle(typeid(DCRTPoly).name()) + "::SwitchFormat", HookSwitchFormat,
+                                  &s_switchFormat);
+    }
+
+    static double CpuSeconds() {
+        timespec ts;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    static void Begin(int phase) {
+        s_phase.store(phase, std::memory_order_relaxed);
+        s_wallStart = std::chrono::steady_clock::now();
+        s_cpuStart  = CpuSeconds();
+    }
+
+    // Closes the current phase of the profiled call, if any, and opens phase.
+    static void Transition(int phase) {
+        int current = s_phase.load(std::memory_order_relaxed);
+        if (s_totals == nullptr || current == kNumBootstrapPhases)
+            return;
+        auto wall  = std::chrono::steady_clock::now();
+        double cpu = CpuSeconds();
+        s_totals->wallSeconds[current] += std::chrono::duration<double>(wall - s_wallStart).count();
+        s_totals->cpuSeconds[current] += cpu - s_cpuStart;
+        s_phase.store(phase, std::memory_order_relaxed);
+        s_wallStart = wall;
+        s_cpuStart  = cpu;
+    }
+
+    static Ciphertext<DCRTPoly> HookCoeffsToSlots(const void* self, const std::vector<std::vector<ConstPlaintext>>& A,
+                                                  ConstCiphertext<DCRTPoly> ciphertext) {
+        Transition(kCoeffsToSlots);
+        auto result = s_coeffsToSlots(self, A, ciphertext);
+        Transition(kEvalMod);
+        s_transforms++;
+        return result;
+    }
+
+    static Ciphertext<DCRTPoly> HookSlotsToCoeffs(const void* self, const std::vector<std::vector<ConstPlaintext>>& A,
+                                                  ConstCiphertext<DCRTPoly> ciphertext) {
+        Transition(kSlotsToCoeffs);
+        s_transforms++;
+        return s_slotsToCoeffs(self, A, ciphertext);
+    }
+
+    // The first linear transform of a bootstrap encodes, the second decodes.
+    static Ciphertext<DCRTPoly> HookLinearTransform(const void* self, const std::vector<ConstPlaintext>& A,
+                                                    ConstCiphertext<DCRTPoly> ciphertext) {
+        if (s_totals == nullptr)
+            return s_linearTransform(self, A, ciphertext);
+        if (s_phase.load(std::memory_order_relaxed) != kModRaise) {
+            Transition(kSlotsToCoeffs);
+            s_transforms++;
+            return s_linearTransform(self, A, ciphertext);
+        }
+        Transition(kCoeffsToSlots);
+        auto result = s_linearTransform(self, A, ciphertext);
+        Transition(kEvalMod);
+        s_transforms++;
+        return result;
+    }
+
+    // Key switching and NTTs also run on OpenMP worker threads, hence the atomics.
+    template <int Core>
+    static std::shared_ptr<std::vector<DCRTPoly>> HookKeySwitch(const void* self,
+                                                               std::shared_ptr<std::vector<DCRTPoly>> digits,
+                                                               EvalKey<DCRTPoly> evalKey,
+                                                               std::shared_ptr<DCRTPoly::Params> paramsQl) {
+        int phase = s_phase.load(std::memory_order_relaxed);
+        if (phase < kNumBootstrapPhases)
+            s_keySwitches[phase].fetch_add(1, std::memory_order_relaxed);
+        return s_keySwitchCores[Core](self, digits, evalKey, paramsQl);
+    }
+
+    static void HookSwitchFormat(void* self) {
+        int phase = s_phase.load(std::memory_order_relaxed);
+        if (phase < kNumBootstrapPhases)
+            s_ntts[phase].fetch_add(static_cast<DCRTPoly*>(self)->GetNumOfElements(), std::memory_order_relaxed);
+        s_switchFormat(self);
+    }
+
+    bool m_tracksPhases      = false;
+    bool m_countsKeySwitches = false;
+    bool m_countsNTTs        = false;
+
+    static inline Transform s_coeffsToSlots                          = nullptr;
+    static inline Transform s_slotsToCoeffs                          = nullptr;
+    static inline LinearTransform s_linearTransform                  = nullptr;
+    static inline KeySwitchCore s_keySwitchCores[kNumKeySwitchCores] = {};
+    static inline SwitchFormat s_switchFormat                        = nullptr;
+
+    // kNumBootstrapPhases outside a profiled call.
+    static inline std::atomic<int> s_phase{kNumBootstrapPhases};
+    static inline std::atomic<uint64_t> s_keySwitches[kNumBootstrapPhases] = {};
+    static inline std::atomic<uint64_t> s_ntts[kNumBootstrapPhases]        = {};
+    static inline BootstrapPhaseTotals* s_totals                          = nullptr;
+    static inline int s_transforms                                        = 0;
+    static inline std::chrono::steady_clock::time_point s_wallStart;
+    static inline double s_cpuStart = 0;
+};
+
+/*
+ * Profiles every EvalBootstrap call of the benchmark loop and reports, per bootstrap,
+ * <Phase>_s (wall), <Phase>_cpu_s, <Phase>_KS and <Phase>_NTT for the four phases.
+ */
+inline void RunBootstrapPhases(benchmark::State& state, const CKKSBootstrapSetup& setup) {
+    auto& profiler = BootstrapPhaseProfiler::Instance();
+    if (!profiler.TracksPhases()) {
+        state.SkipWithError("cannot hook the bootstrapping transforms (OpenFHE linked statically or with -Bsymbolic)");
+        return;
+    }
+    if (setup.params.numIterations != 1) {
+        state.SkipWithError("phases are split for single-iteration bootstrapping only");
+        return;
+    }
+
+    BootstrapPhaseTotals totals;
+    PerfCounters perf(state);
+    for (auto _ : state) {
+        bool complete = profiler.Profile(
+            [&]() {
+                auto ciphertextAfter = setup.cryptoContext->EvalBootstrap(setup.ciph);
+                benchmark::DoNotOptimize(ciphertextAfter);
+            },
+            totals);
+        if (!complete) {
+            state.SkipWithError("EvalBootstrap did not go through CoeffsToSlots and SlotsToCoeffs");
+            return;
+        }
+    }
+
+    const double n = static_cast<double>(totals.bootstraps);
+    for (int p = 0; p < kNumBootstrapPhases; ++p) {
+        const std::string name          = kBootstrapPhaseNames[p];
+        state.counters[name + "_s"]     = totals.wallSeconds[p] / n;
+        state.counters[name + "_cpu_s"] = totals.cpuSeconds[p] / n;
+        if (profiler.CountsKeySwitches())
+            state.counters[name + "_KS"] = totals.keySwitches[p] / n;
+        if (profiler.CountsNTTs())
+            state.counters[name + "_NTT"] = totals.ntts[p] / n;
+    }
+    state.counters["Slots"]     = setup.numSlots;
+    state.counters["Precision"] = setup.precisionBits;
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CKKS_PHASES_H
@@ -0,0 +1,156 @@
+/*
+  Rotation keys of CKKS bootstrapping: what EvalBootstrapKeyGen generates, what it will
+  cost before it runs, and which of the keys EvalBootstrap actually uses.
+
+  PredictBootstrapAutomorphisms() repeats the index selection of EvalBootstrapKeyGen
+  (FHECKKSRNS::FindBootstrapRotationIndices in OpenFHE 1.x) from the collapsed-FFT
+  parameters of the level budget and baby-step dimensions, so together with
+  RotationKeyBytes(), which sizes one key from the crypto parameters, the memory of the
+  key set is known before any key is generated. The library does not export that
+  selection; the benchmarks report the predicted next to the generated key count.
+
+  RotationKeyInventory() lists the keys that are present, one entry per automorphism
+  index with its rotation and serialized size, and flags those in the predicted set.
+  GenerateRotationKeys() generates just the predicted keys. A setup whose params carry
+  the predicted indices as rotationIndices holds no other key, so its first bootstrap
+  checks the prediction: EvalBootstrap throws when a key it looks up is missing.
+ */
+
+#ifndef FHEBENCH_CKKS_ROTATION_KEYS_H
+#define FHEBENCH_CKKS_ROTATION_KEYS_H
+
+#include "ckks_common.h"
+#include "scheme/ckksrns/ckksrns-utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fhebench {
+
+struct RotationKeyInfo {
+    uint32_t automorphismIndex;
+    // Slot rotation of the automorphism; empty for the conjugation (index m - 1).
+    std::optional<uint32_t> rotation;
+    uint64_t bytes;
+    bool predicted;
+};
+
+// r with 5^r = index (mod m), the rotation behind an automorphism of the cyclotomic ring.
+inline std::optional<uint32_t> RotationForAutomorphism(uint32_t index, uint32_t m) {
+    uint64_t power = 1;
+    for (uint32_t r = 0; r < m / 4; ++r) {
+        if (power == index)
+            return r;
+        power = power * 5 % m;
+    }
+    return std::nullopt;
+}
+
+/*
+ * Automorphism indices EvalBootstrapKeyGen generates keys for: the baby and giant steps of
+ * every level of CoeffsToSlots and SlotsToCoeffs, the extra rotations of sparse packing
+ * and the conjugation. Empty for a level budget of 1, where the transforms are plain
+ * linear transforms with their own selection.
+ */
+inline std::optional<std::vector<uint32_t>> PredictBootstrapAutomorphisms(const CKKSBootstrapParams& params,
+                                                                          uint32_t numSlots, uint32_t m) {
+    // Layout of the GetCollapsedFFTParams result.
+    enum { kLevelBudget, kLayersCollapse, kRemCollapse, kNumRotations, kBabyStep, kGiantStep, kNumRotationsRem,
+           kBabyStepRem, kGiantStepRem };
+
+    uint32_t logSlots = std::max<uint32_t>(1, static_cast<uint32_t>(std::log2(numSlots)));
+    std::vector<uint32_t> budget(2);
+    for (size_t i = 0; i < 2; ++i)
+        budget[i] = std::min(std::max<uint32_t>(params.levelBudget[i], 1), logSlots);
+    if (budget[0] == 1 && budget[1] == 1)
+        return std::nullopt;
+
+    std::vector<int32_t> rotations;
+    for (size_t t = 0; t < 2; ++t) {
+        const bool encode     = (t == 0);
+        auto p                = GetCollapsedFFTParams(numSlots, budget[t], params.bsgsDim[t]);
+        const int32_t levels  = p[kLevelBudget];
+        const int32_t layers  = p[kLayersCollapse];
+        const int32_t rem     = p[kRemCollapse];
+        const int32_t flagRem = (rem == 0) ? 0 : 1;
+
+        auto steps = [&](int32_t numRotations, int32_t b, int32_t g, int32_t shift) {
+            for (int32_t j = 0; j < g; ++j)
+                rotations.push_back(ReduceRotation((j - (numRotations + 1) / 2 + 1) * (1 << shift),
+                                                   encode ? numSlots : m / 4));
+            for (int32_t i = 0; i < b; ++i)
+                rotations.push_back(ReduceRotation((g * i) * (1 << shift), m / 4));
+        };
+        // CoeffsToSlots runs its levels from the top down, SlotsToCoeffs from the bottom up;
+        // the level with the remaining layers comes last in both.
+        for (int32_t s = 0; s < levels - flagRem; ++s) {
+            int32_t shift = encode ? (levels - 1 - s - flagRem) * layers + rem : s * layers;
+            steps(p[kNumRotations], p[kBabyStep], p[kGiantStep], shift);
+        }
+        if (flagRem)
+            steps(p[kNumRotationsRem], p[kBabyStepRem], p[kGiantStepRem], encode ? 0 : (levels - flagRem) * layers);
+    }
+    // Sparse packing folds the ring slots onto numSlots with rotations by multiples of it.
+    for (uint32_t j = 1; j < m / (4 * numSlots); j <<= 1)
+        rotations.push_back(static_cast<int32_t>(j * numSlots));
+
+    std::vector<uint32_t> indices;
+    for (int32_t r : rotations) {
+        if (r != 0 && static_cast<uint32_t>(r) != m / 4)
+            indices.push_back(FindAutomorphismIndex2nComplex(r, m));
+    }
+    indices.push_back(m - 1);
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    return indices;
+}
+
+// The prediction for params before any context exists, at the ring dimension they set.
+inline std::optional<std::vector<uint32_t>> PredictBootstrapAutomorphisms(const CKKSBootstrapParams& params) {
+    const uint32_t ringDim = 1U << params.logRingDim;
+    return PredictBootstrapAutomorphisms(params, (params.numSlots != 0) ? params.numSlots : ringDim / 2, 2 * ringDim);
+}
+
+/*
+ * In-memory size of one rotation key: with hybrid key switching a key holds two
+ * polynomials per digit over the extended modulus QP. 0 for other key switching
+ * techniques.
+ */
+inline uint64_t RotationKeyBytes(const CryptoContext<DCRTPoly>& cryptoContext) {
+    auto cryptoParams = std::dynamic_pointer_cast<CryptoParametersRNS>(cryptoContext->GetCryptoParameters());
+    if (!cryptoParams || cryptoParams->GetKeySwitchTechnique() != HYBRID)
+        return 0;
+    const uint64_t towers = cryptoParams->GetParamsQP()->GetParams().size();
+    return 2ULL * cryptoParams->GetNumPartQ() * towers * cryptoContext->GetRingDimension() * sizeof(NativeInteger);
+}
+
+inline std::vector<RotationKeyInfo> RotationKeyInventory(const CKKSBootstrapSetup& setup,
+                                                         const std::vector<uint32_t>& predicted = {}) {
+    const uint32_t m = 2 * setup.cryptoContext->GetRingDimension();
+    std::vector<RotationKeyInfo> inventory;
+    for (const auto& entry :
+         CryptoContextImpl<DCRTPoly>::GetEvalAutomorphismKeyMap(setup.keyPair.secretKey->GetKeyTag())) {
+        CountingStreamBuf counter;
+        std::ostream out(&counter);
+        Serial::Serialize(entry.second, out, SerType::BINARY);
+        bool isPredicted = std::find(predicted.begin(), predicted.end(), entry.first) != predicted.end();
+        inventory.push_back({entry.first, RotationForAutomorphism(entry.first, m), counter.Count(), isPredicted});
+    }
+    return inventory;
+}
+
+// Generates the rotation keys for indices only, in place of those of EvalBootstrapKeyGen.
+inline void GenerateRotationKeys(const CKKSBootstrapSetup& setup, const std::vector<uint32_t>& indices) {
+    const std::string keyTag = setup.keyPair.secretKey->GetKeyTag();
+    CryptoContextImpl<DCRTPoly>::ClearEvalAutomorphismKeys(keyTag);
+    CryptoContextImpl<DCRTPoly>::InsertEvalAutomorphismKey(
+        setup.cryptoContext->EvalAutomorphismKeyGen(setup.keyPair.secretKey, indices), keyTag);
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CKKS_ROTATION_KEYS_H
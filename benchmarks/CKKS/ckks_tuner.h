@@ -0,0 +1,276 @@
+/*
+  Autotuner for the linear transforms of CKKS bootstrapping.
+
+  EvalBootstrapSetup takes a level budget and baby-step-giant-step dimensions for both
+  the encoding (CoeffsToSlots) and decoding (SlotsToCoeffs) transforms. A larger budget
+  costs depth but needs fewer rotations per level; the BSGS dimension trades rotation
+  keys against key switches. The best choice depends on the ring dimension, the slot
+  count and the machine, so TuneCKKSBootstrap measures candidates instead of guessing:
+
+  1. every (encoding, decoding) level budget pair up to maxLevelBudget, with the BSGS
+     dimensions left to OpenFHE ({0, 0});
+  2. for the fastest few pairs that meet the target, a coordinate search over
+     power-of-two BSGS dimensions, first for encoding, then for decoding.
+
+  Each candidate gets its own context with levelsAvailableAfterBootstrap set to the
+  required depth, and is measured for median EvalBootstrap latency, serialized size of
+  the rotation keys, precision and the levels actually left. Among the candidates that
+  meet the precision and depth target, the fastest wins; candidates within
+  kLatencyTolerance of it are considered equally fast and the one with the smallest
+  rotation keys is picked.
+
+  Decisions (including "nothing meets the target") are kept in memory and in the key
+  store directory (common/keystore.h), keyed by the target, the CPU model and the
+  library build. Set FHEBENCH_RETUNE=1 to ignore stored decisions.
+ */
+
+#ifndef FHEBENCH_CKKS_TUNER_H
+#define FHEBENCH_CKKS_TUNER_H
+
+#include "ckks_common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fhebench {
+
+struct CKKSTuneTarget {
+    uint32_t logRingDim = 12;
+    // 0 selects full packing (ringDim / 2 slots).
+    uint32_t numSlots                = 0;
+    double minPrecisionBits          = 0;
+    uint32_t minLevelsAfterBootstrap = 10;
+    // 0 keeps the library default.
+    uint32_t numLargeDigits = 0;
+    // Largest level budget tried for either transform.
+    uint32_t maxLevelBudget = 4;
+    // Timed EvalBootstrap calls per candidate; the median is used.
+    uint32_t trials = 3;
+    // Level budget pairs refined in the BSGS stage.
+    uint32_t refinePairs = 3;
+};
+
+struct CKKSTuneCandidate {
+    std::vector<uint32_t> levelBudget;
+    std::vector<uint32_t> bsgsDim;
+    double latencySeconds         = 0;
+    uint64_t rotationKeyBytes     = 0;
+    uint64_t numRotationKeys      = 0;
+    double precisionBits          = 0;
+    uint32_t levelsAfterBootstrap = 0;
+
+    bool Meets(const CKKSTuneTarget& target) const {
+        return precisionBits >= target.minPrecisionBits && levelsAfterBootstrap >= target.minLevelsAfterBootstrap;
+    }
+
+    CKKSBootstrapParams Params(const CKKSTuneTarget& target) const {
+        CKKSBootstrapParams params;
+        params.logRingDim                    = target.logRingDim;
+        params.numSlots                      = target.numSlots;
+        params.levelBudget                   = levelBudget;
+        params.bsgsDim                       = bsgsDim;
+        params.levelsAvailableAfterBootstrap = target.minLevelsAfterBootstrap;
+        params.numLargeDigits                = target.numLargeDigits;
+        return params;
+    }
+};
+
+// Candidates this much slower than the fastest still count as tied with it.
+constexpr double kLatencyTolerance = 0.03;
+
+inline std::string CKKSTuneDescription(const CKKSTuneTarget& target) {
+    char precision[32];
+    std::snprintf(precision, sizeof(precision), "%.2f", target.minPrecisionBits);
+    std::string description = "ckks-tune logN=" + std::to_string(target.logRingDim) +
+                              " slots=" + std::to_string(target.numSlots) + " precision>=" + precision +
+                              " levels>=" + std::to_string(target.minLevelsAfterBootstrap) +
+                              " digits=" + std::to_string(target.numLargeDigits) +
+                              " maxBudget=" + std::to_string(target.maxLevelBudget) +
+                              " cpu=" + MachineInfo::Collect().cpuModel + " nativeint=" + std::to_string(NATIVEINT);
+#ifdef BASE_OPENFHE_VERSION
+    description += " openfhe=" BASE_OPENFHE_VERSION;
+#endif
+    return description;
+}
+
+inline void PrintCKKSTuneCandidate(std::ostream& out, const CKKSTuneTarget& target, const CKKSTuneCandidate& c) {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "tune logN=%u slots=%u levelBudget={%u,%u} bsgsDim={%u,%u}: %.3f ms, %.1f MB rotation keys (%llu), "
+                  "%.2f bits, %u levels%s\n",
+                  target.logRingDim, target.numSlots, c.levelBudget[0], c.levelBudget[1], c.bsgsDim[0], c.bsgsDim[1],
+                  c.latencySeconds * 1e3, c.rotationKeyBytes / 1048576.0,
+                  static_cast<unsigned long long>(c.numRotationKeys), c.precisionBits, c.levelsAfterBootstrap,
+                  c.Meets(target) ? "" : " (misses target)");
+    out << line;
+}
+
+// Builds a throwaway context for one candidate and measures it. The keys are not put in
+// the key store: a search at large ring dimensions would fill the disk. Candidates that
+// differ only in bsgsDim have the parameters of a setup cached elsewhere, so the factory
+// is emptied first: GenCryptoContext would hand back that live context, and the
+// candidate's EvalBootstrapSetup would overwrite its precomputations.
+inline CKKSTuneCandidate MeasureCKKSTuneCandidate(const CKKSTuneTarget& target, std::vector<uint32_t> levelBudget,
+                                                  std::vector<uint32_t> bsgsDim) {
+    CKKSTuneCandidate candidate;
+    candidate.levelBudget = std::move(levelBudget);
+    candidate.bsgsDim     = std::move(bsgsDim);
+
+    ReleaseCKKSContexts();
+    auto setup                     = BuildCKKSBootstrapSetup(candidate.Params(target), false);
+    candidate.precisionBits        = setup->precisionBits;
+    candidate.levelsAfterBootstrap = setup->levelsAfterBootstrap;
+
+    const std::string keyTag  = setup->keyPair.secretKey->GetKeyTag();
+    candidate.numRotationKeys = CryptoContextImpl<DCRTPoly>::GetEvalAutomorphismKeyMap(keyTag).size();
+    CountingStreamBuf counter;
+    std::ostream out(&counter);
+    CryptoContextImpl<DCRTPoly>::SerializeEvalAutomorphismKey(out, SerType::BINARY, keyTag);
+    candidate.rotationKeyBytes = counter.Count();
+
+    LatencyHistogram latency;
+    for (uint32_t i = 0; i < std::max<uint32_t>(target.trials, 1); ++i) {
+        auto start           = std::chrono::steady_clock::now();
+        auto ciphertextAfter = setup->cryptoContext->EvalBootstrap(setup->ciph);
+        auto elapsed         = std::chrono::steady_clock::now() - start;
+        benchmark::DoNotOptimize(ciphertextAfter);
+        latency.Record(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+    candidate.latencySeconds = latency.Quantile(0.5) * 1e-9;
+    return candidate;
+}
+
+/*
+ * Returns the configuration that meets target at the lowest EvalBootstrap latency, or
+ * nothing if no candidate does. See the top of the file for the search.
+ */
+inline std::optional<CKKSTuneCandidate> TuneCKKSBootstrap(const CKKSTuneTarget& target) {
+    static std::mutex mutex;
+    static std::map<std::string, std::optional<CKKSTuneCandidate>> decisions;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::string description = CKKSTuneDescription(target);
+    auto known                    = decisions.find(description);
+    if (known != decisions.end())
+        return known->second;
+
+    const char* retune = std::getenv("FHEBENCH_RETUNE");
+    std::optional<CKKSTuneCandidate> decision;
+    bool loaded = (retune == nullptr || std::string(retune) == "0") &&
+                  KeyStore::Load(description, [&](std::istream& in) {
+                      std::string tag;
+                      in >> tag;
+                      if (tag != "config")
+                          return;
+                      CKKSTuneCandidate c;
+                      c.levelBudget.resize(2);
+                      c.bsgsDim.resize(2);
+                      in >> c.levelBudget[0] >> c.levelBudget[1] >> c.bsgsDim[0] >> c.bsgsDim[1] >> c.latencySeconds >>
+                          c.rotationKeyBytes >> c.numRotationKeys >> c.precisionBits >> c.levelsAfterBootstrap;
+                      decision = c;
+                  });
+    if (loaded) {
+        std::cerr << "tune: using stored decision for " << description << std::endl;
+        if (decision)
+            PrintCKKSTuneCandidate(std::cerr, target, *decision);
+        decisions[description] = decision;
+        return decision;
+    }
+
+    const uint32_t logSlots  = (target.numSlots != 0) ? static_cast<uint32_t>(std::ceil(std::log2(target.numSlots)))
+                                                      : target.logRingDim - 1;
+    const uint32_t maxBudget = std::max<uint32_t>(1, std::min(target.maxLevelBudget, logSlots));
+    std::vector<CKKSTuneCandidate> measured;
+    auto measure = [&](const std::vector<uint32_t>& levelBudget,
+                       const std::vector<uint32_t>& bsgsDim) -> std::optional<CKKSTuneCandidate> {
+        try {
+            measured.push_back(MeasureCKKSTuneCandidate(target, levelBudget, bsgsDim));
+            PrintCKKSTuneCandidate(std::cerr, target, measured.back());
+            return measured.back();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "tune: levelBudget={" << levelBudget[0] << "," << levelBudget[1] << "} bsgsDim={"
+                      << bsgsDim[0] << "," << bsgsDim[1] << "} failed: " << e.what() << std::endl;
+            return std::nullopt;
+        }
+    };
+
+    // Stage 1: level budgets, with OpenFHE's choice of BSGS dimensions.
+    for (uint32_t enc = 1; enc <= maxBudget; ++enc)
+        for (uint32_t dec = 1; dec <= maxBudget; ++dec)
+            measure({enc, dec}, {0, 0});
+
+    std::vector<CKKSTuneCandidate> pairs;
+    for (const auto& c : measured)
+        if (c.Meets(target))
+            pairs.push_back(c);
+    std::sort(pairs.begin(), pairs.end(),
+              [](const CKKSTuneCandidate& a, const CKKSTuneCandidate& b) { return a.latencySeconds < b.latencySeconds; });
+    if (pairs.size() > target.refinePairs)
+        pairs.resize(target.refinePairs);
+
+    // Stage 2: the baby-step dimension of each transform is at most the radix of one of
+    // its levels, 2^ceil(logSlots / budget).
+    auto dims = [&](uint32_t budget) {
+        std::vector<uint32_t> out;
+        for (uint32_t d = 2; d <= (1u << ((logSlots + budget - 1) / budget)); d *= 2)
+            out.push_back(d);
+        return out;
+    };
+    for (const auto& pair : pairs) {
+        CKKSTuneCandidate best = pair;
+        for (uint32_t dim : dims(pair.levelBudget[0])) {
+            auto c = measure(pair.levelBudget, {dim, 0});
+            if (c && c->Meets(target) && c->latencySeconds < best.latencySeconds)
+                best = *c;
+        }
+        for (uint32_t dim : dims(pair.levelBudget[1]))
+            measure(pair.levelBudget, {best.bsgsDim[0], dim});
+    }
+
+    double fastest = 0;
+    for (const auto& c : measured)
+        if (c.Meets(target) && (fastest == 0 || c.latencySeconds < fastest))
+            fastest = c.latencySeconds;
+    for (const auto& c : measured) {
+        if (!c.Meets(target) || c.latencySeconds > fastest * (1 + kLatencyTolerance))
+            continue;
+        if (!decision || c.rotationKeyBytes < decision->rotationKeyBytes)
+            decision = c;
+    }
+
+    if (decision) {
+        std::cerr << "tune: picked ";
+        PrintCKKSTuneCandidate(std::cerr, target, *decision);
+    }
+    else {
+        std::cerr << "tune: no configuration meets " << description << std::endl;
+    }
+    KeyStore::Store(description, [&](std::ostream& out) {
+        if (!decision) {
+            out << "none\n";
+            return;
+        }
+        const CKKSTuneCandidate& c = *decision;
+        out << "config " << c.levelBudget[0] << " " << c.levelBudget[1] << " " << c.bsgsDim[0] << " " << c.bsgsDim[1]
+            << " " << c.latencySeconds << " " << c.rotationKeyBytes << " " << c.numRotationKeys << " "
+            << c.precisionBits << " " << c.levelsAfterBootstrap << "\n";
+    });
+    decisions[description] = decision;
+    return decision;
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_CKKS_TUNER_H
@@ -31,10 +31,15 @@
 
 /*
 
-Example for multiple iterations of CKKS bootstrapping to improve precision. Note that you need to run a
+Benchmark for multiple iterations of CKKS bootstrapping to improve precision. Note that you need to run a
 single iteration of bootstrapping first, to measure the precision. Then, you can input the measured
 precision as a parameter to EvalBootstrap with multiple iterations. With 2 iterations, you can achieve
-double the precision of a single bootstrapping.
+double the precision of a single bootstrapping. The setup (ckks_common.h) does the single-iteration
+measurement on the benchmarked context itself.
+
+The sweep varies the number of iterations, the level budget and the levels left after bootstrapping.
+Once all benchmarks have run, the configurations are listed with their precision, median latency and
+remaining levels, and the ones on the Pareto frontier of the three are marked.
 
 * Source: Bae Y., Cheon J., Cho W., Kim J., and Kim T. META-BTS: Bootstrapping Precision
 * Beyond the Limit. Cryptology ePrint Archive, Report
@@ -44,155 +49,87 @@ double the precision of a single bootstrapping.
 
 #define PROFILE
 
-#include "openfhe.h"
+#include "ckks_common.h"
+#include "../common/pareto.h"
+
+#include <cstdio>
+#include <ostream>
 
 using namespace lbcrypto;
 
-void IterativeBootstrapExample();
+// Note that we currently only support 1 or 2 iterations.
+class IterativeCKKSBootstrap : public fhebench::CKKSBootstrapFixture {
+protected:
+    void Configure(fhebench::CKKSBootstrapParams& params) const override {
+        params.bsgsDim = {0, 0};
+        // Leave precision at 0 so the setup measures it for these parameters.
+    }
+};
 
-int main(int argc, char* argv[]) {
-    // We run the example with 8 slots and ring dimension 4096.
-    IterativeBootstrapExample();
+BENCHMARK_DEFINE_F(IterativeCKKSBootstrap, EvalBootstrap)(benchmark::State& state) {
+    RunEvalBootstrap(state);
 }
 
-// CalculateApproximationError() calculates the precision number (or approximation error).
-// The higher the precision, the less the error.
-double CalculateApproximationError(const std::vector<std::complex<double>>& result,
-                                   const std::vector<std::complex<double>>& expectedResult) {
-    if (result.size() != expectedResult.size())
-        OPENFHE_THROW("Cannot compare vectors with different numbers of elements");
-
-    // using the infinity norm
-    double maxError = 0;
-    for (size_t i = 0; i < result.size(); ++i) {
-        double error = std::abs(result[i].real() - expectedResult[i].real());
-        if (maxError < error)
-            maxError = error;
+BENCHMARK_REGISTER_F(IterativeCKKSBootstrap, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations"})
+    ->Args({12, 8, 3, 1})
+    ->Args({12, 8, 3, 2})
+    ->Unit(benchmark::kMillisecond);
+
+// Takes levelsAvailableAfterBootstrap as a fifth argument.
+class IterativeCKKSBootstrapSweep : public IterativeCKKSBootstrap {
+public:
+    void SetUp(benchmark::State& state) override {
+        fhebench::CKKSBootstrapParams params = ParamsFromArgs(state);
+        Configure(params);
+        params.levelsAvailableAfterBootstrap = static_cast<uint32_t>(state.range(4));
+        m_setup                              = fhebench::GetCKKSBootstrapSetup(params);
     }
+};
 
-    return std::abs(std::log2(maxError));
+BENCHMARK_DEFINE_F(IterativeCKKSBootstrapSweep, EvalBootstrap)(benchmark::State& state) {
+    RunEvalBootstrap(state);
 }
 
-void IterativeBootstrapExample() {
-    // Step 1: Set CryptoContext
-    CCParams<CryptoContextCKKSRNS> parameters;
-    SecretKeyDist secretKeyDist = UNIFORM_TERNARY;
-    parameters.SetSecretKeyDist(secretKeyDist);
-    parameters.SetSecurityLevel(HEStd_NotSet);
-    parameters.SetRingDim(1 << 12);
-
-#if NATIVEINT == 128 && !defined(__EMSCRIPTEN__)
-    // Currently, only FIXEDMANUAL and FIXEDAUTO modes are supported for 128-bit CKKS bootstrapping.
-    ScalingTechnique rescaleTech = FIXEDAUTO;
-    usint dcrtBits               = 78;
-    usint firstMod               = 89;
-#else
-    // All modes are supported for 64-bit CKKS bootstrapping.
-    ScalingTechnique rescaleTech = FLEXIBLEAUTO;
-    usint dcrtBits               = 59;
-    usint firstMod               = 60;
-#endif
-
-    parameters.SetScalingModSize(dcrtBits);
-    parameters.SetScalingTechnique(rescaleTech);
-    parameters.SetFirstModSize(firstMod);
-
-    // Here, we specify the number of iterations to run bootstrapping. Note that we currently only support 1 or 2 iterations.
-    // Two iterations should give us approximately double the precision of one iteration.
-    uint32_t numIterations = 2;
-
-    std::vector<uint32_t> levelBudget = {3, 3};
-    std::vector<uint32_t> bsgsDim     = {0, 0};
-
-    uint32_t levelsAvailableAfterBootstrap = 10;
-    usint depth =
-        levelsAvailableAfterBootstrap + FHECKKSRNS::GetBootstrapDepth(levelBudget, secretKeyDist) + (numIterations - 1);
-    parameters.SetMultiplicativeDepth(depth);
-
-    // Generate crypto context.
-    CryptoContext<DCRTPoly> cryptoContext = GenCryptoContext(parameters);
-
-    // Enable features that you wish to use. Note, we must enable FHE to use bootstrapping.
-    cryptoContext->Enable(PKE);
-    cryptoContext->Enable(KEYSWITCH);
-    cryptoContext->Enable(LEVELEDSHE);
-    cryptoContext->Enable(ADVANCEDSHE);
-    cryptoContext->Enable(FHE);
-
-    usint ringDim = cryptoContext->GetRingDimension();
-    std::cout << "CKKS scheme is using ring dimension " << ringDim << std::endl << std::endl;
-
-    // Step 2: Precomputations for bootstrapping
-    // We use a sparse packing.
-    uint32_t numSlots = 8;
-    cryptoContext->EvalBootstrapSetup(levelBudget, bsgsDim, numSlots);
-
-    // Step 3: Key Generation
-    auto keyPair = cryptoContext->KeyGen();
-    cryptoContext->EvalMultKeyGen(keyPair.secretKey);
-    // Generate bootstrapping keys.
-    cryptoContext->EvalBootstrapKeyGen(keyPair.secretKey, numSlots);
-
-    // Step 4: Encoding and encryption of inputs
-    // Generate random input
-    std::vector<double> x;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-    for (size_t i = 0; i < numSlots; i++) {
-        x.push_back(dis(gen));
-    }
+// With 8 slots, levelBudget is at most log2(8) = 3.
+BENCHMARK_REGISTER_F(IterativeCKKSBootstrapSweep, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations", "levelsAfter"})
+    ->ArgsProduct({{12}, {8}, {1, 2, 3}, {1, 2}, {2, 6, 10}})
+    ->Unit(benchmark::kMillisecond);
 
-    // Encoding as plaintexts
-    // We specify the number of slots as numSlots to achieve a performance improvement.
-    // We use the other default values of depth 1, levels 0, and no params.
-    // Alternatively, you can also set batch size as a parameter in the CryptoContext as follows:
-    // parameters.SetBatchSize(numSlots);
-    // Here, we assume all ciphertexts in the cryptoContext will have numSlots slots.
-    // We start with a depleted ciphertext that has used up all of its levels.
-    Plaintext ptxt = cryptoContext->MakeCKKSPackedPlaintext(x, 1, depth - 1, nullptr, numSlots);
-    ptxt->SetLength(numSlots);
-    std::cout << "Input: " << ptxt << std::endl;
-
-    // Encrypt the encoded vectors
-    Ciphertext<DCRTPoly> ciph = cryptoContext->Encrypt(keyPair.publicKey, ptxt);
-
-    // Step 5: Measure the precision of a single bootstrapping operation.
-    auto s1 = std::chrono::system_clock::now();
-    auto ciphertextAfter = cryptoContext->EvalBootstrap(ciph);
-    auto e1 = std::chrono::system_clock::now();
-    long long d1 = std::chrono::duration_cast<std::chrono::microseconds>(e1 - s1).count();
-
-    Plaintext result;
-    cryptoContext->Decrypt(keyPair.secretKey, ciphertextAfter, &result);
-    result->SetLength(numSlots);
-    uint32_t precision =
-        std::floor(CalculateApproximationError(result->GetCKKSPackedValue(), ptxt->GetCKKSPackedValue()));
-    std::cout << "Bootstrapping precision after 1 iteration: " << precision << std::endl;
-
-    // Set precision equal to empirically measured value after many test runs.
-    precision = 17;
-    std::cout << "Precision input to algorithm: " << precision << std::endl;
-
-    // Step 6: Run bootstrapping with multiple iterations.
-    auto s2 = std::chrono::system_clock::now();
-    auto ciphertextTwoIterations = cryptoContext->EvalBootstrap(ciph, numIterations, precision);
-    auto e2 = std::chrono::system_clock::now();
-    long long d2 = std::chrono::duration_cast<std::chrono::microseconds>(e2 - s2).count();
-    long long duration = d1 + d2;
-
-    Plaintext resultTwoIterations;
-    cryptoContext->Decrypt(keyPair.secretKey, ciphertextTwoIterations, &resultTwoIterations);
-    result->SetLength(numSlots);
-    auto actualResult = resultTwoIterations->GetCKKSPackedValue();
-
-    std::cout << "Output after two iterations of bootstrapping: " << actualResult << std::endl;
-    double precisionMultipleIterations = CalculateApproximationError(actualResult, ptxt->GetCKKSPackedValue());
-
-    // Output the precision of bootstrapping after two iterations. It should be approximately double the original precision.
-    std::cout << "Bootstrapping precision after 2 iterations: " << precisionMultipleIterations << std::endl;
-    std::cout << "Number of levels remaining after 2 bootstrappings: "
-              << depth - ciphertextTwoIterations->GetLevel() - (ciphertextTwoIterations->GetNoiseScaleDeg() - 1)
-              << std::endl;
-    std::cout << "combined latency : " << duration << " microseconds" << std::endl;
+/*
+ * Lists every configuration that ran, marking with '*' those that no other configuration
+ * beats on precision, median latency and remaining levels at once.
+ */
+static void PrintParetoFrontier(std::ostream& out) {
+    const auto& results = fhebench::CKKSBootstrapResults();
+    if (results.empty())
+        return;
+
+    std::vector<std::vector<double>> points;
+    for (const auto& result : results)
+        points.push_back({result.precisionBits, -static_cast<double>(result.latency.Quantile(0.5)),
+                          static_cast<double>(result.levelsAfterBootstrap)});
+    std::vector<bool> onFrontier(results.size(), false);
+    for (size_t i : fhebench::ParetoFrontier(points))
+        onFrontier[i] = true;
+
+    out << "\nPareto frontier over precision, p50 latency and levels remaining (* = on the frontier):\n";
+    char line[128];
+    std::snprintf(line, sizeof(line), "  %4s %5s %11s %10s %11s %13s %10s %11s %6s\n", "logN", "slots", "levelBudget",
+                  "iterations", "levelsAfter", "iterPrecision", "precision", "p50_ms", "levels");
+    out << line;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        std::snprintf(line, sizeof(line), "%c %4u %5u %11u %10u %11u %13u %10.2f %11.3f %6u\n",
+                      onFrontier[i] ? '*' : ' ', result.params.logRingDim, result.numSlots,
+                      result.params.levelBudget[0], result.params.numIterations,
+                      result.params.levelsAvailableAfterBootstrap, result.iterationPrecision, result.precisionBits,
+                      result.latency.Quantile(0.5) * 1e-6, result.levelsAfterBootstrap);
+        out << line;
+    }
 }
+
+static const bool g_paretoRegistered = fhebench::AddEpilogue(PrintParetoFrontier);
+
+FHEBENCH_MAIN();
@@ -0,0 +1,201 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+
+Rotation keys of CKKS bootstrapping (ckks_rotation_keys.h): the full set of
+EvalBootstrapKeyGen against the minimal set predicted from the level budget and baby-step
+dimensions, in key generation time and memory, next to the memory estimated before key
+generation. The minimal configuration has its own setup that holds the predicted keys
+only, so the bootstrap of its setup checks that EvalBootstrap needs no other key. After
+the run every key of every configuration is listed with its automorphism index, rotation,
+serialized size and whether it is in the predicted set.
+
+*/
+
+#define PROFILE
+
+#include "ckks_common.h"
+#include "ckks_rotation_keys.h"
+#include "../common/untimed.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+using namespace lbcrypto;
+
+struct RotationKeyReport {
+    fhebench::CKKSBootstrapParams params;
+    uint32_t numSlots;
+    std::vector<fhebench::RotationKeyInfo> inventory;
+};
+
+static std::vector<RotationKeyReport>& RotationKeyReports() {
+    static std::vector<RotationKeyReport> reports;
+    return reports;
+}
+
+class CKKSRotationKeys : public fhebench::CKKSBootstrapFixture {
+public:
+    void SetUp(benchmark::State& state) override {
+        fhebench::CKKSBootstrapParams params = ParamsFromArgs(state);
+        if (state.range(4) != 0) {
+            auto predicted = fhebench::PredictBootstrapAutomorphisms(params);
+            if (!predicted) {
+                state.SkipWithError("no prediction for a level budget of 1");
+                return;
+            }
+            params.rotationIndices = *predicted;
+        }
+        try {
+            m_setup = fhebench::GetCKKSBootstrapSetup(params);
+        }
+        catch (const std::exception&) {
+            state.SkipWithError("EvalBootstrap needs a key outside the predicted set");
+        }
+    }
+};
+
+/*
+ * Arguments: log2 of the ring dimension, number of slots, level budget and bootstrapping
+ * iterations, then minimal (0: EvalBootstrapKeyGen, 1: the predicted keys only). Each
+ * iteration drops the rotation keys and generates them again; only key generation is
+ * timed. Keys is the number of keys generated, Keys_MB their heap footprint and
+ * Serialized_MB their binary serialized size. Estimate_MB is the predicted key count
+ * times the computed size of one key, known before key generation, and Predicted_keys
+ * the predicted count. Precision is measured by bootstrapping with the generated keys.
+ */
+BENCHMARK_DEFINE_F(CKKSRotationKeys, KeyGen)(benchmark::State& state) {
+    if (state.error_occurred())
+        return;
+    const fhebench::CKKSBootstrapSetup& setup = *m_setup;
+    CryptoContext<DCRTPoly> cryptoContext     = setup.cryptoContext;
+    const bool minimal                        = state.range(4) != 0;
+    const uint32_t m                          = 2 * cryptoContext->GetRingDimension();
+    const std::string keyTag                  = setup.keyPair.secretKey->GetKeyTag();
+
+    auto predicted             = fhebench::PredictBootstrapAutomorphisms(setup.params, setup.numSlots, m);
+    const size_t predictedKeys = predicted ? predicted->size() : 0;
+    const double estimate      = static_cast<double>(predictedKeys * fhebench::RotationKeyBytes(cryptoContext));
+
+    int64_t keyBytes = 0;
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            int64_t before;
+            {
+                fhebench::UntimedScope untimed(state, energy, perf);
+                CryptoContextImpl<DCRTPoly>::ClearEvalAutomorphismKeys(keyTag);
+                before = fhebench::g_allocationCounters.liveBytes.load(std::memory_order_relaxed);
+            }
+            {
+                auto sample = latency.Measure();
+                if (minimal)
+                    fhebench::GenerateRotationKeys(setup, setup.params.rotationIndices);
+                else
+                    cryptoContext->EvalBootstrapKeyGen(setup.keyPair.secretKey, setup.numSlots);
+            }
+            keyBytes = fhebench::g_allocationCounters.liveBytes.load(std::memory_order_relaxed) - before;
+        }
+    }
+    const size_t numKeys = CryptoContextImpl<DCRTPoly>::GetEvalAutomorphismKeyMap(keyTag).size();
+
+    // The inventory lists the full key set, marking the predicted keys.
+    auto& reports = RotationKeyReports();
+    if (!minimal && std::none_of(reports.begin(), reports.end(),
+                                 [&](const RotationKeyReport& r) { return r.params.Key() == setup.params.Key(); }))
+        reports.push_back({setup.params, setup.numSlots,
+                           fhebench::RotationKeyInventory(setup, predicted.value_or(std::vector<uint32_t>()))});
+
+    fhebench::CountingStreamBuf counter;
+    std::ostream out(&counter);
+    CryptoContextImpl<DCRTPoly>::SerializeEvalAutomorphismKey(out, SerType::BINARY, keyTag);
+
+    auto ciphertextAfter =
+        cryptoContext->EvalBootstrap(setup.ciph, setup.params.numIterations, setup.iterationPrecision);
+    Plaintext result;
+    cryptoContext->Decrypt(setup.keyPair.secretKey, ciphertextAfter, &result);
+    result->SetLength(setup.numSlots);
+    const double precision =
+        fhebench::CalculateApproximationError(result->GetCKKSPackedValue(), setup.ptxt->GetCKKSPackedValue());
+
+    state.counters["Slots"]          = setup.numSlots;
+    state.counters["Keys"]           = static_cast<double>(numKeys);
+    state.counters["Keys_MB"]        = keyBytes / 1048576.0;
+    state.counters["Serialized_MB"]  = counter.Count() / 1048576.0;
+    state.counters["Estimate_MB"]    = estimate / 1048576.0;
+    state.counters["Predicted_keys"] = static_cast<double>(predictedKeys);
+    state.counters["Precision"]      = precision;
+}
+
+BENCHMARK_REGISTER_F(CKKSRotationKeys, KeyGen)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations", "minimal"})
+    ->ArgsProduct({{12, 14}, {8, 0}, {3}, {1}, {0, 1}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void PrintRotationKeyInventory(std::ostream& out) {
+    char line[128];
+    for (const auto& report : RotationKeyReports()) {
+        uint64_t total      = 0;
+        uint64_t predicted  = 0;
+        size_t numPredicted = 0;
+        for (const auto& key : report.inventory) {
+            total += key.bytes;
+            if (key.predicted) {
+                predicted += key.bytes;
+                numPredicted++;
+            }
+        }
+        std::snprintf(line, sizeof(line),
+                      "\nRotation keys, logN=%u slots=%u levelBudget=%u: %zu keys, %.2f MB; %zu predicted, %.2f MB\n",
+                      report.params.logRingDim, report.numSlots, report.params.levelBudget[0], report.inventory.size(),
+                      total / 1048576.0, numPredicted, predicted / 1048576.0);
+        out << line;
+        std::snprintf(line, sizeof(line), "  %10s %9s %12s %9s\n", "index", "rotation", "bytes", "predicted");
+        out << line;
+        for (const auto& key : report.inventory) {
+            std::string rotation = key.rotation ? std::to_string(*key.rotation) : std::string("conj");
+            std::snprintf(line, sizeof(line), "  %10u %9s %12llu %9s\n", key.automorphismIndex, rotation.c_str(),
+                          static_cast<unsigned long long>(key.bytes), key.predicted ? "yes" : "no");
+            out << line;
+        }
+    }
+}
+
+static const bool g_inventoryRegistered = fhebench::AddEpilogue(PrintRotationKeyInventory);
+
+FHEBENCH_MAIN();
@@ -31,127 +31,103 @@
 
 /*
 
-Example for CKKS bootstrapping with full packing
+Benchmark for CKKS bootstrapping with full packing
 
 */
 
 #define PROFILE
 
-#include "openfhe.h"
+#include "ckks_common.h"
+#include "ckks_phases.h"
+#include "../common/stability.h"
 
 using namespace lbcrypto;
 
-void SimpleBootstrapExample();
+/*
+ * The level budget of {4, 4} from the original example is a good choice for ring
+ * dimensions of 65536 and higher; it is kept across the sweep so the ring dimensions
+ * remain comparable.
+ */
+class SimpleCKKSBootstrap : public fhebench::CKKSBootstrapFixture {};
+
+BENCHMARK_DEFINE_F(SimpleCKKSBootstrap, EvalBootstrap)(benchmark::State& state) {
+    RunEvalBootstrap(state);
+}
+
+BENCHMARK_REGISTER_F(SimpleCKKSBootstrap, EvalBootstrap)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations"})
+    ->Args({12, 0, 4, 1})
+    ->Args({13, 0, 4, 1})
+    ->Args({14, 0, 4, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// ModRaise, CoeffsToSlots, EvalMod and SlotsToCoeffs separately, for each level budget.
+BENCHMARK_DEFINE_F(SimpleCKKSBootstrap, Phases)(benchmark::State& state) {
+    fhebench::RunBootstrapPhases(state, *m_setup);
+}
+
+BENCHMARK_REGISTER_F(SimpleCKKSBootstrap, Phases)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations"})
+    ->ArgsProduct({{12}, {0}, {1, 2, 3, 4}, {1}})
+    ->Unit(benchmark::kMillisecond);
+
+static fhebench::StabilityEngine::Config StableBootstrap(const std::string& name,
+                                                        const fhebench::CKKSBootstrapSetup& setup) {
+    return {name, [&setup] {
+                auto ciphertextAfter =
+                    setup.cryptoContext->EvalBootstrap(setup.ciph, setup.params.numIterations, setup.iterationPrecision);
+                benchmark::DoNotOptimize(ciphertextAfter);
+            }};
+}
 
-int main(int argc, char* argv[]) {
-    SimpleBootstrapExample();
+/*
+ * EvalBootstrap under the stability engine (benchmarks/common/stability.h): warmed up
+ * until the latency settles, then repeated until the 95% confidence interval is within
+ * FHEBENCH_CI_TARGET or FHEBENCH_TIME_BUDGET runs out, without samples taken at a
+ * drifted frequency or temperature.
+ */
+BENCHMARK_DEFINE_F(SimpleCKKSBootstrap, Stable)(benchmark::State& state) {
+    fhebench::RunStable(state, {StableBootstrap("EvalBootstrap", *m_setup)});
 }
 
-void SimpleBootstrapExample() {
-    CCParams<CryptoContextCKKSRNS> parameters;
-    // A. Specify main parameters
-    /*  A1) Secret key distribution
-    * The secret key distribution for CKKS should either be SPARSE_TERNARY or UNIFORM_TERNARY.
-    * The SPARSE_TERNARY distribution was used in the original CKKS paper,
-    * but in this example, we use UNIFORM_TERNARY because this is included in the homomorphic
-    * encryption standard.
-    */
-    SecretKeyDist secretKeyDist = UNIFORM_TERNARY;
-    parameters.SetSecretKeyDist(secretKeyDist);
-
-    /*  A2) Desired security level based on FHE standards.
-    * In this example, we use the "NotSet" option, so the example can run more quickly with
-    * a smaller ring dimension. Note that this should be used only in
-    * non-production environments, or by experts who understand the security
-    * implications of their choices. In production-like environments, we recommend using
-    * HEStd_128_classic, HEStd_192_classic, or HEStd_256_classic for 128-bit, 192-bit,
-    * or 256-bit security, respectively. If you choose one of these as your security level,
-    * you do not need to set the ring dimension.
-    */
-    parameters.SetSecurityLevel(HEStd_NotSet);
-    parameters.SetRingDim(1 << 12);
-
-    /*  A3) Scaling parameters.
-    * By default, we set the modulus sizes and rescaling technique to the following values
-    * to obtain a good precision and performance tradeoff. We recommend keeping the parameters
-    * below unless you are an FHE expert.
-    */
-#if NATIVEINT == 128 && !defined(__EMSCRIPTEN__)
-    ScalingTechnique rescaleTech = FIXEDAUTO;
-    usint dcrtBits               = 78;
-    usint firstMod               = 89;
-#else
-    ScalingTechnique rescaleTech = FLEXIBLEAUTO;
-    usint dcrtBits               = 59;
-    usint firstMod               = 60;
-#endif
-
-    parameters.SetScalingModSize(dcrtBits);
-    parameters.SetScalingTechnique(rescaleTech);
-    parameters.SetFirstModSize(firstMod);
-
-    /*  A4) Multiplicative depth.
-    * The goal of bootstrapping is to increase the number of available levels we have, or in other words,
-    * to dynamically increase the multiplicative depth. However, the bootstrapping procedure itself
-    * needs to consume a few levels to run. We compute the number of bootstrapping levels required
-    * using GetBootstrapDepth, and add it to levelsAvailableAfterBootstrap to set our initial multiplicative
-    * depth. We recommend using the input parameters below to get started.
-    */
-    std::vector<uint32_t> levelBudget = {4, 4};
-
-    // Note that the actual number of levels avalailable after bootstrapping before next bootstrapping 
-    // will be levelsAvailableAfterBootstrap - 1 because an additional level
-    // is used for scaling the ciphertext before next bootstrapping (in 64-bit CKKS bootstrapping)
-    uint32_t levelsAvailableAfterBootstrap = 10;
-    usint depth = levelsAvailableAfterBootstrap + FHECKKSRNS::GetBootstrapDepth(levelBudget, secretKeyDist);
-    parameters.SetMultiplicativeDepth(depth);
-
-    CryptoContext<DCRTPoly> cryptoContext = GenCryptoContext(parameters);
-
-    cryptoContext->Enable(PKE);
-    cryptoContext->Enable(KEYSWITCH);
-    cryptoContext->Enable(LEVELEDSHE);
-    cryptoContext->Enable(ADVANCEDSHE);
-    cryptoContext->Enable(FHE);
-
-    usint ringDim = cryptoContext->GetRingDimension();
-    // This is the maximum number of slots that can be used for full packing.
-    usint numSlots = ringDim / 2;
-    std::cout << "CKKS scheme is using ring dimension " << ringDim << std::endl << std::endl;
-
-    cryptoContext->EvalBootstrapSetup(levelBudget);
-
-    auto keyPair = cryptoContext->KeyGen();
-    cryptoContext->EvalMultKeyGen(keyPair.secretKey);
-    cryptoContext->EvalBootstrapKeyGen(keyPair.secretKey, numSlots);
-
-    std::vector<double> x = {0.25, 0.5, 0.75, 1.0, 2.0, 3.0, 4.0, 5.0};
-    size_t encodedLength  = x.size();
-
-    // We start with a depleted ciphertext that has used up all of its levels.
-    Plaintext ptxt = cryptoContext->MakeCKKSPackedPlaintext(x, 1, depth - 1);
-
-    ptxt->SetLength(encodedLength);
-    std::cout << "Input: " << ptxt << std::endl;
-
-    Ciphertext<DCRTPoly> ciph = cryptoContext->Encrypt(keyPair.publicKey, ptxt);
-
-    std::cout << "Initial number of levels remaining: " << depth - ciph->GetLevel() << std::endl;
-
-    // Perform the bootstrapping operation. The goal is to increase the number of levels remaining
-    // for HE computation.
-    auto start_time = std::chrono::system_clock::now();
-    auto ciphertextAfter = cryptoContext->EvalBootstrap(ciph);
-    auto end_time = std::chrono::system_clock::now();
-    long long duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-    std::cout << "Number of levels remaining after bootstrapping: "
-              << depth - ciphertextAfter->GetLevel() - (ciphertextAfter->GetNoiseScaleDeg() - 1) << std::endl
-              << std::endl;
-
-    std::cout << "latency of the bootstrapping operation: " << duration << " microseconds" << std::endl;
-
-    Plaintext result;
-    cryptoContext->Decrypt(keyPair.secretKey, ciphertextAfter, &result);
-    result->SetLength(encodedLength);
-    std::cout << "Output after bootstrapping \n\t" << result << std::endl;
+BENCHMARK_REGISTER_F(SimpleCKKSBootstrap, Stable)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations"})
+    ->Args({12, 0, 4, 1})
+    ->Args({13, 0, 4, 1})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+/*
+ * Two level budgets at one ring dimension, interleaved round by round so that thermal
+ * drift affects both alike. Ratio is the time of levelBudgetB over levelBudgetA.
+ */
+static void CKKS_STABLE_AB(benchmark::State& state) {
+    fhebench::CKKSBootstrapParams paramsA, paramsB;
+    paramsA.logRingDim  = static_cast<uint32_t>(state.range(0));
+    paramsB.logRingDim  = paramsA.logRingDim;
+    paramsA.levelBudget = {static_cast<uint32_t>(state.range(1)), static_cast<uint32_t>(state.range(1))};
+    paramsB.levelBudget = {static_cast<uint32_t>(state.range(2)), static_cast<uint32_t>(state.range(2))};
+    auto setupA         = fhebench::BuildCKKSBootstrapSetup(paramsA);
+    auto setupB         = fhebench::BuildCKKSBootstrapSetup(paramsB);
+    fhebench::RunStable(state, {StableBootstrap("A", *setupA), StableBootstrap("B", *setupB)});
 }
+
+BENCHMARK(CKKS_STABLE_AB)
+    ->ArgNames({"logN", "levelBudgetA", "levelBudgetB"})
+    ->Args({12, 4, 2})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Start-up cost with and without the key store, at the first configuration above.
+static void CKKS_STARTUP(benchmark::State& state) {
+    fhebench::CKKSBootstrapParams params;
+    params.logRingDim  = static_cast<uint32_t>(state.range(0));
+    params.levelBudget = {4, 4};
+    fhebench::RunCKKSStartup(state, params, state.range(1) != 0);
+}
+
+BENCHMARK(CKKS_STARTUP)->ArgNames({"logN", "cached"})->Args({12, 0})->Args({12, 1})->Unit(benchmark::kMillisecond);
+
+FHEBENCH_MAIN();
@@ -0,0 +1,300 @@
+//==================================================================================
+// BSD 2-Clause License
+//
+// Copyright (c) 2014-2022, NJIT, Duality Technologies Inc. and other contributors
+//
+// All rights reserved.
+//
+// Author TPOC: contact@openfhe.org
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//==================================================================================
+
+/*
+
+Streaming file-to-file CKKS bootstrapping: plaintext records are read from an input file,
+encoded and encrypted, bootstrapped, serialized and written to a memory-mapped output
+file of fixed-size records (common/record_file.h), so any ciphertext can be read back by
+offset without parsing the file. The five steps are stages of a pipeline
+(common/pipeline.h) connected by bounded queues; every item is a batch of records, so the
+number of records in flight, and with it the memory, is bounded by the queue capacity
+and batch size and not by the size of the input.
+
+An input record is `slots` doubles. The input file is generated (untimed) on first use
+in FHEBENCH_STREAM_DIR (default .fhebench-stream), where the output file goes too.
+
+*/
+
+#define PROFILE
+
+#include "ckks_common.h"
+#include "../common/pipeline.h"
+#include "../common/record_file.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace lbcrypto;
+
+static std::string StreamDirectory() {
+    const char* dir  = std::getenv("FHEBENCH_STREAM_DIR");
+    std::string path = (dir != nullptr && *dir != '\0') ? std::string(dir) : std::string(".fhebench-stream");
+    mkdir(path.c_str(), 0700);
+    return path;
+}
+
+// Input file of numRecords records of numSlots doubles in [0, 1), created if missing.
+static std::string InputFile(uint32_t numSlots, size_t numRecords) {
+    std::string path =
+        StreamDirectory() + "/ckks-" + std::to_string(numSlots) + "x" + std::to_string(numRecords) + ".in";
+    const size_t size = numRecords * numSlots * sizeof(double);
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) == size)
+        return path;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::mt19937_64 gen(numRecords);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    std::vector<double> record(numSlots);
+    for (size_t r = 0; r < numRecords; ++r) {
+        for (auto& x : record)
+            x = dis(gen);
+        out.write(reinterpret_cast<const char*>(record.data()),
+                  static_cast<std::streamsize>(numSlots * sizeof(double)));
+    }
+    return path;
+}
+
+struct StreamBatch {
+    size_t first = 0;
+    size_t count = 0;
+    std::vector<double> values;
+    std::vector<Ciphertext<DCRTPoly>> ciphertexts;
+    std::vector<std::string> records;
+};
+
+// Stages that move bytes between the process and the files; the rest is compute.
+static bool IsIOStage(const std::string& name) {
+    return name == "Read" || name == "Write";
+}
+
+class StreamingCKKSBootstrap : public fhebench::CKKSBootstrapFixture {
+protected:
+    void Configure(fhebench::CKKSBootstrapParams& params) const override {
+        params.bsgsDim = {0, 0};
+    }
+};
+
+/*
+ * Arguments: log2 of the ring dimension, number of slots, level budget and bootstrapping
+ * iterations, then input records, records per batch, EvalBootstrap workers and queue
+ * capacity. Every iteration streams the whole input file into a new output file, so Ops
+ * is the number of records and the Throughput column reads slots/second end to end.
+ *
+ * In_MBps/Out_MBps are the input and output bytes per second of the stream, including
+ * the final flush (Sync_s); the output counts the serialized records and the header, not
+ * the padding of the record slots. <Stage>_share is the fraction of the summed
+ * service time spent in that stage and IO_share that of Read, Write and the flush.
+ * Peak_heap_MB and Peak_RSS_MB are the growth of the heap and resident set during the
+ * stream; they depend on batch, workers and queue but not on the number of records.
+ * Readback_bits is the precision of a ciphertext deserialized from the record file.
+ */
+BENCHMARK_DEFINE_F(StreamingCKKSBootstrap, FileToFile)(benchmark::State& state) {
+    const fhebench::CKKSBootstrapSetup& setup = *m_setup;
+    CryptoContext<DCRTPoly> cryptoContext     = setup.cryptoContext;
+    const uint32_t numSlots                   = setup.numSlots;
+    const size_t numRecords                   = static_cast<size_t>(state.range(4));
+    const size_t batchSize                    = static_cast<size_t>(state.range(5));
+    const size_t recordBytes                  = numSlots * sizeof(double);
+
+    const std::string inputPath = InputFile(numSlots, numRecords);
+    const std::string outputPath =
+        StreamDirectory() + "/ckks-" + std::to_string(numSlots) + "x" + std::to_string(numRecords) + ".ctxt";
+    int input = open(inputPath.c_str(), O_RDONLY);
+    if (input < 0) {
+        state.SkipWithError("cannot open the input file");
+        return;
+    }
+
+    // All output ciphertexts are at the same level, so one sample fixes the record size;
+    // the slack covers small differences in the serialized headers.
+    size_t maxPayload;
+    {
+        std::ostringstream sample;
+        Serial::Serialize(
+            cryptoContext->EvalBootstrap(setup.ciph, setup.params.numIterations, setup.iterationPrecision), sample,
+            SerType::BINARY);
+        maxPayload = sample.str().size() + sample.str().size() / 64 + 4096;
+    }
+
+    fhebench::RecordFileWriter* output = nullptr;
+    fhebench::Pipeline<StreamBatch> pipeline(
+        {{"Read", 1,
+          [&](StreamBatch& batch) {
+              batch.values.resize(batch.count * numSlots);
+              const size_t length = batch.count * recordBytes;
+              if (pread(input, batch.values.data(), length, static_cast<off_t>(batch.first * recordBytes)) !=
+                  static_cast<ssize_t>(length))
+                  OPENFHE_THROW("short read from the input file");
+          }},
+         {"Encrypt", 1,
+          [&](StreamBatch& batch) {
+              for (size_t r = 0; r < batch.count; ++r) {
+                  std::vector<double> x(batch.values.begin() + r * numSlots, batch.values.begin() + (r + 1) * numSlots);
+                  // Encoded at the last level, like the input of the other bootstrapping benchmarks.
+                  Plaintext ptxt = cryptoContext->MakeCKKSPackedPlaintext(x, 1, setup.depth - 1, nullptr, numSlots);
+                  batch.ciphertexts.push_back(cryptoContext->Encrypt(setup.keyPair.publicKey, ptxt));
+              }
+              batch.values = std::vector<double>();
+          }},
+         {"Bootstrap", static_cast<size_t>(state.range(6)),
+          [&](StreamBatch& batch) {
+              for (auto& ciphertext : batch.ciphertexts)
+                  ciphertext =
+                      cryptoContext->EvalBootstrap(ciphertext, setup.params.numIterations, setup.iterationPrecision);
+          }},
+         {"Serialize", 1,
+          [&](StreamBatch& batch) {
+              for (const auto& ciphertext : batch.ciphertexts) {
+                  std::ostringstream out;
+                  Serial::Serialize(ciphertext, out, SerType::BINARY);
+                  batch.records.push_back(out.str());
+              }
+              batch.ciphertexts = std::vector<Ciphertext<DCRTPoly>>();
+          }},
+         {"Write", 1,
+          [&](StreamBatch& batch) {
+              for (size_t r = 0; r < batch.records.size(); ++r)
+                  output->Write(batch.first + r, batch.records[r].data(), batch.records[r].size());
+              batch.records = std::vector<std::string>();
+          }}},
+        static_cast<size_t>(state.range(7)));
+
+    const size_t numBatches = (numRecords + batchSize - 1) / batchSize;
+    std::vector<fhebench::Pipeline<StreamBatch>::StageStats> stages;
+    double streamSeconds = 0;
+    double syncSeconds   = 0;
+    double outputBytes   = 0;
+    int64_t peakHeap     = 0;
+    int64_t peakRssKB    = 0;
+    {
+        fhebench::EnergyCounters energy(state);
+        fhebench::PerfCounters perf(state);
+        fhebench::LatencyRecorder latency(state);
+        for (auto _ : state) {
+            const int64_t rssBefore  = fhebench::CurrentRssKB();
+            const int64_t liveBefore = fhebench::g_allocationCounters.liveBytes.load(std::memory_order_relaxed);
+            fhebench::ResetPeakRss();
+            fhebench::ResetPeakLiveBytes();
+
+            fhebench::RecordFileWriter writer(outputPath, maxPayload, numRecords);
+            output     = &writer;
+            auto stats = pipeline.Run(numBatches, [&](size_t b) {
+                StreamBatch batch;
+                batch.first = b * batchSize;
+                batch.count = std::min(batchSize, numRecords - batch.first);
+                return batch;
+            });
+            auto syncStart = std::chrono::steady_clock::now();
+            writer.Finish();
+            outputBytes += writer.WrittenBytes();
+            const double sync = std::chrono::duration<double>(std::chrono::steady_clock::now() - syncStart).count();
+
+            peakHeap  = std::max<int64_t>(
+                peakHeap, fhebench::g_allocationCounters.peakLiveBytes.load(std::memory_order_relaxed) - liveBefore);
+            peakRssKB = std::max<int64_t>(peakRssKB, fhebench::PeakRssKB() - rssBefore);
+            latency.Merge(stats.endToEnd);
+            streamSeconds += stats.seconds + sync;
+            syncSeconds += sync;
+            if (stages.empty()) {
+                stages = std::move(stats.stages);
+                continue;
+            }
+            for (size_t s = 0; s < stages.size(); ++s)
+                stages[s].service.Merge(stats.stages[s].service);
+        }
+    }
+    close(input);
+
+    // Read the middle record back without parsing the file and compare it to its input.
+    double readbackBits = 0;
+    {
+        fhebench::RecordFileReader reader(outputPath);
+        const size_t index = numRecords / 2;
+        size_t length;
+        const char* payload = reader.Record(index, &length);
+        fhebench::MemoryStreamBuf buffer(payload, length);
+        std::istream in(&buffer);
+        Ciphertext<DCRTPoly> ciphertext;
+        Serial::Deserialize(ciphertext, in, SerType::BINARY);
+        Plaintext result;
+        cryptoContext->Decrypt(setup.keyPair.secretKey, ciphertext, &result);
+        result->SetLength(numSlots);
+
+        std::vector<double> expected(numSlots);
+        std::ifstream source(inputPath, std::ios::binary);
+        source.seekg(static_cast<std::streamoff>(index * recordBytes));
+        source.read(reinterpret_cast<char*>(expected.data()), static_cast<std::streamsize>(recordBytes));
+        readbackBits = fhebench::CalculateApproximationError(
+            result->GetCKKSPackedValue(), std::vector<std::complex<double>>(expected.begin(), expected.end()));
+    }
+
+    double totalSeconds = syncSeconds;
+    double ioSeconds    = syncSeconds;
+    for (const auto& stage : stages) {
+        totalSeconds += stage.service.Sum() * 1e-9;
+        if (IsIOStage(stage.name))
+            ioSeconds += stage.service.Sum() * 1e-9;
+    }
+    for (const auto& stage : stages)
+        state.counters[stage.name + "_share"] = stage.service.Sum() * 1e-9 / totalSeconds;
+
+    const double iterations         = static_cast<double>(state.iterations());
+    state.counters["Ops"]           = static_cast<double>(numRecords);
+    state.counters["Slots"]         = numSlots;
+    state.counters["In_MBps"]       = iterations * numRecords * recordBytes / streamSeconds / 1e6;
+    state.counters["Out_MBps"]      = outputBytes / streamSeconds / 1e6;
+    state.counters["Sync_s"]        = syncSeconds / iterations;
+    state.counters["IO_share"]      = ioSeconds / totalSeconds;
+    state.counters["Peak_heap_MB"]  = peakHeap / 1048576.0;
+    state.counters["Peak_RSS_MB"]   = peakRssKB / 1024.0;
+    state.counters["Readback_bits"] = readbackBits;
+}
+
+// The same batch, workers and queue over 4x the input: the memory counters should not move.
+BENCHMARK_REGISTER_F(StreamingCKKSBootstrap, FileToFile)
+    ->ArgNames({"logN", "slots", "levelBudget", "iterations", "records", "batch", "workers", "queue"})
+    ->Args({12, 8, 3, 1, 64, 4, 1, 2})
+    ->Args({12, 8, 3, 1, 256, 4, 1, 2})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+FHEBENCH_MAIN();
@@ -0,0 +1,311 @@
+/*
+ * Core-type aware thread placement for hybrid CPUs, such as the i5-1235U of the
+ * published numbers (2 performance cores with two hardware threads each, 8 efficiency
+ * cores), where runs otherwise vary with the cores the OS happens to pick.
+ *
+ * CpuTopology reads /sys/devices/system/cpu: the online cpus, the physical core of
+ * each (topology/core_cpus_list, thread_siblings_list on older kernels) and its type.
+ * The type comes from the hybrid PMU lists /sys/devices/cpu_core/cpus and
+ * /sys/devices/cpu_atom/cpus when the kernel provides them; otherwise cores whose
+ * cpu_capacity (ARM big.LITTLE) or cpufreq/cpuinfo_max_freq is below the highest are
+ * efficiency cores, and on a homogeneous CPU every core is a performance core.
+ *
+ * FHEBENCH_AFFINITY selects the policy, applied once per process on first use, at the
+ * latest when FHEBENCH_MAIN() starts:
+ *
+ *   p         the P-cores, all their hardware threads
+ *   e         the E-cores
+ *   mixed     every core, P and E cores alternating
+ *   physical  one hardware thread of every physical core (no SMT siblings)
+ *
+ * Unset or "none" leaves placement to the OS. Otherwise the process is restricted to
+ * the policy's cpus, and OpenMP runs one thread per cpu, with thread t of the top-level
+ * team pinned to the t-th cpu. The cpus are ordered so that small thread counts use
+ * distinct cores first. The main thread (OpenMP thread 0) and the threads it starts,
+ * such as Google Benchmark's and the WorkStealingPool's, may run on any of the cpus:
+ * pinning them one by one would also pin the OpenMP teams they start to a single cpu.
+ * AvailableThreads() is the cpu count to size thread sweeps by. The policy and its cpus
+ * go into the result file metadata; FHEBENCH_SYSFS_ROOT (default /sys/devices) points
+ * the topology at a fake tree.
+ */
+
+#ifndef FHEBENCH_COMMON_AFFINITY_H
+#define FHEBENCH_COMMON_AFFINITY_H
+
+#include <sched.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fhebench {
+
+inline std::string SysfsRoot() {
+    const char* root = std::getenv("FHEBENCH_SYSFS_ROOT");
+    return (root != nullptr && *root != '\0') ? std::string(root) : std::string("/sys/devices");
+}
+
+// Parses the kernel's cpu list format, e.g. "0-3,8,10-11".
+inline std::vector<int> ParseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        size_t dash       = range.find('-');
+        if (!range.empty()) {
+            int first = std::atoi(range.c_str());
+            int last  = (dash == std::string::npos) ? first : std::atoi(range.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+// The inverse of ParseCpuList, keeping the given order: "0,4,1,5" or "0-3".
+inline std::string FormatCpuList(const std::vector<int>& cpus) {
+    std::string out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            ++j;
+        out += (out.empty() ? "" : ",") + std::to_string(cpus[i]);
+        if (j > i)
+            out += (j == i + 1 ? "," : "-") + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return out;
+}
+
+struct PhysicalCore {
+    enum Type { PERFORMANCE, EFFICIENCY };
+
+    Type type = PERFORMANCE;
+    std::vector<int> cpus;  // hardware threads, ascending
+};
+
+class CpuTopology {
+public:
+    static CpuTopology Detect(const std::string& root = SysfsRoot()) {
+        CpuTopology topology;
+        const std::string cpuDir      = root + "/system/cpu";
+        const std::vector<int> online = ParseCpuList(ReadLine(cpuDir + "/online"));
+
+        // Physical cores by their first hardware thread.
+        std::map<int, PhysicalCore> cores;
+        for (int cpu : online) {
+            const std::string topologyDir = cpuDir + "/cpu" + std::to_string(cpu) + "/topology";
+            std::vector<int> siblings     = ParseCpuList(ReadLine(topologyDir + "/core_cpus_list"));
+            if (siblings.empty())
+                siblings = ParseCpuList(ReadLine(topologyDir + "/thread_siblings_list"));
+            siblings.erase(std::remove_if(siblings.begin(), siblings.end(),
+                                          [&](int c) {
+                                              return std::find(online.begin(), online.end(), c) == online.end();
+                                          }),
+                           siblings.end());
+            if (std::find(siblings.begin(), siblings.end(), cpu) == siblings.end())
+                siblings = {cpu};
+            PhysicalCore& core = cores[*std::min_element(siblings.begin(), siblings.end())];
+            core.cpus          = siblings;
+            std::sort(core.cpus.begin(), core.cpus.end());
+        }
+
+        const std::vector<int> atom = ParseCpuList(ReadLine(root + "/cpu_atom/cpus"));
+        if (!atom.empty() && !ReadLine(root + "/cpu_core/cpus").empty()) {
+            topology.m_source = "cpu_core/cpu_atom";
+            for (auto& entry : cores) {
+                if (std::find(atom.begin(), atom.end(), entry.first) != atom.end())
+                    entry.second.type = PhysicalCore::EFFICIENCY;
+            }
+        }
+        else {
+            // Lower capacity, or lower maximum frequency, than the fastest core.
+            for (const char* file : {"cpu_capacity", "cpufreq/cpuinfo_max_freq"}) {
+                std::map<int, double> rank;
+                double highest = 0;
+                for (const auto& entry : cores) {
+                    std::string value =
+                        ReadLine(cpuDir + "/cpu" + std::to_string(entry.first) + "/" + std::string(file));
+                    if (value.empty())
+                        break;
+                    rank[entry.first] = std::strtod(value.c_str(), nullptr);
+                    highest           = std::max(highest, rank[entry.first]);
+                }
+                if (rank.size() != cores.size() || highest <= 0)
+                    continue;
+                topology.m_source = file;
+                for (auto& entry : cores) {
+                    // cpuinfo_max_freq of P-cores differs by a few turbo bins; E-cores are
+                    // well below all of them.
+                    if (rank[entry.first] < 0.85 * highest)
+                        entry.second.type = PhysicalCore::EFFICIENCY;
+                }
+                break;
+            }
+        }
+
+        for (auto& entry : cores)
+            topology.m_cores.push_back(entry.second);
+        return topology;
+    }
+
+    const std::vector<PhysicalCore>& Cores() const {
+        return m_cores;
+    }
+    // The file the core types were told apart by; empty when none was readable.
+    const std::string& Source() const {
+        return m_source;
+    }
+
+    std::vector<int> Cpus(PhysicalCore::Type type) const {
+        std::vector<int> cpus;
+        for (const auto& core : m_cores) {
+            if (core.type == type)
+                cpus.insert(cpus.end(), core.cpus.begin(), core.cpus.end());
+        }
+        std::sort(cpus.begin(), cpus.end());
+        return cpus;
+    }
+
+    /*
+     * The cpus of a policy (see the top of the file) in thread order: the first hardware
+     * thread of every selected core, then the second ones, and so on. mixed and physical
+     * alternate P and E cores. Empty for an unknown policy or one without cores here.
+     */
+    std::vector<int> PolicyCpus(const std::string& policy) const {
+        std::vector<const PhysicalCore*> performance, efficiency, selected;
+        for (const auto& core : m_cores)
+            (core.type == PhysicalCore::PERFORMANCE ? performance : efficiency).push_back(&core);
+        if (policy == "p") {
+            selected = performance;
+        }
+        else if (policy == "e") {
+            selected = efficiency;
+        }
+        else if (policy == "mixed" || policy == "physical") {
+            for (size_t i = 0; i < std::max(performance.size(), efficiency.size()); ++i) {
+                if (i < performance.size())
+                    selected.push_back(performance[i]);
+                if (i < efficiency.size())
+                    selected.push_back(efficiency[i]);
+            }
+        }
+        else {
+            return {};
+        }
+
+        // physical takes the first round only.
+        std::vector<int> cpus;
+        for (size_t thread = 0;; ++thread) {
+            const size_t before = cpus.size();
+            for (const PhysicalCore* core : selected) {
+                if (thread < core->cpus.size())
+                    cpus.push_back(core->cpus[thread]);
+            }
+            if (cpus.size() == before || policy == "physical")
+                break;
+        }
+        return cpus;
+    }
+
+private:
+    static std::string ReadLine(const std::string& file) {
+        std::ifstream in(file);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    std::vector<PhysicalCore> m_cores;
+    std::string m_source;
+};
+
+inline bool PinCurrentThread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+struct AffinityState {
+    std::string policy = "none";
+    std::vector<int> cpus;  // in thread order; empty without a policy
+    std::string performanceCpus;
+    std::string efficiencyCpus;
+    std::string typeSource;
+};
+
+/*
+ * The policy of FHEBENCH_AFFINITY, applied on first use. Failures (an unknown policy,
+ * no cores of the requested type, sched_setaffinity refused) are printed once and leave
+ * the placement to the OS, recorded as policy "none".
+ */
+inline const AffinityState& CurrentAffinity() {
+    static const AffinityState state = [] {
+        AffinityState result;
+        const CpuTopology topology = CpuTopology::Detect();
+        result.performanceCpus     = FormatCpuList(topology.Cpus(PhysicalCore::PERFORMANCE));
+        result.efficiencyCpus      = FormatCpuList(topology.Cpus(PhysicalCore::EFFICIENCY));
+        result.typeSource          = topology.Source();
+
+        const char* env    = std::getenv("FHEBENCH_AFFINITY");
+        std::string policy = (env != nullptr) ? env : "";
+        if (policy.empty() || policy == "none")
+            return result;
+        std::vector<int> cpus = topology.PolicyCpus(policy);
+        if (cpus.empty()) {
+            std::cerr << "FHEBENCH_AFFINITY=" << policy
+                      << ": unknown policy (p, e, mixed, physical, none) or no such cores on this CPU; "
+                         "threads are not pinned"
+                      << std::endl;
+            return result;
+        }
+        if (!PinCurrentThread(cpus)) {
+            std::cerr << "FHEBENCH_AFFINITY=" << policy << ": sched_setaffinity(" << FormatCpuList(cpus)
+                      << ") failed: " << std::strerror(errno) << "; threads are not pinned" << std::endl;
+            return result;
+        }
+#ifdef _OPENMP
+        const int numThreads = static_cast<int>(cpus.size());
+        omp_set_num_threads(numThreads);
+#pragma omp parallel num_threads(numThreads)
+        {
+            const int thread = omp_get_thread_num();
+            if (thread > 0)
+                PinCurrentThread({cpus[thread]});
+        }
+#endif
+        result.policy = policy;
+        result.cpus   = cpus;
+        return result;
+    }();
+    return state;
+}
+
+// Threads to size parallel sweeps by: the policy's cpus, or all hardware threads.
+inline unsigned AvailableThreads() {
+    const AffinityState& affinity = CurrentAffinity();
+    if (!affinity.cpus.empty())
+        return static_cast<unsigned>(affinity.cpus.size());
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_AFFINITY_H
@@ -0,0 +1,240 @@
+/*
+ * Package and DRAM energy measurement through the Linux powercap (RAPL) interface.
+ *
+ * Every intel-rapl:* zone under the powercap root exposes a monotonically increasing
+ * energy_uj counter that wraps at max_energy_range_uj. We sample all package-* and dram
+ * zones before and after the timed loop and convert the difference into joules per
+ * iteration (Energy_J, DRAM_J) and average watts (Power_W), which the patched
+ * console_reporter.cc prints in its Power_W/Energy_J columns.
+ *
+ * The root defaults to /sys/class/powercap and can be overridden with the
+ * FHEBENCH_RAPL_ROOT environment variable (or the RaplSampler constructor), so a fake
+ * tree with the same layout can stand in for the real one. When no readable zone is
+ * found (no Intel RAPL, a VM, or energy_uj restricted to root) the counters are left
+ * unset and the reporter prints "n/a" instead of a misleading 0.00.
+ */
+
+#ifndef FHEBENCH_COMMON_ENERGY_H
+#define FHEBENCH_COMMON_ENERGY_H
+
+#include "benchmark/benchmark.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fhebench {
+
+inline std::string RaplRoot() {
+    const char* root = std::getenv("FHEBENCH_RAPL_ROOT");
+    return (root != nullptr && *root != '\0') ? std::string(root) : std::string("/sys/class/powercap");
+}
+
+struct RaplDomain {
+    enum Kind { PACKAGE, DRAM };
+
+    Kind kind;
+    std::string name;
+    std::string energyFile;
+    uint64_t maxRangeUJ;
+};
+
+struct EnergySample {
+    std::vector<uint64_t> counters;  // energy_uj of each domain, in RaplSampler::Domains() order
+    std::chrono::steady_clock::time_point when;
+};
+
+struct EnergyReading {
+    bool available = false;
+    double packageJ = 0;
+    double dramJ    = 0;
+    double seconds  = 0;
+
+    double TotalJ() const {
+        return packageJ + dramJ;
+    }
+    double Watts() const {
+        return (seconds > 0) ? TotalJ() / seconds : 0;
+    }
+};
+
+class RaplSampler {
+public:
+    explicit RaplSampler(const std::string& root = RaplRoot()) : m_root(root) {
+        DIR* dir = opendir(root.c_str());
+        if (dir == nullptr)
+            return;
+        std::vector<std::string> zones;
+        while (struct dirent* entry = readdir(dir)) {
+            // intel-rapl:N is a package, intel-rapl:N:M one of its subzones. The
+            // intel-rapl-mmio:* zones mirror the package counters and are skipped to
+            // avoid double counting.
+            std::string zone(entry->d_name);
+            if (zone.compare(0, 11, "intel-rapl:") == 0)
+                zones.push_back(zone);
+        }
+        closedir(dir);
+        std::sort(zones.begin(), zones.end());
+
+        for (const auto& zone : zones) {
+            std::string path = root + "/" + zone;
+            std::string name = ReadLine(path + "/name");
+            RaplDomain domain;
+            if (name.compare(0, 7, "package") == 0)
+                domain.kind = RaplDomain::PACKAGE;
+            else if (name == "dram")
+                domain.kind = RaplDomain::DRAM;
+            else
+                continue;  // core/uncore are already part of the package, psys overlaps it
+            domain.name       = name;
+            domain.energyFile = path + "/energy_uj";
+            domain.maxRangeUJ = std::strtoull(ReadLine(path + "/max_energy_range_uj").c_str(), nullptr, 10);
+            uint64_t probe;
+            if (ReadCounter(domain.energyFile, &probe))
+                m_domains.push_back(domain);
+        }
+    }
+
+    bool Available() const {
+        return !m_domains.empty();
+    }
+    const std::string& Root() const {
+        return m_root;
+    }
+    const std::vector<RaplDomain>& Domains() const {
+        return m_domains;
+    }
+
+    EnergySample Sample() const {
+        EnergySample sample;
+        sample.counters.reserve(m_domains.size());
+        for (const auto& domain : m_domains) {
+            uint64_t value = 0;
+            ReadCounter(domain.energyFile, &value);
+            sample.counters.push_back(value);
+        }
+        sample.when = std::chrono::steady_clock::now();
+        return sample;
+    }
+
+    EnergyReading Delta(const EnergySample& begin, const EnergySample& end) const {
+        EnergyReading reading;
+        reading.seconds = std::chrono::duration<double>(end.when - begin.when).count();
+        if (!Available() || begin.counters.size() != m_domains.size() || end.counters.size() != m_domains.size())
+            return reading;
+        reading.available = true;
+        for (size_t i = 0; i < m_domains.size(); ++i) {
+            // A single wrap is assumed: at package power in the tens of watts the
+            // counters take hours to go around once.
+            uint64_t delta = (end.counters[i] >= begin.counters[i]) ?
+                                 end.counters[i] - begin.counters[i] :
+                                 m_domains[i].maxRangeUJ - begin.counters[i] + end.counters[i];
+            double joules = static_cast<double>(delta) * 1e-6;
+            if (m_domains[i].kind == RaplDomain::PACKAGE)
+                reading.packageJ += joules;
+            else
+                reading.dramJ += joules;
+        }
+        return reading;
+    }
+
+private:
+    static std::string ReadLine(const std::string& file) {
+        std::ifstream in(file);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    static bool ReadCounter(const std::string& file, uint64_t* value) {
+        std::ifstream in(file);
+        return static_cast<bool>(in >> *value);
+    }
+
+    std::string m_root;
+    std::vector<RaplDomain> m_domains;
+};
+
+// The zones are enumerated once per process.
+inline const RaplSampler& DefaultRaplSampler() {
+    static const RaplSampler sampler;
+    static const bool reported = [] {
+        if (!sampler.Available())
+            std::cerr << "RAPL energy counters unavailable under " << sampler.Root()
+                      << "; Power_W and Energy_J are reported as n/a" << std::endl;
+        return true;
+    }();
+    (void)reported;
+    return sampler;
+}
+
+// Human-readable form for the standalone example programs.
+inline std::string FormatEnergy(const EnergyReading& reading) {
+    if (!reading.available)
+        return "unavailable (no readable RAPL counters)";
+    return std::to_string(reading.TotalJ()) + " J (package " + std::to_string(reading.packageJ) + " J, dram " +
+           std::to_string(reading.dramJ) + " J, " + std::to_string(reading.Watts()) + " W)";
+}
+
+/*
+ * Construct right before `for (auto _ : state)`; on destruction the energy spent in
+ * the loop is published as the Energy_J/DRAM_J (joules per iteration) and Power_W
+ * (average watts) counters. Untimed work in the loop goes in an UntimedScope (untimed.h),
+ * which pauses these counters with the timer. Nothing is published when RAPL is
+ * unavailable.
+ */
+class EnergyCounters {
+public:
+    explicit EnergyCounters(benchmark::State& state)
+        : m_state(state), m_sampler(DefaultRaplSampler()), m_begin(m_sampler.Sample()) {}
+
+    void Pause() {
+        if (m_paused)
+            return;
+        Accumulate(m_sampler.Delta(m_begin, m_sampler.Sample()));
+        m_paused = true;
+    }
+    void Resume() {
+        if (!m_paused)
+            return;
+        m_begin  = m_sampler.Sample();
+        m_paused = false;
+    }
+
+    ~EnergyCounters() {
+        Pause();
+        if (!m_total.available)
+            return;
+        m_state.counters["Energy_J"] = benchmark::Counter(m_total.TotalJ(), benchmark::Counter::kAvgIterations);
+        m_state.counters["DRAM_J"]   = benchmark::Counter(m_total.dramJ, benchmark::Counter::kAvgIterations);
+        m_state.counters["Power_W"]  = m_total.Watts();
+    }
+
+    EnergyCounters(const EnergyCounters&)            = delete;
+    EnergyCounters& operator=(const EnergyCounters&) = delete;
+
+private:
+    void Accumulate(const EnergyReading& reading) {
+        m_total.available = reading.available;
+        m_total.packageJ += reading.packageJ;
+        m_total.dramJ += reading.dramJ;
+        m_total.seconds += reading.seconds;
+    }
+
+    benchmark::State& m_state;
+    const RaplSampler& m_sampler;
+    EnergySample m_begin;
+    EnergyReading m_total;
+    bool m_paused = false;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_ENERGY_H
@@ -0,0 +1,174 @@
+/*
+ * The clock frequency the cores actually ran at during a timed loop, from cpufreq.
+ *
+ * FrequencySampler reads scaling_cur_freq of a set of cpus from a background thread
+ * every few milliseconds; the kernel's value is itself an average over roughly the last
+ * scheduler tick (APERF/MPERF on x86), so short dips are smoothed out. The sampling
+ * thread wakes for a few microseconds per sample.
+ *
+ * FrequencyCounters samples the cpus of the affinity policy (affinity.h), or all online
+ * cpus without one, while it lives and publishes
+ *
+ *   MHz       the mean over samples and cpus
+ *   MHz_peak  the mean over samples of the fastest cpu, i.e. the one running a
+ *             single-threaded loop while the others idle
+ *   MHz_min   the lowest per-sample mean, which shows throttling during the loop
+ *
+ * Without cpufreq (most VMs) nothing is published.
+ */
+
+#ifndef FHEBENCH_COMMON_FREQUENCY_H
+#define FHEBENCH_COMMON_FREQUENCY_H
+
+#include "benchmark/benchmark.h"
+
+#include "affinity.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fhebench {
+
+struct FrequencyStats {
+    size_t samples = 0;
+    double meanMHz = 0;
+    double peakMHz = 0;
+    double minMHz  = 0;
+};
+
+class FrequencySampler {
+public:
+    explicit FrequencySampler(const std::vector<int>& cpus,
+                              std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+        : m_interval(interval) {
+        for (int cpu : cpus) {
+            std::string file = SysfsRoot() + "/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/scaling_cur_freq";
+            if (ReadKHz(file) > 0)
+                m_files.push_back(file);
+        }
+        if (!m_files.empty())
+            m_thread = std::thread(&FrequencySampler::Run, this);
+    }
+
+    ~FrequencySampler() {
+        Stop();
+    }
+
+    FrequencySampler(const FrequencySampler&)            = delete;
+    FrequencySampler& operator=(const FrequencySampler&) = delete;
+
+    bool Available() const {
+        return !m_files.empty();
+    }
+
+    // Takes a last sample and stops the thread; later calls return the same result.
+    FrequencyStats Stop() {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            m_thread.join();
+            Sample();
+        }
+        FrequencyStats stats;
+        stats.samples = m_samples;
+        if (m_samples > 0) {
+            stats.meanMHz = m_sumMean / m_samples / 1000.0;
+            stats.peakMHz = m_sumPeak / m_samples / 1000.0;
+            stats.minMHz  = m_minMean / 1000.0;
+        }
+        return stats;
+    }
+
+    // All online cpus, for runs without an affinity policy.
+    static std::vector<int> OnlineCpus() {
+        std::ifstream in(SysfsRoot() + "/system/cpu/online");
+        std::string list;
+        std::getline(in, list);
+        return ParseCpuList(list);
+    }
+
+private:
+    static double ReadKHz(const std::string& file) {
+        std::ifstream in(file);
+        double kHz = 0;
+        in >> kHz;
+        return kHz;
+    }
+
+    void Sample() {
+        double sum  = 0;
+        double peak = 0;
+        for (const auto& file : m_files) {
+            double kHz = ReadKHz(file);
+            sum += kHz;
+            peak = std::max(peak, kHz);
+        }
+        const double mean = sum / static_cast<double>(m_files.size());
+        m_sumMean += mean;
+        m_sumPeak += peak;
+        m_minMean = std::min(m_minMean, mean);
+        ++m_samples;
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop) {
+            Sample();
+            m_wake.wait_for(lock, m_interval, [&] { return m_stop; });
+        }
+    }
+
+    std::chrono::milliseconds m_interval;
+    std::vector<std::string> m_files;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    // Written by the sampling thread until Stop() has joined it.
+    size_t m_samples = 0;
+    double m_sumMean = 0;
+    double m_sumPeak = 0;
+    double m_minMean = std::numeric_limits<double>::max();
+};
+
+/*
+ * Construct right before `for (auto _ : state)`, next to the EnergyCounters; on
+ * destruction MHz, MHz_peak and MHz_min of the loop are published.
+ */
+class FrequencyCounters {
+public:
+    explicit FrequencyCounters(benchmark::State& state)
+        : m_state(state),
+          m_sampler(CurrentAffinity().cpus.empty() ? FrequencySampler::OnlineCpus() : CurrentAffinity().cpus) {}
+
+    ~FrequencyCounters() {
+        FrequencyStats stats = m_sampler.Stop();
+        if (stats.samples == 0)
+            return;
+        m_state.counters["MHz"]      = stats.meanMHz;
+        m_state.counters["MHz_peak"] = stats.peakMHz;
+        m_state.counters["MHz_min"]  = stats.minMHz;
+    }
+
+    FrequencyCounters(const FrequencyCounters&)            = delete;
+    FrequencyCounters& operator=(const FrequencyCounters&) = delete;
+
+private:
+    benchmark::State& m_state;
+    FrequencySampler m_sampler;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_FREQUENCY_H
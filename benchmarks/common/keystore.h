@@ -0,0 +1,210 @@
+/*
+ * On-disk cache for crypto contexts and evaluation/bootstrapping keys.
+ *
+ * Key generation dominates the start-up of every benchmark binary, so the scheme-specific
+ * setup code serializes the context and keys into a single binary file and later runs load
+ * it back instead. A file is identified by a free-form description of everything that
+ * determines the keys (parameter set, bootstrapping method, library version, ...); its
+ * FNV-1a hash names the file, and the description itself is stored in the header and
+ * compared on load to rule out collisions. Files are read through a memory mapping and
+ * written to a temporary name first, so an interrupted run never leaves a truncated entry.
+ *
+ * FHEBENCH_KEY_CACHE selects the directory (default: .fhebench-keys in the working
+ * directory); setting it to "off" disables the cache. The files contain secret keys and
+ * are meant for benchmarking only.
+ */
+
+#ifndef FHEBENCH_COMMON_KEYSTORE_H
+#define FHEBENCH_COMMON_KEYSTORE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <istream>
+#include <streambuf>
+#include <string>
+
+namespace fhebench {
+
+// Read-only view of a whole file; empty if the file cannot be opened or mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                m_data = static_cast<const char*>(data);
+                m_size = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (m_data != nullptr)
+            munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* Data() const {
+        return m_data;
+    }
+    size_t Size() const {
+        return m_size;
+    }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size      = 0;
+};
+
+// Lets std::istream-based deserializers read straight from mapped memory.
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* data, size_t size) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+        char* target = (dir == std::ios_base::beg) ? eback() + off : (dir == std::ios_base::cur) ? gptr() + off : egptr() + off;
+        if (target < eback() || target > egptr())
+            return pos_type(off_type(-1));
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+// Discards what is written and counts the bytes, to size serialized objects without
+// holding them in memory.
+class CountingStreamBuf : public std::streambuf {
+public:
+    uint64_t Count() const {
+        return m_count;
+    }
+
+protected:
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        m_count += static_cast<uint64_t>(n);
+        return n;
+    }
+
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            ++m_count;
+        return traits_type::not_eof(c);
+    }
+
+private:
+    uint64_t m_count = 0;
+};
+
+class KeyStore {
+public:
+    static std::string Directory() {
+        const char* dir = std::getenv("FHEBENCH_KEY_CACHE");
+        return (dir != nullptr && *dir != '\0') ? std::string(dir) : std::string(".fhebench-keys");
+    }
+
+    static bool Enabled() {
+        return Directory() != "off";
+    }
+
+    static uint64_t Hash(const std::string& description) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : description) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    static std::string PathFor(const std::string& description) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(Hash(description)));
+        return Directory() + "/" + name;
+    }
+
+    /*
+     * Calls reader on the stored payload for description. Returns false, without calling
+     * reader, when the cache is disabled or has no matching entry, and also when reader
+     * throws (e.g. the entry was written by an incompatible library build); the caller
+     * then regenerates and stores a fresh entry.
+     */
+    static bool Load(const std::string& description, const std::function<void(std::istream&)>& reader) {
+        if (!Enabled())
+            return false;
+        std::string path = PathFor(description);
+        MappedFile file(path);
+        std::string header = Header(description);
+        if (file.Size() < header.size() || std::memcmp(file.Data(), header.data(), header.size()) != 0)
+            return false;
+
+        MemoryStreamBuf buffer(file.Data() + header.size(), file.Size() - header.size());
+        std::istream in(&buffer);
+        try {
+            reader(in);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "ignoring unreadable key cache entry " << path << ": " << e.what() << std::endl;
+            return false;
+        }
+        return static_cast<bool>(in);
+    }
+
+    static bool Store(const std::string& description, const std::function<void(std::ostream&)>& writer) {
+        if (!Enabled())
+            return false;
+        std::string dir = Directory();
+        mkdir(dir.c_str(), 0700);
+        std::string path = PathFor(description);
+        std::string tmp  = path + ".tmp." + std::to_string(getpid());
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "cannot write key cache entry " << tmp << std::endl;
+                return false;
+            }
+            out << Header(description);
+            writer(out);
+            if (!out.flush()) {
+                std::remove(tmp.c_str());
+                return false;
+            }
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    static std::string Header(const std::string& description) {
+        return "FHEBKEYS1\n" + description + "\n";
+    }
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_KEYSTORE_H
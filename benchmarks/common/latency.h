@@ -0,0 +1,185 @@
+/*
+ * Per-iteration latency distribution of the timed loops.
+ *
+ * Google Benchmark only reports the mean time of an iteration, which hides the tail of
+ * operations such as bootstrapping whose cost varies from call to call. LatencyRecorder
+ * times every iteration into a LatencyHistogram and publishes its p50/p90/p99 and
+ * maximum, in seconds, as the Lat_p50/Lat_p90/Lat_p99/Lat_max counters that the patched
+ * console_reporter.cc prints in the time unit of the benchmark.
+ *
+ * The histogram is log-linear in the style of HdrHistogram: nanosecond values below 64
+ * are counted exactly, larger ones go into power-of-two ranges split into 32 linear
+ * sub-buckets. Recording is a bit scan and an increment into a fixed table, and every
+ * quantile is within 1/64 of the true value, from nanoseconds up to centuries.
+ */
+
+#ifndef FHEBENCH_COMMON_LATENCY_H
+#define FHEBENCH_COMMON_LATENCY_H
+
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace fhebench {
+
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    // Index(UINT64_MAX) is (63 - kSubBucketBits) * kSubBuckets + 2 * kSubBuckets - 1.
+    static constexpr size_t kNumBuckets = (65 - kSubBucketBits) * kSubBuckets;
+
+    void Record(uint64_t ns) {
+        ++m_counts[Index(ns)];
+        ++m_count;
+        m_sum += ns;
+        m_min = std::min(m_min, ns);
+        m_max = std::max(m_max, ns);
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kNumBuckets; ++i)
+            m_counts[i] += other.m_counts[i];
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    uint64_t Count() const {
+        return m_count;
+    }
+    // Exact total of the recorded values.
+    uint64_t Sum() const {
+        return m_sum;
+    }
+    uint64_t Min() const {
+        return m_count ? m_min : 0;
+    }
+    uint64_t Max() const {
+        return m_max;
+    }
+
+    // Smallest recorded value v such that a fraction q of the samples is <= v, up to
+    // the bucket resolution (the midpoint of the bucket is returned).
+    uint64_t Quantile(double q) const {
+        if (m_count == 0)
+            return 0;
+        q             = std::min(std::max(q, 0.0), 1.0);
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * m_count)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kNumBuckets; ++i) {
+            seen += m_counts[i];
+            if (seen >= rank) {
+                uint64_t value = LowerBound(i) + Width(i) / 2;
+                return std::min(std::max(value, m_min), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    static size_t Index(uint64_t ns) {
+        if (ns < 2 * kSubBuckets)
+            return static_cast<size_t>(ns);
+        int shift = 63 - __builtin_clzll(ns) - kSubBucketBits;
+        return static_cast<size_t>(shift) * kSubBuckets + static_cast<size_t>(ns >> shift);
+    }
+
+    static uint64_t LowerBound(size_t index) {
+        if (index < 2 * kSubBuckets)
+            return index;
+        int shift = static_cast<int>(index / kSubBuckets) - 1;
+        return static_cast<uint64_t>(index % kSubBuckets + kSubBuckets) << shift;
+    }
+
+    static uint64_t Width(size_t index) {
+        return (index < 2 * kSubBuckets) ? 1 : uint64_t(1) << (index / kSubBuckets - 1);
+    }
+
+private:
+    std::array<uint64_t, kNumBuckets> m_counts{};
+    uint64_t m_count = 0;
+    uint64_t m_sum   = 0;
+    uint64_t m_min   = UINT64_MAX;
+    uint64_t m_max   = 0;
+};
+
+/*
+ * Construct next to the EnergyCounters before `for (auto _ : state)` and time the part
+ * of each iteration that the benchmark times, i.e. after any ResumeTiming():
+ *
+ *     fhebench::LatencyRecorder latency(state);
+ *     for (auto _ : state) {
+ *         auto sample = latency.Measure();
+ *         cc.EvalBinGate(gate, ct1, ct2);
+ *     }
+ *
+ * Benchmarks that run several operations per iteration pass their number as
+ * opsPerSample to get per-operation figures. The counters are published on
+ * destruction, and only if something was recorded.
+ */
+class LatencyRecorder {
+public:
+    class Sample {
+    public:
+        explicit Sample(LatencyRecorder& recorder)
+            : m_recorder(recorder), m_start(std::chrono::steady_clock::now()) {}
+
+        ~Sample() {
+            m_recorder.Record(std::chrono::steady_clock::now() - m_start);
+        }
+
+        Sample(const Sample&)            = delete;
+        Sample& operator=(const Sample&) = delete;
+
+    private:
+        LatencyRecorder& m_recorder;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    explicit LatencyRecorder(benchmark::State& state, double opsPerSample = 1)
+        : m_state(state), m_opsPerSample(opsPerSample) {}
+
+    ~LatencyRecorder() {
+        if (m_histogram.Count() == 0)
+            return;
+        const double scale          = 1e-9 / m_opsPerSample;
+        m_state.counters["Lat_p50"] = m_histogram.Quantile(0.50) * scale;
+        m_state.counters["Lat_p90"] = m_histogram.Quantile(0.90) * scale;
+        m_state.counters["Lat_p99"] = m_histogram.Quantile(0.99) * scale;
+        m_state.counters["Lat_max"] = m_histogram.Max() * scale;
+    }
+
+    LatencyRecorder(const LatencyRecorder&)            = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    Sample Measure() {
+        return Sample(*this);
+    }
+
+    void Record(std::chrono::steady_clock::duration elapsed) {
+        m_histogram.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    // Adds samples timed elsewhere, e.g. by the workers of a pipeline.
+    void Merge(const LatencyHistogram& histogram) {
+        m_histogram.Merge(histogram);
+    }
+
+    const LatencyHistogram& Histogram() const {
+        return m_histogram;
+    }
+
+private:
+    benchmark::State& m_state;
+    double m_opsPerSample;
+    LatencyHistogram m_histogram;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_LATENCY_H
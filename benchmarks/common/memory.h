@@ -0,0 +1,292 @@
+/*
+ * Heap allocation tracking and peak RSS for the benchmark binaries.
+ *
+ * Including this header replaces the global operator new/delete family with versions
+ * that count allocations, requested bytes and live heap bytes, and registers a
+ * benchmark::MemoryManager built on those counters. Google Benchmark then runs every
+ * benchmark once more with the manager active and hands the result to the reporter,
+ * which prints peak RSS (VmHWM from /proc/self/status, reset through clear_refs at the
+ * start of the run), allocations per iteration and kB allocated per iteration.
+ *
+ * The replacement operators cannot be inline, so this header must be included by
+ * exactly one translation unit of a binary -- the benchmark source itself.
+ *
+ * MemoryPhase covers code outside the timed loops, e.g. the key generation steps of the
+ * CKKS fixtures. It reports on stderr so the reporter's stdout stays machine-readable.
+ */
+
+#ifndef FHEBENCH_COMMON_MEMORY_H
+#define FHEBENCH_COMMON_MEMORY_H
+
+#include "benchmark/benchmark.h"
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace fhebench {
+
+struct AllocationCounters {
+    std::atomic<int64_t> allocs{0};
+    std::atomic<int64_t> frees{0};
+    std::atomic<int64_t> requestedBytes{0};
+    std::atomic<int64_t> liveBytes{0};
+    std::atomic<int64_t> peakLiveBytes{0};
+};
+
+// Constant-initialized, so it is usable by allocations made during static initialization.
+inline AllocationCounters g_allocationCounters;
+
+inline void RecordAllocation(void* ptr, size_t size) {
+    if (ptr == nullptr)
+        return;
+    auto& c = g_allocationCounters;
+    c.allocs.fetch_add(1, std::memory_order_relaxed);
+    c.requestedBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+    int64_t live = c.liveBytes.fetch_add(static_cast<int64_t>(malloc_usable_size(ptr)), std::memory_order_relaxed) +
+                   static_cast<int64_t>(malloc_usable_size(ptr));
+    int64_t peak = c.peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !c.peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+inline void RecordDeallocation(void* ptr) {
+    if (ptr == nullptr)
+        return;
+    auto& c = g_allocationCounters;
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+    c.liveBytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(ptr)), std::memory_order_relaxed);
+}
+
+struct AllocationSnapshot {
+    int64_t allocs;
+    int64_t requestedBytes;
+    int64_t liveBytes;
+
+    static AllocationSnapshot Take() {
+        const auto& c = g_allocationCounters;
+        return {c.allocs.load(std::memory_order_relaxed), c.requestedBytes.load(std::memory_order_relaxed),
+                c.liveBytes.load(std::memory_order_relaxed)};
+    }
+};
+
+// Value of a "Key:   123 kB" line of /proc/self/status, in kB; -1 if not present.
+inline int64_t ReadProcStatusKB(const std::string& key) {
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == ':')
+            return std::strtoll(line.c_str() + key.size() + 1, nullptr, 10);
+    }
+    return -1;
+}
+
+inline int64_t PeakRssKB() {
+    return ReadProcStatusKB("VmHWM");
+}
+
+inline int64_t CurrentRssKB() {
+    return ReadProcStatusKB("VmRSS");
+}
+
+// Resets VmHWM to the current RSS (Linux >= 4.0). If this fails the peak is the
+// process-wide peak so far, which still bounds the measured region from above.
+inline bool ResetPeakRss() {
+    std::ofstream out("/proc/self/clear_refs");
+    out << "5";
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+inline void ResetPeakLiveBytes() {
+    auto& c = g_allocationCounters;
+    c.peakLiveBytes.store(c.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// True while Google Benchmark's extra memory run is in progress, so that benchmarks
+// which drive their own repetitions (stability.h) can keep that run short.
+inline std::atomic<bool> g_memoryRunActive{false};
+
+/*
+ * max_bytes_used carries the peak RSS of the memory run in bytes (not the heap peak),
+ * since that is what runs the nodes out of memory; the heap figures come from the
+ * replaced allocation functions.
+ */
+class RssMemoryManager : public benchmark::MemoryManager {
+public:
+    void Start() override {
+        g_memoryRunActive.store(true, std::memory_order_relaxed);
+        ResetPeakRss();
+        ResetPeakLiveBytes();
+        m_begin = AllocationSnapshot::Take();
+    }
+
+    void Stop(Result& result) override {
+        AllocationSnapshot end       = AllocationSnapshot::Take();
+        result.num_allocs            = end.allocs - m_begin.allocs;
+        result.max_bytes_used        = PeakRssKB() * 1024;
+        result.total_allocated_bytes = end.requestedBytes - m_begin.requestedBytes;
+        result.net_heap_growth       = end.liveBytes - m_begin.liveBytes;
+        g_memoryRunActive.store(false, std::memory_order_relaxed);
+    }
+
+    // Google Benchmark releases before 1.8 declare only the pointer overload as pure.
+    void Stop(Result* result) override {
+        Stop(*result);
+    }
+
+private:
+    AllocationSnapshot m_begin{};
+};
+
+inline RssMemoryManager g_rssMemoryManager;
+inline const bool g_rssMemoryManagerRegistered =
+    (benchmark::RegisterMemoryManager(&g_rssMemoryManager), true);
+
+/*
+ * Prints what a named phase allocated to stderr when it goes out of scope:
+ *
+ *     {
+ *         fhebench::MemoryPhase phase("EvalBootstrapKeyGen");
+ *         cryptoContext->EvalBootstrapKeyGen(keyPair.secretKey, numSlots);
+ *     }
+ */
+class MemoryPhase {
+public:
+    explicit MemoryPhase(std::string name) : m_name(std::move(name)) {
+        ResetPeakRss();
+        ResetPeakLiveBytes();
+        m_rssBeginKB = CurrentRssKB();
+        m_begin      = AllocationSnapshot::Take();
+    }
+
+    ~MemoryPhase() {
+        AllocationSnapshot end = AllocationSnapshot::Take();
+        const double MB        = 1024.0 * 1024.0;
+        std::cerr << "memory of " << m_name << ": " << (end.allocs - m_begin.allocs) << " allocations, "
+                  << (end.requestedBytes - m_begin.requestedBytes) / MB << " MB allocated, net heap "
+                  << (end.liveBytes - m_begin.liveBytes) / MB << " MB, heap peak "
+                  << (g_allocationCounters.peakLiveBytes.load(std::memory_order_relaxed) - m_begin.liveBytes) / MB
+                  << " MB above start, peak RSS " << PeakRssKB() / 1024.0 << " MB (started at "
+                  << m_rssBeginKB / 1024.0 << " MB)" << std::endl;
+    }
+
+    MemoryPhase(const MemoryPhase&)            = delete;
+    MemoryPhase& operator=(const MemoryPhase&) = delete;
+
+private:
+    std::string m_name;
+    int64_t m_rssBeginKB;
+    AllocationSnapshot m_begin;
+};
+
+inline void* TrackedAlloc(size_t size) {
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    RecordAllocation(ptr, size);
+    return ptr;
+}
+
+inline void* TrackedAlignedAlloc(size_t size, std::align_val_t align) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, static_cast<size_t>(align), size == 0 ? 1 : size) != 0)
+        ptr = nullptr;
+    RecordAllocation(ptr, size);
+    return ptr;
+}
+
+// GCC flags free() on memory from the (inlined) replacement operator new as a mismatch,
+// although both sides go through malloc here.
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+inline void TrackedFree(void* ptr) noexcept {
+    RecordDeallocation(ptr);
+    std::free(ptr);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+}  // namespace fhebench
+
+// Replaceable global allocation functions ([new.delete]); the nothrow, array and sized
+// forms all funnel into the tracked allocator.
+
+void* operator new(size_t size) {
+    void* ptr = fhebench::TrackedAlloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return fhebench::TrackedAlloc(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return fhebench::TrackedAlloc(size);
+}
+void* operator new(size_t size, std::align_val_t align) {
+    void* ptr = fhebench::TrackedAlignedAlloc(size, align);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    return ::operator new(size, align);
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return fhebench::TrackedAlignedAlloc(size, align);
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return fhebench::TrackedAlignedAlloc(size, align);
+}
+
+void operator delete(void* ptr) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    fhebench::TrackedFree(ptr);
+}
+
+#endif  // FHEBENCH_COMMON_MEMORY_H
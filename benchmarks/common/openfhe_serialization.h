@@ -0,0 +1,42 @@
+/*
+ * SerializedObject (serialization.h) for any object OpenFHE's Serial can write and read
+ * back, shared by the CKKS and CGGI programs. Include the -ser.h headers of the serialized
+ * types before instantiating these.
+ */
+
+#ifndef FHEBENCH_COMMON_OPENFHE_SERIALIZATION_H
+#define FHEBENCH_COMMON_OPENFHE_SERIALIZATION_H
+
+#include "benchmark/benchmark.h"
+#include "utils/serial.h"
+
+#include "serialization.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace fhebench {
+
+// Writes a copy of object and reads it back into a new object of the same type.
+template <typename Object, typename ST>
+SerializedObject Serialized(const Object& object, const ST& sertype) {
+    SerializedObject serialized;
+    serialized.write = [object, sertype](std::ostream& out) { lbcrypto::Serial::Serialize(object, out, sertype); };
+    serialized.read  = [sertype](std::istream& in) {
+        Object copy;
+        lbcrypto::Serial::Deserialize(copy, in, sertype);
+        benchmark::DoNotOptimize(copy);
+    };
+    return serialized;
+}
+
+// Serialized size of object, e.g. of a uniformly random component for Seeded_bytes.
+template <typename Object, typename ST>
+uint64_t SerializedBytes(const Object& object, const ST& sertype) {
+    return SerializedSize([&](std::ostream& out) { lbcrypto::Serial::Serialize(object, out, sertype); });
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_OPENFHE_SERIALIZATION_H
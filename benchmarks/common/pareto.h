@@ -0,0 +1,42 @@
+/*
+ * Pareto frontier of a set of measured configurations, e.g. bootstrapping parameter
+ * sweeps trading precision against latency and remaining levels.
+ */
+
+#ifndef FHEBENCH_COMMON_PARETO_H
+#define FHEBENCH_COMMON_PARETO_H
+
+#include <cstddef>
+#include <vector>
+
+namespace fhebench {
+
+// True if a is at least as good as b in every objective and better in one; all
+// objectives are maximized (negate the ones to be minimized).
+inline bool Dominates(const std::vector<double>& a, const std::vector<double>& b) {
+    bool better = false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] < b[i])
+            return false;
+        if (a[i] > b[i])
+            better = true;
+    }
+    return better;
+}
+
+// Indices of the points that no other point dominates, in input order.
+inline std::vector<size_t> ParetoFrontier(const std::vector<std::vector<double>>& points) {
+    std::vector<size_t> frontier;
+    for (size_t i = 0; i < points.size(); ++i) {
+        bool dominated = false;
+        for (size_t j = 0; j < points.size() && !dominated; ++j)
+            dominated = (j != i) && Dominates(points[j], points[i]);
+        if (!dominated)
+            frontier.push_back(i);
+    }
+    return frontier;
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_PARETO_H
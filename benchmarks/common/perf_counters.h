@@ -0,0 +1,253 @@
+/*
+ * Hardware performance counters through perf_event_open, to tell compute-bound from
+ * memory-bound loops.
+ *
+ * PerfCounters opens one group of five events (cycles, instructions, last-level cache
+ * misses, dTLB load misses, branch misses) for every thread of the process when it is
+ * constructed, so the OpenMP and worker pools that already exist are counted, and with
+ * inherit set so threads started during the loop are counted too. A group is scheduled
+ * onto the PMU as a unit; when the kernel multiplexes groups, every value is scaled by
+ * time enabled / time running. Only user space is counted (exclude_kernel), which is
+ * what an unprivileged process may measure with perf_event_paranoid <= 2.
+ *
+ * On destruction the counts are published per iteration (Cycles, Instructions,
+ * LLC_misses, dTLB_misses, Branch_misses) together with IPC and misses per thousand
+ * instructions (LLC_MPKI, dTLB_MPKI, Branch_MPKI), which the patched
+ * console_reporter.cc prints as columns. Events the CPU or kernel does not offer (VMs
+ * often have no PMU at all) or that perf_event_paranoid forbids are left unset, and the
+ * reporter prints "n/a".
+ */
+
+#ifndef FHEBENCH_COMMON_PERF_COUNTERS_H
+#define FHEBENCH_COMMON_PERF_COUNTERS_H
+
+#include "benchmark/benchmark.h"
+
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fhebench {
+
+struct PerfEventSpec {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+// The first event leads each group.
+inline const std::vector<PerfEventSpec>& PerfEventSpecs() {
+    static const std::vector<PerfEventSpec> specs = {
+        {"Cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"Instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"LLC_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"dTLB_misses", PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {"Branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+    return specs;
+}
+
+inline int PerfEventOpen(const PerfEventSpec& spec, pid_t tid, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = spec.type;
+    attr.config         = spec.config;
+    attr.disabled       = (groupFd == -1) ? 1 : 0;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, groupFd, 0));
+}
+
+inline std::vector<pid_t> ProcessThreads() {
+    std::vector<pid_t> threads;
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr)
+        return {static_cast<pid_t>(syscall(SYS_gettid))};
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.')
+            threads.push_back(static_cast<pid_t>(std::atoi(entry->d_name)));
+    }
+    closedir(dir);
+    return threads;
+}
+
+inline int PerfEventParanoid() {
+    std::ifstream in("/proc/sys/kernel/perf_event_paranoid");
+    int level = 2;
+    in >> level;
+    return level;
+}
+
+struct PerfReading {
+    // Per event of PerfEventSpecs(); false where the event could not be opened.
+    std::vector<bool> available;
+    std::vector<double> values;
+};
+
+class PerfEventGroups {
+public:
+    // Opens a group for every thread of the process; events that fail are left out.
+    PerfEventGroups() {
+        const auto& specs = PerfEventSpecs();
+        m_opened.assign(specs.size(), false);
+        for (pid_t tid : ProcessThreads()) {
+            std::vector<int> fds(specs.size(), -1);
+            fds[0] = PerfEventOpen(specs[0], tid, -1);
+            if (fds[0] < 0) {
+                m_error = errno;
+                continue;
+            }
+            for (size_t e = 1; e < specs.size(); ++e)
+                fds[e] = PerfEventOpen(specs[e], tid, fds[0]);
+            for (size_t e = 0; e < specs.size(); ++e)
+                m_opened[e] = m_opened[e] || fds[e] >= 0;
+            m_groups.push_back(fds);
+        }
+    }
+
+    ~PerfEventGroups() {
+        for (const auto& fds : m_groups) {
+            for (int fd : fds) {
+                if (fd >= 0)
+                    close(fd);
+            }
+        }
+    }
+
+    PerfEventGroups(const PerfEventGroups&)            = delete;
+    PerfEventGroups& operator=(const PerfEventGroups&) = delete;
+
+    bool Available() const {
+        return !m_groups.empty();
+    }
+    // errno of the last leader that failed to open.
+    int Error() const {
+        return m_error;
+    }
+
+    void Start() {
+        for (const auto& fds : m_groups)
+            ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        Enable(true);
+    }
+
+    // Stops and restarts counting without resetting, around paused parts of a loop.
+    void Enable(bool enable) {
+        for (const auto& fds : m_groups)
+            ioctl(fds[0], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    PerfReading Stop() {
+        Enable(false);
+
+        const size_t numEvents = PerfEventSpecs().size();
+        PerfReading reading;
+        reading.available = m_opened;
+        reading.values.assign(numEvents, 0);
+        for (const auto& fds : m_groups) {
+            for (size_t e = 0; e < numEvents; ++e) {
+                // value, time enabled, time running
+                uint64_t data[3] = {0, 0, 0};
+                if (fds[e] < 0 || read(fds[e], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)))
+                    continue;
+                // Scale for multiplexing; a group that never ran contributes nothing.
+                if (data[2] > 0)
+                    reading.values[e] += static_cast<double>(data[0]) * data[1] / data[2];
+            }
+        }
+        return reading;
+    }
+
+private:
+    std::vector<std::vector<int>> m_groups;
+    std::vector<bool> m_opened;
+    int m_error = 0;
+};
+
+// The reason is printed once per process.
+inline void ReportPerfUnavailable(int error) {
+    static const bool reported = [error] {
+        std::cerr << "perf_event_open failed (" << std::strerror(error)
+                  << ", perf_event_paranoid=" << PerfEventParanoid()
+                  << "); IPC and MPKI are reported as n/a" << std::endl;
+        return true;
+    }();
+    (void)reported;
+}
+
+/*
+ * Construct right before `for (auto _ : state)`, next to the EnergyCounters; on
+ * destruction the counts of the loop are published per iteration, with IPC and MPKI.
+ * Untimed work in the loop goes in an UntimedScope (untimed.h), which pauses these
+ * counters with the timer. Nothing is published when perf events are unavailable.
+ */
+class PerfCounters {
+public:
+    explicit PerfCounters(benchmark::State& state) : m_state(state) {
+        if (!m_groups.Available()) {
+            ReportPerfUnavailable(m_groups.Error());
+            return;
+        }
+        m_groups.Start();
+    }
+
+    void Pause() {
+        if (m_groups.Available())
+            m_groups.Enable(false);
+    }
+    void Resume() {
+        if (m_groups.Available())
+            m_groups.Enable(true);
+    }
+
+    ~PerfCounters() {
+        if (!m_groups.Available())
+            return;
+        PerfReading reading = m_groups.Stop();
+        const auto& specs   = PerfEventSpecs();
+        for (size_t e = 0; e < specs.size(); ++e) {
+            if (reading.available[e])
+                m_state.counters[specs[e].name] =
+                    benchmark::Counter(reading.values[e], benchmark::Counter::kAvgIterations);
+        }
+
+        // Indices follow PerfEventSpecs().
+        const double cycles       = reading.values[0];
+        const double instructions = reading.values[1];
+        if (!reading.available[1] || instructions <= 0)
+            return;
+        if (reading.available[0] && cycles > 0)
+            m_state.counters["IPC"] = instructions / cycles;
+        const char* mpki[] = {nullptr, nullptr, "LLC_MPKI", "dTLB_MPKI", "Branch_MPKI"};
+        for (size_t e = 2; e < specs.size(); ++e) {
+            if (reading.available[e])
+                m_state.counters[mpki[e]] = reading.values[e] * 1000 / instructions;
+        }
+    }
+
+    PerfCounters(const PerfCounters&)            = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+private:
+    benchmark::State& m_state;
+    PerfEventGroups m_groups;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_PERF_COUNTERS_H
@@ -0,0 +1,219 @@
+/*
+ * A staged pipeline with bounded queues between the stages, for overlapping client-side
+ * work (encryption, decryption, I/O) with server-side evaluation.
+ *
+ * Every stage has its own worker threads and reads from a bounded queue; a full queue
+ * blocks the stage before it, so a slow stage throttles the ones upstream instead of
+ * letting work pile up. Run() feeds a stream of items into the first queue, optionally
+ * at a fixed arrival rate, and returns per stage the service time of each item, the time
+ * it waited in the stage's input queue and the time the stage was blocked on a full
+ * output queue, plus the end-to-end latency of every item from arrival to completion.
+ */
+
+#ifndef FHEBENCH_COMMON_PIPELINE_H
+#define FHEBENCH_COMMON_PIPELINE_H
+
+#include "latency.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fhebench {
+
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : m_capacity(capacity == 0 ? 1 : capacity) {}
+
+    // Blocks while the queue is full; returns false if it has been closed.
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed)
+            return false;
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty; returns false once it is closed and drained.
+    bool Pop(T* item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty())
+            return false;
+        *item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    // No more pushes; consumers drain what is left.
+    void Close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+private:
+    const size_t m_capacity;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<T> m_items;
+    bool m_closed = false;
+};
+
+template <typename Item>
+class Pipeline {
+public:
+    struct Stage {
+        std::string name;
+        size_t workers;
+        std::function<void(Item&)> process;
+    };
+
+    struct StageStats {
+        std::string name;
+        LatencyHistogram service;
+        LatencyHistogram wait;
+        // Total time the stage's workers spent blocked on a full output queue.
+        double blockedSeconds = 0;
+    };
+
+    struct Stats {
+        std::vector<StageStats> stages;
+        LatencyHistogram endToEnd;
+        double seconds = 0;
+        uint64_t items = 0;
+    };
+
+    Pipeline(std::vector<Stage> stages, size_t queueCapacity)
+        : m_stages(std::move(stages)), m_queueCapacity(queueCapacity) {}
+
+    /*
+     * Pushes make(0) ... make(count - 1) through all stages and returns once the last
+     * one has finished. With ratePerSecond > 0 item i arrives at i / ratePerSecond and its
+     * end-to-end latency is measured from that scheduled time, whenever it is actually pushed;
+     * otherwise items arrive as fast as the first queue takes them. The first exception
+     * thrown by a stage is rethrown here, after the pipeline has drained.
+     */
+    Stats Run(size_t count, const std::function<Item(size_t)>& make, double ratePerSecond = 0) {
+        using Clock = std::chrono::steady_clock;
+        struct Envelope {
+            Item item;
+            Clock::time_point arrived;
+            Clock::time_point enqueued;
+        };
+
+        const size_t numStages = m_stages.size();
+        std::vector<std::unique_ptr<BoundedQueue<Envelope>>> queues;
+        for (size_t s = 0; s < numStages; ++s)
+            queues.push_back(std::make_unique<BoundedQueue<Envelope>>(m_queueCapacity));
+
+        Stats stats;
+        for (const auto& stage : m_stages)
+            stats.stages.push_back({stage.name, {}, {}, 0});
+        std::mutex statsMutex;
+        std::exception_ptr error;
+        std::vector<std::unique_ptr<std::atomic<size_t>>> running;
+        for (const auto& stage : m_stages)
+            running.push_back(std::make_unique<std::atomic<size_t>>(std::max<size_t>(stage.workers, 1)));
+
+        auto worker = [&](size_t s) {
+            StageStats local;
+            LatencyHistogram endToEnd;
+            Envelope envelope;
+            while (queues[s]->Pop(&envelope)) {
+                auto start = Clock::now();
+                local.wait.Record(Nanoseconds(start - envelope.enqueued));
+                bool ok = true;
+                try {
+                    m_stages[s].process(envelope.item);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(statsMutex);
+                    if (!error)
+                        error = std::current_exception();
+                    ok = false;
+                }
+                auto done = Clock::now();
+                local.service.Record(Nanoseconds(done - start));
+                if (!ok)
+                    continue;
+                if (s + 1 == numStages) {
+                    endToEnd.Record(Nanoseconds(done - envelope.arrived));
+                    continue;
+                }
+                envelope.enqueued = done;
+                queues[s + 1]->Push(std::move(envelope));
+                local.blockedSeconds += std::chrono::duration<double>(Clock::now() - done).count();
+            }
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                stats.stages[s].service.Merge(local.service);
+                stats.stages[s].wait.Merge(local.wait);
+                stats.stages[s].blockedSeconds += local.blockedSeconds;
+                stats.endToEnd.Merge(endToEnd);
+            }
+            // The last worker of a stage closes the queue of the next one.
+            if (running[s]->fetch_sub(1) == 1 && s + 1 < numStages)
+                queues[s + 1]->Close();
+        };
+
+        const auto begin = Clock::now();
+        std::vector<std::thread> threads;
+        for (size_t s = 0; s < numStages; ++s)
+            for (size_t w = 0; w < std::max<size_t>(m_stages[s].workers, 1); ++w)
+                threads.emplace_back(worker, s);
+
+        for (size_t i = 0; i < count && numStages > 0; ++i) {
+            // make(i) runs ahead of the item's arrival. At a fixed rate the arrival is the
+            // scheduled time rather than the time of the push, so an item that is pushed late
+            // because the pipeline has fallen behind still counts its delay end to end.
+            Item item = make(i);
+            auto arrived = Clock::now();
+            if (ratePerSecond > 0) {
+                arrived = begin + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double>(i / ratePerSecond));
+                std::this_thread::sleep_until(arrived);
+            }
+            queues[0]->Push({std::move(item), arrived, Clock::now()});
+        }
+        if (numStages > 0)
+            queues[0]->Close();
+        for (auto& thread : threads)
+            thread.join();
+
+        stats.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        stats.items   = stats.endToEnd.Count();
+        if (error)
+            std::rethrow_exception(error);
+        return stats;
+    }
+
+private:
+    static uint64_t Nanoseconds(std::chrono::steady_clock::duration d) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+    std::vector<Stage> m_stages;
+    size_t m_queueCapacity;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_PIPELINE_H
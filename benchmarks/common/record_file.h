@@ -0,0 +1,158 @@
+/*
+ * Memory-mapped files of fixed-size records, for streaming serialized ciphertexts to disk
+ * and reading them back without an index.
+ *
+ * The file is a one-page header (magic, record size, record count) followed by the
+ * records; record i starts at PageSize() + i * recordSize and holds an 8-byte payload
+ * length followed by the payload. The record size is a multiple of the page size, so
+ * each record covers whole pages: RecordFileWriter copies a record into its slot of a
+ * shared mapping and immediately drops those pages from the process (MADV_DONTNEED),
+ * leaving them to the page cache and write-back. Memory use therefore does not grow
+ * with the size of the file. Finish() flushes the mapping to disk.
+ */
+
+#ifndef FHEBENCH_COMMON_RECORD_FILE_H
+#define FHEBENCH_COMMON_RECORD_FILE_H
+
+#include "keystore.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace fhebench {
+
+constexpr char kRecordFileMagic[8] = {'F', 'H', 'E', 'B', 'R', 'E', 'C', '1'};
+
+inline size_t PageSize() {
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return pageSize;
+}
+
+// Smallest multiple of the page size that holds a payload of maxPayload bytes.
+inline size_t RecordSizeFor(size_t maxPayload) {
+    size_t size = maxPayload + sizeof(uint64_t);
+    return (size + PageSize() - 1) / PageSize() * PageSize();
+}
+
+class RecordFileWriter {
+public:
+    // Room for numRecords payloads of up to maxPayload bytes each.
+    RecordFileWriter(const std::string& path, size_t maxPayload, size_t numRecords)
+        : m_recordSize(RecordSizeFor(maxPayload)), m_numRecords(numRecords) {
+        m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (m_fd < 0)
+            throw std::runtime_error("cannot create " + path);
+        m_size = PageSize() + m_recordSize * m_numRecords;
+        if (ftruncate(m_fd, static_cast<off_t>(m_size)) != 0) {
+            close(m_fd);
+            throw std::runtime_error("cannot size " + path);
+        }
+        void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (data == MAP_FAILED) {
+            close(m_fd);
+            throw std::runtime_error("cannot map " + path);
+        }
+        m_data = static_cast<char*>(data);
+
+        uint64_t header[2] = {m_recordSize, m_numRecords};
+        std::memcpy(m_data, kRecordFileMagic, sizeof(kRecordFileMagic));
+        std::memcpy(m_data + sizeof(kRecordFileMagic), header, sizeof(header));
+    }
+
+    ~RecordFileWriter() {
+        Finish();
+    }
+
+    RecordFileWriter(const RecordFileWriter&)            = delete;
+    RecordFileWriter& operator=(const RecordFileWriter&) = delete;
+
+    size_t RecordSize() const {
+        return m_recordSize;
+    }
+    size_t NumRecords() const {
+        return m_numRecords;
+    }
+    size_t FileSize() const {
+        return m_size;
+    }
+    // The bytes actually written so far: the header and each record's length and payload,
+    // without the padding of the slots.
+    size_t WrittenBytes() const {
+        return sizeof(kRecordFileMagic) + 2 * sizeof(uint64_t) + m_recordBytes.load(std::memory_order_relaxed);
+    }
+
+    // Stores payload as record i. Different records may be written concurrently.
+    void Write(size_t i, const void* payload, size_t length) {
+        if (i >= m_numRecords || length + sizeof(uint64_t) > m_recordSize)
+            throw std::length_error("record does not fit the record file");
+        char* slot      = m_data + PageSize() + i * m_recordSize;
+        uint64_t prefix = length;
+        std::memcpy(slot, &prefix, sizeof(prefix));
+        std::memcpy(slot + sizeof(prefix), payload, length);
+        madvise(slot, m_recordSize, MADV_DONTNEED);
+        m_recordBytes.fetch_add(sizeof(prefix) + length, std::memory_order_relaxed);
+    }
+
+    // Flushes everything to disk and unmaps the file; called by the destructor.
+    void Finish() {
+        if (m_data == nullptr)
+            return;
+        msync(m_data, m_size, MS_SYNC);
+        munmap(m_data, m_size);
+        close(m_fd);
+        m_data = nullptr;
+    }
+
+private:
+    size_t m_recordSize;
+    size_t m_numRecords;
+    size_t m_size = 0;
+    int m_fd      = -1;
+    char* m_data  = nullptr;
+    std::atomic<size_t> m_recordBytes{0};
+};
+
+class RecordFileReader {
+public:
+    explicit RecordFileReader(const std::string& path) : m_file(path) {
+        if (m_file.Size() < PageSize() || std::memcmp(m_file.Data(), kRecordFileMagic, sizeof(kRecordFileMagic)) != 0)
+            throw std::runtime_error("not a record file: " + path);
+        uint64_t header[2];
+        std::memcpy(header, m_file.Data() + sizeof(kRecordFileMagic), sizeof(header));
+        m_recordSize = header[0];
+        m_numRecords = header[1];
+        if (m_file.Size() < PageSize() + m_recordSize * m_numRecords)
+            throw std::runtime_error("truncated record file: " + path);
+    }
+
+    size_t NumRecords() const {
+        return m_numRecords;
+    }
+
+    // Payload of record i, pointing into the mapping.
+    const char* Record(size_t i, size_t* length) const {
+        if (i >= m_numRecords)
+            throw std::out_of_range("record index out of range");
+        const char* slot = m_file.Data() + PageSize() + i * m_recordSize;
+        uint64_t prefix;
+        std::memcpy(&prefix, slot, sizeof(prefix));
+        *length = static_cast<size_t>(prefix);
+        return slot + sizeof(prefix);
+    }
+
+private:
+    MappedFile m_file;
+    size_t m_recordSize = 0;
+    size_t m_numRecords = 0;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_RECORD_FILE_H
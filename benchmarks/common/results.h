@@ -0,0 +1,529 @@
+/*
+ * Machine-readable results: a JSON/CSV file reporter carrying every column of the
+ * patched console reporter, plus the machine and library metadata needed to compare
+ * runs taken on different hosts or builds.
+ *
+ * Google Benchmark's own --benchmark_out writer only sees the raw counters, so the
+ * derived columns (throughput, latency, peak RSS and allocations from the memory
+ * manager) would be lost. FHEBENCH_MAIN() replaces BENCHMARK_MAIN() and installs
+ * ResultsReporter as the file reporter whenever --benchmark_out=<file> is given; the
+ * format follows --benchmark_out_format (json or csv), or the file extension when that
+ * flag is absent. tools/compare.py diffs two such files.
+ *
+ * The columns are computed as in console_reporter.cc: times are per iteration in the
+ * benchmark's time unit, throughput is Slots x Ops per second of real time, and RSS
+ * comes from max_bytes_used of the memory run. Counters without a column of their own
+ * go into "counters" (JSON) or the trailing "counters" field (CSV, name=value pairs).
+ * Missing values are null in JSON and empty in CSV.
+ */
+
+#ifndef FHEBENCH_COMMON_RESULTS_H
+#define FHEBENCH_COMMON_RESULTS_H
+
+#include "benchmark/benchmark.h"
+
+#include "affinity.h"
+
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fhebench {
+
+// Versions of the libraries linked into the binary, filled in by the scheme headers
+// (e.g. ckks_common.h registers OpenFHE) during static initialization.
+inline std::vector<std::pair<std::string, std::string>>& LibraryVersions() {
+    static std::vector<std::pair<std::string, std::string>> versions;
+    return versions;
+}
+
+inline bool RegisterLibraryVersion(const std::string& library, const std::string& version) {
+    for (const auto& entry : LibraryVersions()) {
+        if (entry.first == library)
+            return true;
+    }
+    LibraryVersions().emplace_back(library, version);
+    return true;
+}
+
+// Summaries printed once all benchmarks have run, such as the Pareto frontier of a
+// parameter sweep. They go to stdout after the console table, or to stderr when stdout
+// carries --benchmark_format=json/csv.
+inline std::vector<std::function<void(std::ostream&)>>& Epilogues() {
+    static std::vector<std::function<void(std::ostream&)>> epilogues;
+    return epilogues;
+}
+
+inline bool AddEpilogue(std::function<void(std::ostream&)> epilogue) {
+    Epilogues().push_back(std::move(epilogue));
+    return true;
+}
+
+struct MachineInfo {
+    std::string cpuModel;
+    unsigned hardwareThreads = 0;
+    long onlineCpus          = 0;
+    double maxMHz            = 0;  // cpuinfo_max_freq of cpu0; 0 if cpufreq is unavailable
+    double curMHz            = 0;  // scaling_cur_freq averaged over the online cpus
+    std::string governor;
+    std::string kernel;
+    std::string compiler;
+    std::string build;
+    std::string affinity;      // FHEBENCH_AFFINITY policy, "none" without pinning
+    std::string affinityCpus;  // its cpus in thread order
+    std::string pCpus;
+    std::string eCpus;
+
+    static MachineInfo Collect() {
+        MachineInfo info;
+        info.cpuModel        = CpuModel();
+        info.hardwareThreads = std::thread::hardware_concurrency();
+        info.onlineCpus      = sysconf(_SC_NPROCESSORS_ONLN);
+        info.maxMHz          = ReadNumber("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq") / 1000.0;
+        double sum           = 0;
+        long samples         = 0;
+        for (long cpu = 0; cpu < info.onlineCpus; ++cpu) {
+            double kHz =
+                ReadNumber("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/scaling_cur_freq");
+            if (kHz > 0) {
+                sum += kHz;
+                ++samples;
+            }
+        }
+        info.curMHz   = samples ? sum / samples / 1000.0 : 0;
+        info.governor = ReadLine("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+        struct utsname name;
+        if (uname(&name) == 0)
+            info.kernel = std::string(name.sysname) + " " + name.release + " " + name.machine;
+#if defined(__clang__)
+        info.compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+        info.compiler = "gcc " __VERSION__;
+#endif
+#ifdef NDEBUG
+        info.build = "release";
+#else
+        info.build = "debug";
+#endif
+#ifdef FHEBENCH_BUILD_VARIANT
+        // lto, native and pgo, as configured by the CMake build.
+        info.build += " " FHEBENCH_BUILD_VARIANT;
+#endif
+        const AffinityState& affinity = CurrentAffinity();
+        info.affinity                 = affinity.policy;
+        info.affinityCpus             = FormatCpuList(affinity.cpus);
+        info.pCpus                    = affinity.performanceCpus;
+        info.eCpus                    = affinity.efficiencyCpus;
+        return info;
+    }
+
+    // Key/value view shared by the reporters and benchmark::AddCustomContext.
+    std::vector<std::pair<std::string, std::string>> Fields() const {
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"cpu_model", cpuModel},
+            {"hardware_threads", std::to_string(hardwareThreads)},
+            {"online_cpus", std::to_string(onlineCpus)},
+            {"max_mhz", maxMHz > 0 ? std::to_string(static_cast<long>(maxMHz)) : ""},
+            {"cur_mhz", curMHz > 0 ? std::to_string(static_cast<long>(curMHz)) : ""},
+            {"governor", governor},
+            {"kernel", kernel},
+            {"compiler", compiler},
+            {"build", build},
+            {"affinity", affinity},
+            {"affinity_cpus", affinityCpus},
+            {"p_cpus", pCpus},
+            {"e_cpus", eCpus},
+        };
+        for (const auto& library : LibraryVersions())
+            fields.emplace_back(library.first + "_version", library.second);
+        return fields;
+    }
+
+private:
+    static std::string ReadLine(const std::string& file) {
+        std::ifstream in(file);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    static double ReadNumber(const std::string& file) {
+        std::string line = ReadLine(file);
+        return line.empty() ? 0 : std::strtod(line.c_str(), nullptr);
+    }
+
+    static std::string CpuModel() {
+        std::ifstream in("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(in, line)) {
+            // "model name" on x86, "Model"/"Processor" on some ARM kernels.
+            if (line.compare(0, 10, "model name") == 0 || line.compare(0, 5, "Model") == 0 ||
+                line.compare(0, 9, "Processor") == 0) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) {
+                    size_t begin = line.find_first_not_of(" \t", colon + 1);
+                    return begin == std::string::npos ? std::string() : line.substr(begin);
+                }
+            }
+        }
+        struct utsname name;
+        return uname(&name) == 0 ? std::string(name.machine) : std::string();
+    }
+};
+
+// Adds the machine fields to the context block that Google Benchmark prints (and
+// writes into its own JSON output).
+inline void AddMachineContext(const MachineInfo& info) {
+    for (const auto& field : info.Fields()) {
+        if (!field.second.empty())
+            benchmark::AddCustomContext(field.first, field.second);
+    }
+}
+
+// One result row; unset optionals are written as null/empty.
+struct ResultRow {
+    struct Value {
+        bool set     = false;
+        double value = 0;
+    };
+
+    std::vector<std::pair<const char*, Value>> columns;
+    std::map<std::string, double> otherCounters;
+};
+
+class ResultsReporter : public benchmark::BenchmarkReporter {
+public:
+    enum Format { JSON, CSV };
+
+    explicit ResultsReporter(Format format) : m_format(format) {}
+
+    bool ReportContext(const Context& context) override {
+        MachineInfo info = MachineInfo::Collect();
+        std::vector<std::pair<std::string, std::string>> fields;
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+        fields.emplace_back("date", date);
+        fields.emplace_back("executable", Context::executable_name ? Context::executable_name : "");
+        fields.emplace_back("host", context.sys_info.name);
+        fields.emplace_back("num_cpus", std::to_string(context.cpu_info.num_cpus));
+        fields.emplace_back("mhz_per_cpu", std::to_string(static_cast<long>(context.cpu_info.cycles_per_second / 1e6)));
+        fields.emplace_back("cpu_scaling", context.cpu_info.scaling == benchmark::CPUInfo::ENABLED ?
+                                               "enabled" :
+                                               context.cpu_info.scaling == benchmark::CPUInfo::DISABLED ? "disabled" :
+                                                                                                        "unknown");
+        for (const auto& cache : context.cpu_info.caches) {
+            fields.emplace_back("cache_L" + std::to_string(cache.level) + "_" + cache.type,
+                                std::to_string(cache.size / 1024) + " KiB x" +
+                                    std::to_string(context.cpu_info.num_cpus / std::max(1, cache.num_sharing)));
+        }
+        for (const auto& field : info.Fields())
+            fields.push_back(field);
+
+        std::ostream& out = GetOutputStream();
+        if (m_format == JSON) {
+            out << "{\n  \"context\": {";
+            for (size_t i = 0; i < fields.size(); ++i)
+                out << (i ? ",\n" : "\n") << "    " << Quote(fields[i].first) << ": " << Quote(fields[i].second);
+            out << "\n  },\n  \"benchmarks\": [";
+        }
+        else {
+            for (const auto& field : fields)
+                out << "# " << field.first << ": " << field.second << "\n";
+            out << "name,run_type,aggregate_name,aggregate_unit,repetition_index,repetitions,threads,iterations,"
+                   "time_unit";
+            for (const auto& column : Columns(benchmark::BenchmarkReporter::Run()).columns)
+                out << "," << column.first;
+            out << ",label,error_message,counters\n";
+        }
+        return true;
+    }
+
+    void ReportRuns(const std::vector<Run>& reports) override {
+        const Run* memoryRun = LastMemoryRun(reports);
+        for (const auto& run : reports) {
+            Run copy = run;
+            if (&run != memoryRun)
+                copy.memory_result = nullptr;
+            (m_format == JSON) ? PrintJSON(copy) : PrintCSV(copy);
+        }
+        GetOutputStream().flush();
+    }
+
+    /*
+     * Google Benchmark 1.7 keeps the memory results of a benchmark's repetitions in a
+     * vector that grows with every repetition and hands out pointers into it, so by
+     * the time the runs are reported only the last repetition's pointer is valid.
+     */
+    static const Run* LastMemoryRun(const std::vector<Run>& reports) {
+        const Run* last = nullptr;
+        for (const auto& run : reports) {
+            if (run.memory_result != nullptr)
+                last = &run;
+        }
+        return last;
+    }
+
+    void Finalize() override {
+        if (m_format == JSON)
+            GetOutputStream() << (m_rows ? "\n  ]\n}\n" : "]\n}\n");
+        GetOutputStream().flush();
+    }
+
+    static ResultRow Columns(const Run& run) {
+        ResultRow row;
+        // Coefficient-of-variation aggregates hold fractions, not times.
+        const bool percentage   = run.aggregate_unit == benchmark::kPercentage;
+        const double multiplier = percentage ? 1.0 : benchmark::GetTimeUnitMultiplier(run.time_unit);
+        // A rate derived from a standard deviation means nothing.
+        const bool dispersion = run.run_type == Run::RT_Aggregate && run.aggregate_name != "mean" &&
+                                run.aggregate_name != "median";
+        auto counter            = [&](const char* name) {
+            ResultRow::Value value;
+            auto it = run.counters.find(name);
+            if (it != run.counters.end()) {
+                value.set   = true;
+                value.value = it->second.value;
+            }
+            return value;
+        };
+        auto scaled = [](ResultRow::Value value, double factor) {
+            value.value *= factor;
+            return value;
+        };
+        auto given = [](double v) {
+            ResultRow::Value value;
+            value.set   = std::isfinite(v);
+            value.value = v;
+            return value;
+        };
+
+        const double real = percentage ? run.real_accumulated_time : run.iterations ? run.GetAdjustedRealTime() : 0;
+        const double cpu  = percentage ? run.cpu_accumulated_time : run.iterations ? run.GetAdjustedCPUTime() : 0;
+        ResultRow::Value slots = counter("Slots"), ops = counter("Ops");
+        const double perIteration = (slots.set ? slots.value : 1.0) * (ops.set ? ops.value : 1.0);
+
+        row.columns.emplace_back("real_time", given(real));
+        row.columns.emplace_back("cpu_time", given(cpu));
+        row.columns.emplace_back("latency", given(real - cpu));
+        row.columns.emplace_back("lat_p50", scaled(counter("Lat_p50"), multiplier));
+        row.columns.emplace_back("lat_p90", scaled(counter("Lat_p90"), multiplier));
+        row.columns.emplace_back("lat_p99", scaled(counter("Lat_p99"), multiplier));
+        row.columns.emplace_back("lat_max", scaled(counter("Lat_max"), multiplier));
+        row.columns.emplace_back("throughput_per_s",
+                                 real > 0 && !dispersion ? given(perIteration / (real / multiplier)) :
+                                                           ResultRow::Value());
+        row.columns.emplace_back("power_w", counter("Power_W"));
+        row.columns.emplace_back("energy_j", counter("Energy_J"));
+        row.columns.emplace_back("dram_j", counter("DRAM_J"));
+
+        ResultRow::Value rss = counter("RSS_kB"), allocs, allocKB;
+        if (run.memory_result != nullptr) {
+            const benchmark::MemoryManager::Result& memory = *run.memory_result;
+            if (!rss.set)
+                rss = given(memory.max_bytes_used / 1024.0);
+            allocs = given(run.allocs_per_iter);
+            // Unset metrics hold MemoryManager::TombstoneValue (negative), which shared
+            // library builds of Google Benchmark do not export.
+            if (memory.total_allocated_bytes >= 0)
+                allocKB = given(memory.num_allocs > 0 ? memory.total_allocated_bytes * run.allocs_per_iter /
+                                                            static_cast<double>(memory.num_allocs) / 1024.0 :
+                                                        0.0);
+        }
+        row.columns.emplace_back("rss_kb", rss);
+        row.columns.emplace_back("allocs", allocs);
+        row.columns.emplace_back("alloc_kb", allocKB);
+        row.columns.emplace_back("ipc", counter("IPC"));
+        row.columns.emplace_back("llc_mpki", counter("LLC_MPKI"));
+        row.columns.emplace_back("dtlb_mpki", counter("dTLB_MPKI"));
+        row.columns.emplace_back("branch_mpki", counter("Branch_MPKI"));
+        row.columns.emplace_back("slots", slots);
+        row.columns.emplace_back("ops", ops);
+        row.columns.emplace_back("precision_bits", counter("Precision"));
+        row.columns.emplace_back("levels", counter("Levels"));
+
+        static const std::set<std::string> own = {
+            "Lat_p50", "Lat_p90",  "Lat_p99",   "Lat_max",     "Power_W", "Energy_J", "DRAM_J",    "RSS_kB",
+            "IPC",     "LLC_MPKI", "dTLB_MPKI", "Branch_MPKI", "Slots",   "Ops",      "Precision", "Levels"};
+        for (const auto& c : run.counters) {
+            if (own.count(c.first) == 0)
+                row.otherCounters[c.first] = c.second.value;
+        }
+        return row;
+    }
+
+private:
+    static std::string Quote(const std::string& s) {
+        std::string out = "\"";
+        for (unsigned char c : s) {
+            switch (c) {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if (c < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        out += escaped;
+                    }
+                    else {
+                        out += static_cast<char>(c);
+                    }
+            }
+        }
+        return out + "\"";
+    }
+
+    static std::string CsvField(const std::string& s) {
+        if (s.find_first_of(",\"\n") == std::string::npos)
+            return s;
+        std::string out = "\"";
+        for (char c : s)
+            out += (c == '"') ? std::string("\"\"") : std::string(1, c);
+        return out + "\"";
+    }
+
+    static std::string Number(double value) {
+        if (!std::isfinite(value))
+            return "null";
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    static const char* RunType(const Run& run) {
+        return run.run_type == Run::RT_Aggregate ? "aggregate" : "iteration";
+    }
+
+    static const char* AggregateUnit(const Run& run) {
+        return run.aggregate_unit == benchmark::kPercentage ? "percentage" : "time";
+    }
+
+    void PrintJSON(const Run& run) {
+        std::ostream& out = GetOutputStream();
+        ResultRow row     = Columns(run);
+        out << (m_rows++ ? ",\n" : "\n") << "    {\"name\": " << Quote(run.benchmark_name())
+            << ", \"run_type\": " << Quote(RunType(run)) << ", \"aggregate_name\": " << Quote(run.aggregate_name)
+            << ", \"aggregate_unit\": " << Quote(AggregateUnit(run))
+            << ", \"repetition_index\": " << run.repetition_index << ", \"repetitions\": " << run.repetitions
+            << ", \"threads\": " << run.threads << ", \"iterations\": " << run.iterations
+            << ", \"time_unit\": " << Quote(benchmark::GetTimeUnitString(run.time_unit));
+        for (const auto& column : row.columns)
+            out << ", " << Quote(column.first) << ": " << (column.second.set ? Number(column.second.value) : "null");
+        out << ", \"counters\": {";
+        bool first = true;
+        for (const auto& c : row.otherCounters) {
+            out << (first ? "" : ", ") << Quote(c.first) << ": " << Number(c.second);
+            first = false;
+        }
+        out << "}";
+        if (!run.report_label.empty())
+            out << ", \"label\": " << Quote(run.report_label);
+        if (run.error_occurred)
+            out << ", \"error_message\": " << Quote(run.error_message);
+        out << "}";
+    }
+
+    void PrintCSV(const Run& run) {
+        std::ostream& out = GetOutputStream();
+        ResultRow row     = Columns(run);
+        ++m_rows;
+        out << CsvField(run.benchmark_name()) << "," << RunType(run) << "," << CsvField(run.aggregate_name) << ","
+            << AggregateUnit(run) << "," << run.repetition_index << "," << run.repetitions << "," << run.threads
+            << "," << run.iterations << "," << benchmark::GetTimeUnitString(run.time_unit);
+        for (const auto& column : row.columns)
+            out << "," << (column.second.set ? Number(column.second.value) : "");
+        std::string counters;
+        for (const auto& c : row.otherCounters)
+            counters += (counters.empty() ? "" : ";") + c.first + "=" + Number(c.second);
+        out << "," << CsvField(run.report_label) << "," << CsvField(run.error_occurred ? run.error_message : "") << ","
+            << CsvField(counters) << "\n";
+    }
+
+    Format m_format;
+    size_t m_rows = 0;
+};
+
+/*
+ * Body of FHEBENCH_MAIN(). --benchmark_out and --benchmark_out_format (or the
+ * BENCHMARK_OUT/BENCHMARK_OUT_FORMAT environment variables) are looked at before
+ * benchmark::Initialize() consumes them; Google Benchmark still opens the file.
+ */
+inline int RunBenchmarks(int argc, char** argv) {
+    char arg0Default[] = "benchmark";
+    char* argsDefault  = arg0Default;
+    if (!argv) {
+        argc = 1;
+        argv = &argsDefault;
+    }
+    auto flag = [&](const char* name, const char* env) {
+        std::string prefix = std::string("--") + name + "=";
+        std::string value;
+        if (const char* fromEnv = std::getenv(env))
+            value = fromEnv;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strncmp(argv[i], prefix.c_str(), prefix.size()) == 0)
+                value = argv[i] + prefix.size();
+        }
+        return value;
+    };
+    const std::string out    = flag("benchmark_out", "BENCHMARK_OUT");
+    const std::string format = flag("benchmark_out_format", "BENCHMARK_OUT_FORMAT");
+    const std::string display = flag("benchmark_format", "BENCHMARK_FORMAT");
+    // Pins before any benchmark thread exists, if nothing has done so already.
+    CurrentAffinity();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    AddMachineContext(MachineInfo::Collect());
+
+    std::unique_ptr<ResultsReporter> fileReporter;
+    const bool csvName = out.size() >= 4 && out.compare(out.size() - 4, 4, ".csv") == 0;
+    if (!out.empty() && format != "console") {
+        fileReporter = std::make_unique<ResultsReporter>(
+            (format == "csv" || (format.empty() && csvName)) ? ResultsReporter::CSV : ResultsReporter::JSON);
+    }
+    benchmark::RunSpecifiedBenchmarks(nullptr, fileReporter.get());
+    std::ostream& summary = (display.empty() || display == "console") ? std::cout : std::cerr;
+    for (const auto& epilogue : Epilogues())
+        epilogue(summary);
+    benchmark::Shutdown();
+    return 0;
+}
+
+}  // namespace fhebench
+
+#define FHEBENCH_MAIN()                                   \
+    int main(int argc, char** argv) {                     \
+        return ::fhebench::RunBenchmarks(argc, argv);     \
+    }                                                     \
+    int main(int, char**)
+
+#endif  // FHEBENCH_COMMON_RESULTS_H
@@ -0,0 +1,144 @@
+/*
+ * k rotations of one ciphertext, done independently or hoisted.
+ *
+ * An independent rotation decomposes the ciphertext into digits for key switching, then
+ * applies the automorphism and switches keys. Hoisting decomposes once and applies every
+ * rotation to the shared digits (OpenFHE's EvalFastRotationPrecompute/EvalFastRotation,
+ * HElib's BasicAutomorphPrecon), at the cost of keeping the digits in memory.
+ *
+ * RotationIndices() picks the rotation amounts, PublishRotationCounters() publishes
+ *
+ *   Ops        rotations per iteration, so the Throughput column counts rotations
+ *   Per_op     time per rotation
+ *   Digits_MB  heap held by the precomputation (hoisted only)
+ *
+ * and RecordRotations() keeps the p50 of every run. After the run the latencies of each
+ * series (a scheme, parameter set and index set) are fitted to
+ *
+ *   independent  t(k) = r k
+ *   hoisted      t(k) = P + h k
+ *
+ * and r, P, h and the break-even k, the smallest k from which hoisting is faster,
+ * ceil(P / (r - h)), are printed.
+ */
+
+#ifndef FHEBENCH_COMMON_ROTATIONS_H
+#define FHEBENCH_COMMON_ROTATIONS_H
+
+#include "benchmark/benchmark.h"
+
+#include "latency.h"
+#include "results.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace fhebench {
+
+/*
+ * k distinct rotation amounts in [1, slots), for k < slots: 1..k for set 0, k amounts
+ * spread evenly over the slots for set 1.
+ */
+inline std::vector<int32_t> RotationIndices(int set, size_t k, size_t slots) {
+    std::vector<int32_t> indices;
+    for (size_t i = 1; i <= k; ++i) {
+        size_t index = (set == 0) ? i : i * slots / (k + 1);
+        if (!indices.empty())
+            index = std::max(index, static_cast<size_t>(indices.back()) + 1);
+        indices.push_back(static_cast<int32_t>(index));
+    }
+    return indices;
+}
+
+inline void PublishRotationCounters(benchmark::State& state, size_t k, double digitsMB = 0) {
+    state.counters["Ops"] = static_cast<double>(k);
+    state.counters["Per_op"] =
+        benchmark::Counter(static_cast<double>(k), benchmark::Counter::kIsIterationInvariantRate |
+                                                       benchmark::Counter::kInvert);
+    if (digitsMB > 0)
+        state.counters["Digits_MB"] = digitsMB;
+}
+
+struct RotationSeries {
+    std::string name;
+    double digitsMB = 0;  // of the hoisted runs
+    std::map<int64_t, LatencyHistogram> independent;
+    std::map<int64_t, LatencyHistogram> hoisted;
+};
+
+inline std::vector<RotationSeries>& RotationResults() {
+    static std::vector<RotationSeries> results;
+    return results;
+}
+
+inline void RecordRotations(const std::string& series, bool hoisted, int64_t k, const LatencyHistogram& latency,
+                            double digitsMB = 0) {
+    auto& results = RotationResults();
+    auto it       = std::find_if(results.begin(), results.end(),
+                                 [&](const RotationSeries& candidate) { return candidate.name == series; });
+    if (it == results.end()) {
+        it       = results.insert(results.end(), RotationSeries());
+        it->name = series;
+    }
+    (hoisted ? it->hoisted : it->independent)[k].Merge(latency);
+    it->digitsMB = std::max(it->digitsMB, digitsMB);
+}
+
+inline void PrintRotationBreakEven(std::ostream& out) {
+    const auto& results = RotationResults();
+    if (results.empty())
+        return;
+
+    out << "\nIndependent (t = r*k) against hoisted (t = P + h*k) rotations, fitted to the p50 latencies:\n";
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-36s %12s %12s %12s %10s %10s\n", "series", "r_ms", "P_ms", "h_ms",
+                  "digits_MB", "break-even");
+    out << line;
+    for (const auto& series : results) {
+        double sumKT = 0, sumKK = 0;
+        for (const auto& entry : series.independent) {
+            sumKT += entry.first * static_cast<double>(entry.second.Quantile(0.5));
+            sumKK += static_cast<double>(entry.first) * entry.first;
+        }
+        const double r = (sumKK > 0) ? sumKT / sumKK : NAN;
+
+        // Least squares over the hoisted runs; needs two distinct k.
+        double n = 0, sumK = 0, sumT = 0;
+        sumKT = sumKK = 0;
+        for (const auto& entry : series.hoisted) {
+            const double k = static_cast<double>(entry.first);
+            const double t = static_cast<double>(entry.second.Quantile(0.5));
+            n += 1;
+            sumK += k;
+            sumT += t;
+            sumKT += k * t;
+            sumKK += k * k;
+        }
+        const double denominator = n * sumKK - sumK * sumK;
+        const double h           = (n >= 2 && denominator > 0) ? (n * sumKT - sumK * sumT) / denominator : NAN;
+        const double p           = (n >= 2 && denominator > 0) ? (sumT - h * sumK) / n : NAN;
+
+        std::string breakEven = "n/a";
+        if (std::isfinite(r) && std::isfinite(h)) {
+            if (h >= r)
+                breakEven = "never";
+            else
+                breakEven = std::to_string(std::max<int64_t>(1, static_cast<int64_t>(std::ceil(p / (r - h)))));
+        }
+        std::snprintf(line, sizeof(line), "  %-36s %12.4f %12.4f %12.4f %10.2f %10s\n", series.name.c_str(), r * 1e-6,
+                      p * 1e-6, h * 1e-6, series.digitsMB, breakEven.c_str());
+        out << line;
+    }
+}
+
+inline const bool g_rotationBreakEvenRegistered = AddEpilogue(PrintRotationBreakEven);
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_ROTATIONS_H
@@ -0,0 +1,184 @@
+/*
+ * Serialization and deserialization benchmarks for ciphertexts and keys.
+ *
+ * Each scheme program describes an object in one format (binary or JSON, whatever its
+ * library offers) as a SerializedObject: how to write it to a stream and how to read
+ * it back. RunSerialization times one direction, optionally through zlib at a given
+ * level, and publishes:
+ *
+ *   Bytes         serialized size in the chosen format
+ *   Wire_bytes    bytes on the wire, i.e. after compression
+ *   Seeded_bytes  estimated size if every uniformly random component (the `a` parts of
+ *                 secret-key encryptions and key-switching keys) were shipped as a
+ *                 32-byte PRNG seed instead; neither OpenFHE nor HElib can serialize
+ *                 that way, so this is Bytes minus the serialized size of those
+ *                 components plus one seed each
+ *   MBps          serialized megabytes (Bytes) per second
+ *   Peak_heap_MB  heap growth at the peak of one operation, including its output
+ *
+ * Compression needs zlib; it is used when <zlib.h> is found (link with -lz) unless
+ * FHEBENCH_NO_ZLIB is defined, and the compressed variants report an error otherwise.
+ */
+
+#ifndef FHEBENCH_COMMON_SERIALIZATION_H
+#define FHEBENCH_COMMON_SERIALIZATION_H
+
+#include "benchmark/benchmark.h"
+
+#include "energy.h"
+#include "keystore.h"
+#include "latency.h"
+#include "memory.h"
+#include "perf_counters.h"
+
+#if __has_include(<zlib.h>) && !defined(FHEBENCH_NO_ZLIB)
+#include <zlib.h>
+#define FHEBENCH_HAVE_ZLIB 1
+#endif
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace fhebench {
+
+constexpr uint64_t kSeedBytes = 32;
+
+struct SerializedObject {
+    std::function<void(std::ostream&)> write;
+    // Reads one object and discards it.
+    std::function<void(std::istream&)> read;
+    // Serialized size, in the same format, of the uniformly random components, and the
+    // number of seeds that would regenerate them.
+    uint64_t uniformBytes = 0;
+    uint64_t numSeeds     = 0;
+};
+
+inline uint64_t SerializedSize(const std::function<void(std::ostream&)>& write) {
+    CountingStreamBuf counter;
+    std::ostream out(&counter);
+    write(out);
+    return counter.Count();
+}
+
+inline bool HaveCompression() {
+#ifdef FHEBENCH_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline std::string Compress(const std::string& data, int level) {
+#ifdef FHEBENCH_HAVE_ZLIB
+    uLongf size = compressBound(static_cast<uLong>(data.size()));
+    std::string out(size, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(&out[0]), &size, reinterpret_cast<const Bytef*>(data.data()),
+                  static_cast<uLong>(data.size()), level) != Z_OK)
+        throw std::runtime_error("zlib compression failed");
+    out.resize(size);
+    return out;
+#else
+    (void)level;
+    throw std::runtime_error("built without zlib");
+#endif
+}
+
+// originalSize is the size of the data before Compress().
+inline std::string Decompress(const std::string& data, size_t originalSize) {
+#ifdef FHEBENCH_HAVE_ZLIB
+    std::string out(originalSize, '\0');
+    uLongf size = static_cast<uLongf>(originalSize);
+    if (uncompress(reinterpret_cast<Bytef*>(&out[0]), &size, reinterpret_cast<const Bytef*>(data.data()),
+                   static_cast<uLong>(data.size())) != Z_OK ||
+        size != originalSize)
+        throw std::runtime_error("zlib decompression failed");
+    return out;
+#else
+    (void)data;
+    (void)originalSize;
+    throw std::runtime_error("built without zlib");
+#endif
+}
+
+/*
+ * Times object.write (deserialize = false) or object.read (deserialize = true) per
+ * iteration. zlibLevel > 0 compresses the serialized bytes after writing, or
+ * decompresses them before reading, inside the timed region.
+ */
+inline void RunSerialization(benchmark::State& state, const SerializedObject& object, bool deserialize,
+                             int zlibLevel) {
+    if (zlibLevel > 0 && !HaveCompression()) {
+        state.SkipWithError("built without zlib");
+        return;
+    }
+
+    auto writeOnce = [&]() {
+        std::ostringstream out;
+        object.write(out);
+        return zlibLevel > 0 ? Compress(out.str(), zlibLevel) : out.str();
+    };
+    std::string serialized;
+    {
+        std::ostringstream out;
+        object.write(out);
+        serialized = out.str();
+    }
+    const std::string wire = zlibLevel > 0 ? Compress(serialized, zlibLevel) : serialized;
+    auto readOnce          = [&]() {
+        if (zlibLevel > 0) {
+            std::string data = Decompress(wire, serialized.size());
+            MemoryStreamBuf buffer(data.data(), data.size());
+            std::istream in(&buffer);
+            object.read(in);
+            return;
+        }
+        MemoryStreamBuf buffer(wire.data(), wire.size());
+        std::istream in(&buffer);
+        object.read(in);
+    };
+
+    // One untimed operation for the peak heap growth.
+    const int64_t liveBefore = g_allocationCounters.liveBytes.load(std::memory_order_relaxed);
+    ResetPeakLiveBytes();
+    if (deserialize)
+        readOnce();
+    else
+        benchmark::DoNotOptimize(writeOnce());
+    const int64_t peakHeap = g_allocationCounters.peakLiveBytes.load(std::memory_order_relaxed) - liveBefore;
+
+    {
+        EnergyCounters energy(state);
+        PerfCounters perf(state);
+        LatencyRecorder latency(state);
+        for (auto _ : state) {
+            auto sample = latency.Measure();
+            if (deserialize) {
+                readOnce();
+                continue;
+            }
+            std::string out = writeOnce();
+            benchmark::DoNotOptimize(out);
+        }
+    }
+
+    const double bytes             = static_cast<double>(serialized.size());
+    state.counters["Bytes"]        = bytes;
+    state.counters["Wire_bytes"]   = static_cast<double>(wire.size());
+    state.counters["Seeded_bytes"] = bytes - object.uniformBytes + object.numSeeds * kSeedBytes;
+    state.counters["MBps"]         = benchmark::Counter(bytes / 1e6, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["Peak_heap_MB"] = peakHeap / 1048576.0;
+}
+
+// Arguments {json, zlib}: binary or JSON, no compression or zlib at levels 1 and 6.
+inline void SerializationArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"json", "zlib"})->ArgsProduct({{0, 1}, {0, 1, 6}});
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_SERIALIZATION_H
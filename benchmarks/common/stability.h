@@ -0,0 +1,469 @@
+/*
+ * A run controller for numbers that hold still: warm-up until the latency settles,
+ * adaptive repetition up to a target confidence interval, frequency and temperature
+ * monitoring, and interleaved A/B configurations.
+ *
+ * StabilityEngine takes one or more configurations (an operation each) and
+ *
+ *   1. calibrates how many operations fill one sample of at least minSampleSeconds;
+ *   2. warms up, sampling every configuration in turn, until the medians of the last
+ *      two windows of samples differ by less than settleTolerance (or warmupSeconds
+ *      runs out). The median frequency and temperature of the last window become the
+ *      configuration's reference;
+ *   3. measures in rounds that sample every configuration once, in ABBA order (every
+ *      other round reversed), so slow thermal drift lands on all of them alike;
+ *   4. discards a sample whose mean scaling_cur_freq (frequency.h) is more than
+ *      maxFrequencyDrift away from the reference, or whose temperature rose more than
+ *      maxTemperatureRise above it;
+ *   5. stops once every configuration has at least minSamples kept samples and a 95%
+ *      confidence interval (Student t) whose half-width is within ciTarget of the mean,
+ *      or when budgetSeconds of measurement have passed.
+ *
+ * The ratio of each configuration to the first is computed per round, from rounds
+ * where both samples were kept, with its own interval. The temperature is that of the
+ * x86_pkg_temp thermal zone (any CPU zone otherwise) under FHEBENCH_THERMAL_ROOT,
+ * default /sys/class/thermal. Without cpufreq or thermal zones the respective check is
+ * skipped.
+ *
+ * RunStable() runs the engine as one manual-time iteration of a benchmark (register it
+ * with ->Iterations(1)->UseManualTime()), so real_time is the mean time per operation
+ * of the first configuration. The targets come from the environment:
+ *
+ *   FHEBENCH_CI_TARGET       relative 95% CI half-width (default 0.01)
+ *   FHEBENCH_TIME_BUDGET     seconds of measurement per benchmark (default 120)
+ *   FHEBENCH_WARMUP_BUDGET   seconds of warm-up at most (default 30)
+ *   FHEBENCH_MAX_FREQ_DRIFT  relative frequency deviation to discard at (default 0.05)
+ *   FHEBENCH_MAX_TEMP_RISE   degrees C above the reference to discard at (default 10)
+ *
+ * and it publishes, with a "<name>_" prefix per configuration when there are several:
+ * CI_pct, Samples, Discarded, Drift_pct (discarded share), Warmup (samples), MHz and
+ * Temp_C of the kept samples; and Ratio with Ratio_CI_pct for A/B runs. The label says
+ * "not converged" or "drift" when the budget ran out or more than a fifth of the
+ * samples were discarded.
+ */
+
+#ifndef FHEBENCH_COMMON_STABILITY_H
+#define FHEBENCH_COMMON_STABILITY_H
+
+#include "benchmark/benchmark.h"
+
+#include "frequency.h"
+#include "memory.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace fhebench {
+
+struct StabilityOptions {
+    double ciTarget           = 0.01;
+    double budgetSeconds      = 120;
+    double warmupSeconds      = 30;
+    double settleTolerance    = 0.02;
+    size_t window             = 5;
+    size_t minSamples         = 5;
+    double minSampleSeconds   = 0.1;
+    double maxFrequencyDrift  = 0.05;
+    double maxTemperatureRise = 10;
+
+    static StabilityOptions FromEnvironment() {
+        StabilityOptions options;
+        auto read = [](const char* name, double* value) {
+            const char* env = std::getenv(name);
+            if (env != nullptr && std::strtod(env, nullptr) > 0)
+                *value = std::strtod(env, nullptr);
+        };
+        read("FHEBENCH_CI_TARGET", &options.ciTarget);
+        read("FHEBENCH_TIME_BUDGET", &options.budgetSeconds);
+        read("FHEBENCH_WARMUP_BUDGET", &options.warmupSeconds);
+        read("FHEBENCH_MAX_FREQ_DRIFT", &options.maxFrequencyDrift);
+        read("FHEBENCH_MAX_TEMP_RISE", &options.maxTemperatureRise);
+        return options;
+    }
+};
+
+// Two-sided 95% quantile of Student's t distribution.
+inline double StudentT95(size_t df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df == 0)
+        return std::numeric_limits<double>::infinity();
+    return df <= 30 ? table[df - 1] : 1.96 + 2.4 / static_cast<double>(df);
+}
+
+struct SampleStats {
+    size_t n         = 0;
+    double mean      = 0;
+    double halfWidth = std::numeric_limits<double>::infinity();  // of the 95% interval
+
+    double RelativeHalfWidth() const {
+        return mean != 0 ? halfWidth / std::fabs(mean) : std::numeric_limits<double>::infinity();
+    }
+
+    static SampleStats Of(const std::vector<double>& values) {
+        SampleStats stats;
+        stats.n = values.size();
+        if (stats.n == 0)
+            return stats;
+        for (double v : values)
+            stats.mean += v;
+        stats.mean /= static_cast<double>(stats.n);
+        if (stats.n < 2)
+            return stats;
+        double squares = 0;
+        for (double v : values)
+            squares += (v - stats.mean) * (v - stats.mean);
+        const double stddev = std::sqrt(squares / static_cast<double>(stats.n - 1));
+        stats.halfWidth     = StudentT95(stats.n - 1) * stddev / std::sqrt(static_cast<double>(stats.n));
+        return stats;
+    }
+};
+
+inline double Median(std::vector<double> values) {
+    if (values.empty())
+        return std::numeric_limits<double>::quiet_NaN();
+    std::sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+inline std::string ThermalRoot() {
+    const char* root = std::getenv("FHEBENCH_THERMAL_ROOT");
+    return (root != nullptr && *root != '\0') ? std::string(root) : std::string("/sys/class/thermal");
+}
+
+class ThermalSensor {
+public:
+    explicit ThermalSensor(const std::string& root = ThermalRoot()) {
+        DIR* dir = opendir(root.c_str());
+        if (dir == nullptr)
+            return;
+        // Lower rank wins: the package sensor, then any CPU sensor, then ACPI.
+        int best = 4;
+        while (struct dirent* entry = readdir(dir)) {
+            std::string zone(entry->d_name);
+            if (zone.compare(0, 12, "thermal_zone") != 0)
+                continue;
+            std::ifstream in(root + "/" + zone + "/type");
+            std::string type;
+            std::getline(in, type);
+            int rank = 3;
+            if (type == "x86_pkg_temp")
+                rank = 0;
+            else if (type.find("cpu") != std::string::npos || type == "coretemp" || type == "k10temp")
+                rank = 1;
+            else if (type == "acpitz")
+                rank = 2;
+            const std::string file = root + "/" + zone + "/temp";
+            if (rank < best && !std::isnan(Read(file))) {
+                best   = rank;
+                m_file = file;
+            }
+        }
+        closedir(dir);
+    }
+
+    bool Available() const {
+        return !m_file.empty();
+    }
+
+    // Degrees Celsius; NaN without a sensor.
+    double Celsius() const {
+        return m_file.empty() ? std::numeric_limits<double>::quiet_NaN() : Read(m_file);
+    }
+
+private:
+    static double Read(const std::string& file) {
+        std::ifstream in(file);
+        double milli = 0;
+        if (!(in >> milli))
+            return std::numeric_limits<double>::quiet_NaN();
+        return milli / 1000.0;
+    }
+
+    std::string m_file;
+};
+
+class StabilityEngine {
+public:
+    struct Config {
+        std::string name;
+        std::function<void()> operation;
+    };
+
+    struct Sample {
+        double seconds;  // per operation
+        double mhz;      // NaN without cpufreq
+        double celsius;  // NaN without a thermal sensor
+        bool kept;
+    };
+
+    struct Result {
+        std::string name;
+        size_t opsPerSample  = 1;
+        size_t warmupSamples = 0;
+        bool settled         = false;
+        double referenceMHz  = std::numeric_limits<double>::quiet_NaN();
+        double referenceC    = std::numeric_limits<double>::quiet_NaN();
+        std::vector<Sample> samples;  // measurement samples in round order, kept or not
+
+        std::vector<double> Kept() const {
+            std::vector<double> seconds;
+            for (const auto& s : samples) {
+                if (s.kept)
+                    seconds.push_back(s.seconds);
+            }
+            return seconds;
+        }
+        SampleStats Stats() const {
+            return SampleStats::Of(Kept());
+        }
+        size_t Discarded() const {
+            return samples.size() - Kept().size();
+        }
+    };
+
+    StabilityEngine(std::vector<Config> configs, const StabilityOptions& options)
+        : m_configs(std::move(configs)), m_options(options) {
+        for (const auto& config : m_configs) {
+            Result result;
+            result.name = config.name;
+            m_results.push_back(result);
+        }
+        const AffinityState& affinity = CurrentAffinity();
+        m_cpus = affinity.cpus.empty() ? FrequencySampler::OnlineCpus() : affinity.cpus;
+    }
+
+    void Run() {
+        Calibrate();
+        Warmup();
+        Measure();
+    }
+
+    const std::vector<Result>& Results() const {
+        return m_results;
+    }
+
+    bool Converged() const {
+        return m_converged;
+    }
+
+    // Configuration i over the first, from rounds where both samples were kept.
+    SampleStats Ratio(size_t i) const {
+        std::vector<double> ratios;
+        const auto& base  = m_results[0].samples;
+        const auto& other = m_results[i].samples;
+        for (size_t r = 0; r < std::min(base.size(), other.size()); ++r) {
+            if (base[r].kept && other[r].kept && base[r].seconds > 0)
+                ratios.push_back(other[r].seconds / base[r].seconds);
+        }
+        return SampleStats::Of(ratios);
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static double Since(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    Sample TakeSample(size_t c) {
+        const size_t ops = m_results[c].opsPerSample;
+        FrequencySampler frequency(m_cpus);
+        const auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i)
+            m_configs[c].operation();
+        const double seconds = Since(start);
+        FrequencyStats stats = frequency.Stop();
+
+        Sample sample;
+        sample.seconds = seconds / static_cast<double>(ops);
+        sample.mhz     = stats.samples ? stats.meanMHz : std::numeric_limits<double>::quiet_NaN();
+        sample.celsius = m_thermal.Celsius();
+        sample.kept    = true;
+        return sample;
+    }
+
+    // Every other round runs the configurations in reverse.
+    std::vector<size_t> RoundOrder(size_t round) const {
+        std::vector<size_t> order;
+        for (size_t c = 0; c < m_configs.size(); ++c)
+            order.push_back(round % 2 ? m_configs.size() - 1 - c : c);
+        return order;
+    }
+
+    void Calibrate() {
+        for (size_t c = 0; c < m_configs.size(); ++c) {
+            const auto start = Clock::now();
+            m_configs[c].operation();
+            const double seconds = std::max(Since(start), 1e-9);
+            m_results[c].opsPerSample =
+                static_cast<size_t>(std::max(1.0, std::ceil(m_options.minSampleSeconds / seconds)));
+        }
+    }
+
+    void Warmup() {
+        const size_t window = std::max<size_t>(m_options.window, 1);
+        std::vector<std::vector<Sample>> history(m_configs.size());
+        const auto start = Clock::now();
+        bool settled     = false;
+        for (size_t round = 0; !settled && Since(start) < m_options.warmupSeconds; ++round) {
+            for (size_t c : RoundOrder(round))
+                history[c].push_back(TakeSample(c));
+            settled = true;
+            for (size_t c = 0; c < m_configs.size(); ++c) {
+                m_results[c].settled = Settled(history[c], window);
+                settled              = settled && m_results[c].settled;
+            }
+        }
+
+        for (size_t c = 0; c < m_configs.size(); ++c) {
+            const auto& samples = history[c];
+            std::vector<double> mhz, celsius;
+            for (size_t i = samples.size() - std::min(samples.size(), window); i < samples.size(); ++i) {
+                if (!std::isnan(samples[i].mhz))
+                    mhz.push_back(samples[i].mhz);
+                if (!std::isnan(samples[i].celsius))
+                    celsius.push_back(samples[i].celsius);
+            }
+            m_results[c].warmupSamples = samples.size();
+            m_results[c].referenceMHz  = Median(mhz);
+            m_results[c].referenceC    = Median(celsius);
+        }
+    }
+
+    bool Settled(const std::vector<Sample>& samples, size_t window) const {
+        if (samples.size() < 2 * window)
+            return false;
+        std::vector<double> previous, last;
+        for (size_t i = samples.size() - 2 * window; i < samples.size(); ++i)
+            (i < samples.size() - window ? previous : last).push_back(samples[i].seconds);
+        const double before = Median(previous);
+        return std::fabs(Median(last) - before) <= m_options.settleTolerance * before;
+    }
+
+    bool Drifted(const Sample& sample, const Result& result) const {
+        if (!std::isnan(sample.mhz) && !std::isnan(result.referenceMHz) &&
+            std::fabs(sample.mhz - result.referenceMHz) > m_options.maxFrequencyDrift * result.referenceMHz)
+            return true;
+        return !std::isnan(sample.celsius) && !std::isnan(result.referenceC) &&
+               sample.celsius - result.referenceC > m_options.maxTemperatureRise;
+    }
+
+    void Measure() {
+        const auto start = Clock::now();
+        for (size_t round = 0; Since(start) < m_options.budgetSeconds; ++round) {
+            for (size_t c : RoundOrder(round)) {
+                Sample sample = TakeSample(c);
+                sample.kept   = !Drifted(sample, m_results[c]);
+                m_results[c].samples.push_back(sample);
+            }
+            bool converged = true;
+            for (const auto& result : m_results) {
+                SampleStats stats = result.Stats();
+                if (stats.n < m_options.minSamples || stats.RelativeHalfWidth() > m_options.ciTarget)
+                    converged = false;
+            }
+            m_converged = converged;
+            if (m_converged)
+                break;
+        }
+    }
+
+    std::vector<Config> m_configs;
+    StabilityOptions m_options;
+    std::vector<Result> m_results;
+    std::vector<int> m_cpus;
+    ThermalSensor m_thermal;
+    bool m_converged = false;
+};
+
+/*
+ * Runs the configurations through the StabilityEngine as the single iteration of a
+ * benchmark registered with ->Iterations(1)->UseManualTime(). Google Benchmark's extra
+ * memory run executes each operation once instead.
+ */
+inline void RunStable(benchmark::State& state, std::vector<StabilityEngine::Config> configs,
+                      const StabilityOptions& options = StabilityOptions::FromEnvironment()) {
+    if (g_memoryRunActive.load(std::memory_order_relaxed)) {
+        for (auto _ : state) {
+            for (const auto& config : configs)
+                config.operation();
+        }
+        return;
+    }
+
+    StabilityEngine engine(std::move(configs), options);
+    for (auto _ : state) {
+        engine.Run();
+        const SampleStats first = engine.Results()[0].Stats();
+        if (first.n == 0) {
+            state.SkipWithError("every sample was discarded for frequency or temperature drift");
+            break;
+        }
+        state.SetIterationTime(first.mean);
+    }
+    if (state.error_occurred())
+        return;
+
+    const auto& results = engine.Results();
+    size_t samples      = 0;
+    size_t discarded    = 0;
+    for (const auto& result : results) {
+        const std::string prefix = results.size() > 1 ? result.name + "_" : "";
+        const SampleStats stats  = result.Stats();
+        std::vector<double> mhz, celsius;
+        for (const auto& sample : result.samples) {
+            if (sample.kept && !std::isnan(sample.mhz))
+                mhz.push_back(sample.mhz);
+            if (sample.kept && !std::isnan(sample.celsius))
+                celsius.push_back(sample.celsius);
+        }
+        if (results.size() > 1)
+            state.counters[prefix + "s"] = stats.mean;
+        if (std::isfinite(stats.RelativeHalfWidth()))
+            state.counters[prefix + "CI_pct"] = 100 * stats.RelativeHalfWidth();
+        state.counters[prefix + "Samples"]   = static_cast<double>(stats.n);
+        state.counters[prefix + "Discarded"] = static_cast<double>(result.Discarded());
+        state.counters[prefix + "Drift_pct"] =
+            result.samples.empty() ? 0 : 100.0 * result.Discarded() / static_cast<double>(result.samples.size());
+        state.counters[prefix + "Warmup"] = static_cast<double>(result.warmupSamples);
+        if (!mhz.empty())
+            state.counters[prefix + "MHz"] = SampleStats::Of(mhz).mean;
+        if (!celsius.empty())
+            state.counters[prefix + "Temp_C"] = SampleStats::Of(celsius).mean;
+        samples += result.samples.size();
+        discarded += result.Discarded();
+    }
+    for (size_t i = 1; i < results.size(); ++i) {
+        const SampleStats ratio = engine.Ratio(i);
+        const std::string name  = results.size() > 2 ? "Ratio_" + results[i].name : "Ratio";
+        if (ratio.n == 0)
+            continue;
+        state.counters[name] = ratio.mean;
+        if (std::isfinite(ratio.RelativeHalfWidth()))
+            state.counters[name + "_CI_pct"] = 100 * ratio.RelativeHalfWidth();
+    }
+
+    std::string label;
+    if (!engine.Converged())
+        label = "not converged";
+    if (samples > 0 && 5 * discarded > samples)
+        label += std::string(label.empty() ? "" : ", ") + "drift";
+    if (!label.empty())
+        state.SetLabel(label);
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_STABILITY_H
@@ -0,0 +1,234 @@
+/*
+ * Call hooks on functions inside the shared libraries a benchmark links against, for
+ * attributing time and operation counts to the internals of a library call.
+ *
+ * Calls into and within a shared library go through its global offset table, and
+ * virtual calls through vtables; the dynamic linker fills those slots with the address
+ * of each symbol. HookSymbol() rewrites every such slot of one function in the loaded
+ * libraries whose path contains a given substring, so the calls land in a replacement
+ * that records what it needs and forwards to the original. The function is named by its
+ * qualified name, and its parameter list is compared with the replacement's (both
+ * demangled), so a library whose signature differs is left alone.
+ *
+ * The replacement is a free function taking the object pointer first, which is how the
+ * Itanium C++ ABI passes `this`. Calls that do not go through those slots (static
+ * builds, -Bsymbolic, hidden visibility, inlined calls) are not seen; HookSymbol()
+ * returns false when it found nothing to rewrite. ELF (Linux) only.
+ */
+
+#ifndef FHEBENCH_COMMON_SYMBOL_HOOKS_H
+#define FHEBENCH_COMMON_SYMBOL_HOOKS_H
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace fhebench {
+
+inline std::string Demangle(const char* name) {
+    int status  = 0;
+    char* plain = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status != 0 || plain == nullptr)
+        return name;
+    std::string result(plain);
+    std::free(plain);
+    return result;
+}
+
+// The parenthesized list starting at text[open], including the parentheses.
+inline std::string BalancedParentheses(const std::string& text, size_t open) {
+    int depth = 0;
+    for (size_t i = open; i < text.size(); ++i) {
+        if (text[i] == '(')
+            ++depth;
+        else if (text[i] == ')' && --depth == 0)
+            return text.substr(open, i - open + 1);
+    }
+    return "";
+}
+
+// Demangled parameter list of a function type, e.g. "(int, double const&)".
+template <typename... Args>
+std::string ParameterList() {
+    std::string type = Demangle(typeid(void(Args...)).name());
+    size_t open      = type.find('(');
+    return open == std::string::npos ? "" : BalancedParentheses(type, open);
+}
+
+namespace detail {
+
+struct HookRequest {
+    std::string qualifiedName;
+    std::string parameters;
+    std::string library;
+    void* replacement;
+    void* original;
+    size_t slots;
+};
+
+inline bool IsSymbolRelocation(uint64_t type) {
+#if defined(__x86_64__)
+    return type == R_X86_64_JUMP_SLOT || type == R_X86_64_GLOB_DAT || type == R_X86_64_64;
+#elif defined(__aarch64__)
+    return type == R_AARCH64_JUMP_SLOT || type == R_AARCH64_GLOB_DAT || type == R_AARCH64_ABS64;
+#else
+    (void)type;
+    return false;
+#endif
+}
+
+inline bool Matches(const char* mangled, HookRequest& request) {
+    // Cheap filter before demangling: the unqualified name appears verbatim.
+    std::string last = request.qualifiedName.substr(request.qualifiedName.rfind("::") + 2);
+    if (std::strstr(mangled, last.c_str()) == nullptr)
+        return false;
+    std::string plain = Demangle(mangled);
+    std::string head  = request.qualifiedName + "(";
+    return plain.compare(0, head.size(), head) == 0 &&
+           BalancedParentheses(plain, head.size() - 1) == request.parameters;
+}
+
+// Protection of the loaded page at address: the flags of its PT_LOAD segment, without
+// write access inside PT_GNU_RELRO, which the loader makes read-only after relocation.
+// -1 when the address is outside the object.
+inline int LoadedProtection(const struct dl_phdr_info* info, uintptr_t address) {
+    int protection = -1;
+    bool relro     = false;
+    for (int i = 0; i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr)& segment = info->dlpi_phdr[i];
+        const uintptr_t begin     = info->dlpi_addr + segment.p_vaddr;
+        if (address < begin || address >= begin + segment.p_memsz)
+            continue;
+        if (segment.p_type == PT_LOAD)
+            protection = ((segment.p_flags & PF_R) ? PROT_READ : 0) | ((segment.p_flags & PF_W) ? PROT_WRITE : 0) |
+                         ((segment.p_flags & PF_X) ? PROT_EXEC : 0);
+        else if (segment.p_type == PT_GNU_RELRO)
+            relro = true;
+    }
+    if (relro && protection != -1)
+        protection &= ~PROT_WRITE;
+    return protection;
+}
+
+// Writes value into slot, making its page writable for the write only. An aligned slot
+// lies within one page. Returns whether the slot was written.
+inline bool Rewrite(const struct dl_phdr_info* info, void** slot, void* value) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(slot);
+    const int protection    = LoadedProtection(info, address);
+    if (protection == -1 || address % alignof(void*) != 0)
+        return false;
+    if (protection & PROT_WRITE) {
+        *slot = value;
+        return true;
+    }
+
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    void* page               = reinterpret_cast<void*>(address & ~(pageSize - 1));
+    if (mprotect(page, pageSize, protection | PROT_WRITE) != 0)
+        return false;
+    *slot = value;
+    mprotect(page, pageSize, protection);
+    return true;
+}
+
+inline int PatchObject(struct dl_phdr_info* info, size_t, void* data) {
+    auto& request = *static_cast<HookRequest*>(data);
+    if (info->dlpi_name == nullptr || std::strstr(info->dlpi_name, request.library.c_str()) == nullptr)
+        return 0;
+
+    const ElfW(Addr) base    = info->dlpi_addr;
+    const ElfW(Dyn)* dynamic = nullptr;
+    for (int i = 0; i < info->dlpi_phnum; ++i) {
+        if (info->dlpi_phdr[i].p_type == PT_DYNAMIC)
+            dynamic = reinterpret_cast<const ElfW(Dyn)*>(base + info->dlpi_phdr[i].p_vaddr);
+    }
+    if (dynamic == nullptr)
+        return 0;
+
+    // The loader relocates these entries in place on most targets; add the base otherwise.
+    auto address                = [base](ElfW(Addr) a) { return a < base ? a + base : a; };
+    const ElfW(Sym)* symbols    = nullptr;
+    const char* strings         = nullptr;
+    const ElfW(Rela)* tables[2] = {nullptr, nullptr};
+    size_t sizes[2]             = {0, 0};
+    for (const ElfW(Dyn)* d = dynamic; d->d_tag != DT_NULL; ++d) {
+        switch (d->d_tag) {
+            case DT_SYMTAB:
+                symbols = reinterpret_cast<const ElfW(Sym)*>(address(d->d_un.d_ptr));
+                break;
+            case DT_STRTAB:
+                strings = reinterpret_cast<const char*>(address(d->d_un.d_ptr));
+                break;
+            case DT_JMPREL:
+                tables[0] = reinterpret_cast<const ElfW(Rela)*>(address(d->d_un.d_ptr));
+                break;
+            case DT_PLTRELSZ:
+                sizes[0] = d->d_un.d_val;
+                break;
+            case DT_RELA:
+                tables[1] = reinterpret_cast<const ElfW(Rela)*>(address(d->d_un.d_ptr));
+                break;
+            case DT_RELASZ:
+                sizes[1] = d->d_un.d_val;
+                break;
+        }
+    }
+    if (symbols == nullptr || strings == nullptr)
+        return 0;
+
+    // PLT slots, then data slots: GOT entries of address-taken functions and vtables.
+    for (int t = 0; t < 2; ++t) {
+        if (tables[t] == nullptr)
+            continue;
+        for (size_t i = 0; i < sizes[t] / sizeof(ElfW(Rela)); ++i) {
+            const ElfW(Rela)& rela = tables[t][i];
+            const uint32_t index   = static_cast<uint32_t>(ELF64_R_SYM(rela.r_info));
+            if (index == 0 || rela.r_addend != 0 || !IsSymbolRelocation(ELF64_R_TYPE(rela.r_info)))
+                continue;
+            const char* name = strings + symbols[index].st_name;
+            if (!Matches(name, request))
+                continue;
+            if (request.original == nullptr)
+                request.original = dlsym(RTLD_DEFAULT, name);
+            if (request.original == nullptr)
+                continue;
+            if (Rewrite(info, reinterpret_cast<void**>(base + rela.r_offset), request.replacement))
+                request.slots++;
+        }
+    }
+    return 0;
+}
+
+}  // namespace detail
+
+/*
+ * Redirects calls of qualifiedName (e.g. "lbcrypto::KeySwitchHYBRID::KeySwitchCore") made
+ * through the libraries whose path contains library to replacement, and stores the
+ * original in *original. The parameters of replacement after the object pointer must be
+ * those of the hooked member function.
+ */
+template <typename R, typename Self, typename... Args>
+bool HookSymbol(const std::string& library, const std::string& qualifiedName, R (*replacement)(Self, Args...),
+                R (**original)(Self, Args...)) {
+    detail::HookRequest request{qualifiedName, ParameterList<Args...>(), library,
+                                reinterpret_cast<void*>(replacement), nullptr, 0};
+    dl_iterate_phdr(detail::PatchObject, &request);
+    if (request.slots == 0 || request.original == nullptr)
+        return false;
+    *original = reinterpret_cast<R (*)(Self, Args...)>(request.original);
+    return true;
+}
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_SYMBOL_HOOKS_H
@@ -0,0 +1,167 @@
+/*
+ * A small work-stealing pool for batches of independent, coarse-grained tasks such as
+ * bootstrapped gate evaluations.
+ *
+ * ParallelFor(n, body) deals [0, n) out to the workers in contiguous blocks; each worker
+ * pops from the back of its own deque and, once that is empty, steals from the front of
+ * the others, so uneven task times do not leave cores idle at the end of a batch. The
+ * calling thread is worker 0, and the remaining threads persist across batches.
+ */
+
+#ifndef FHEBENCH_COMMON_THREAD_POOL_H
+#define FHEBENCH_COMMON_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fhebench {
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t numThreads) {
+        if (numThreads == 0)
+            numThreads = 1;
+        for (size_t i = 0; i < numThreads; ++i)
+            m_queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 1; i < numThreads; ++i)
+            m_threads.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&)            = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t Size() const {
+        return m_queues.size();
+    }
+
+    // Runs body(i) for every i in [0, n) and returns once all of them have finished.
+    // The first exception thrown by body is rethrown here.
+    void ParallelFor(size_t n, std::function<void(size_t)> body) {
+        if (n == 0)
+            return;
+        // The body and task count are published before any task becomes visible: a
+        // worker still draining the previous batch may pick up a new task as soon as it
+        // is queued.
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_body  = std::move(body);
+            m_error = nullptr;
+            m_remaining.store(n, std::memory_order_relaxed);
+        }
+        const size_t numQueues = m_queues.size();
+        for (size_t w = 0; w < numQueues; ++w) {
+            std::lock_guard<std::mutex> lock(m_queues[w]->mutex);
+            for (size_t i = w * n / numQueues; i < (w + 1) * n / numQueues; ++i)
+                m_queues[w]->tasks.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_generation;
+        }
+        m_start.notify_all();
+
+        Drain(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_remaining.load(std::memory_order_acquire) == 0; });
+        m_body = nullptr;
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void WorkerLoop(size_t id) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_stop || m_generation != seen; });
+                if (m_stop)
+                    return;
+                seen = m_generation;
+            }
+            Drain(id);
+        }
+    }
+
+    bool Pop(size_t id, size_t* task) {
+        Queue& own = *m_queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.tasks.empty())
+            return false;
+        *task = own.tasks.back();
+        own.tasks.pop_back();
+        return true;
+    }
+
+    bool Steal(size_t id, size_t* task) {
+        const size_t numQueues = m_queues.size();
+        for (size_t k = 1; k < numQueues; ++k) {
+            Queue& victim = *m_queues[(id + k) % numQueues];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                *task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Drain(size_t id) {
+        size_t task;
+        while (Pop(id, &task) || Steal(id, &task)) {
+            try {
+                m_body(task);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_error)
+                    m_error = std::current_exception();
+            }
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    std::function<void(size_t)> m_body;
+    std::exception_ptr m_error;
+    std::atomic<size_t> m_remaining{0};
+    uint64_t m_generation = 0;
+    bool m_stop           = false;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_THREAD_POOL_H
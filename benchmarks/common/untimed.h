@@ -0,0 +1,51 @@
+/*
+ * Untimed work inside a timed loop. UntimedScope pauses the Google Benchmark timer and
+ * the energy and perf counters for its lifetime, in that order, and resumes them in
+ * reverse order, so every counter that runs next to the timer skips the same work:
+ *
+ *   for (auto _ : state) {
+ *       {
+ *           fhebench::UntimedScope untimed(state, energy, perf);
+ *           copy = ciphertext;
+ *       }
+ *       ...
+ *   }
+ */
+
+#ifndef FHEBENCH_COMMON_UNTIMED_H
+#define FHEBENCH_COMMON_UNTIMED_H
+
+#include "benchmark/benchmark.h"
+
+#include "energy.h"
+#include "perf_counters.h"
+
+namespace fhebench {
+
+class UntimedScope {
+public:
+    UntimedScope(benchmark::State& state, EnergyCounters& energy, PerfCounters& perf)
+        : m_state(state), m_energy(energy), m_perf(perf) {
+        m_state.PauseTiming();
+        m_perf.Pause();
+        m_energy.Pause();
+    }
+
+    ~UntimedScope() {
+        m_energy.Resume();
+        m_perf.Resume();
+        m_state.ResumeTiming();
+    }
+
+    UntimedScope(const UntimedScope&)            = delete;
+    UntimedScope& operator=(const UntimedScope&) = delete;
+
+private:
+    benchmark::State& m_state;
+    EnergyCounters& m_energy;
+    PerfCounters& m_perf;
+};
+
+}  // namespace fhebench
+
+#endif  // FHEBENCH_COMMON_UNTIMED_H
@@ -33,6 +33,16 @@
 
 namespace benchmark {
 
+// Bootstrapping phases split out by benchmarks/CKKS/ckks_phases.h, which
+// publishes <Phase>_s, <Phase>_KS and <Phase>_NTT per bootstrap.
+static const char* const kBootstrapPhases[] = {"ModRaise", "CoeffsToSlots",
+                                               "EvalMod", "SlotsToCoeffs"};
+
+static bool HasPhaseCounters(const UserCounters& counters) {
+  return counters.find(std::string(kBootstrapPhases[0]) + "_s") !=
+         counters.end();
+}
+
 bool ConsoleReporter::ReportContext(const Context& context) {
   name_field_width_ = context.name_field_width;
   printed_header_ = false;
@@ -53,10 +63,19 @@ bool ConsoleReporter::ReportContext(const Context& context) {
 }
 
 void ConsoleReporter::PrintHeader(const Run& run) {
-  std::string str = FormatString("%-*s %13s %15s %15s %15s %15s %15s %15s",
+  std::string str = FormatString("%-*s %13s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s %15s",
                                  static_cast<int>(name_field_width_),
-                                 "Benchmark", "Real Time", "CPU Time", "Latency",
-                                 "Throughput", "Power_W", "RSS_kB", "Iterations");
+                                 "Benchmark", "Real Time", "CPU Time", "Slack",
+                                 "p50", "p90", "p99", "Max", "Throughput", "Power_W", "Energy_J", "RSS_kB",
+                                 "Allocs", "Alloc_kB", "IPC", "LLC_MPKI", "dTLB_MPKI", "Branch_MPKI",
+                                 "Iterations");
+  if (HasPhaseCounters(run.counters)) {
+    for (const char* phase : kBootstrapPhases) {
+      const std::string name(phase);
+      str += FormatString(" %15s %15s %15s", name.c_str(),
+                          (name + "_KS").c_str(), (name + "_NTT").c_str());
+    }
+  }
   if (!run.counters.empty()) {
   //   if (output_options_ & OO_Tabular) {
   //     for (auto const& c : run.counters) {
@@ -71,7 +90,16 @@ void ConsoleReporter::PrintHeader(const Run& run) {
 }
 
 void ConsoleReporter::ReportRuns(const std::vector<Run>& reports) {
+  // The memory results of a benchmark's repetitions live in a vector that
+  // grows with every repetition, so only the last repetition's memory_result
+  // pointer is still valid here; the others are printed as n/a.
+  const Run* memory_run = nullptr;
   for (const auto& run : reports) {
+    if (run.memory_result != nullptr) memory_run = &run;
+  }
+  for (const auto& report : reports) {
+    Run run = report;
+    if (&report != memory_run) run.memory_result = nullptr;
     // print the header:
     // --- if none was printed yet
     bool print_header = !printed_header_;
@@ -79,6 +107,9 @@ void ConsoleReporter::ReportRuns(const std::vector<Run>& reports) {
     //     has different fields from the prev header
     print_header |= (output_options_ & OO_Tabular) &&
                     (!internal::SameNames(run.counters, prev_counters_));
+    // --- or if the bootstrapping phase columns come or go
+    print_header |= HasPhaseCounters(run.counters) !=
+                    HasPhaseCounters(prev_counters_);
     if (print_header) {
       printed_header_ = true;
       prev_counters_ = run.counters;
@@ -113,6 +144,29 @@ static std::string FormatTime(double time) {
   return FormatString("%10.0f", time);
 }
 
+// Counters published by benchmarks/common (e.g. Power_W from the RAPL sampler)
+// are absent when the underlying source is unavailable; print them as n/a
+// rather than as a misleading zero.
+static std::string FormatCounter(const UserCounters& counters,
+                                 const char* name) {
+  auto it = counters.find(name);
+  if (it == counters.end()) {
+    return FormatString("%12s", "n/a");
+  }
+  return FormatString("%12.2f", it->second.value);
+}
+
+// Per-iteration latency percentiles from benchmarks/common/latency.h, published
+// in seconds and printed in the time unit of the benchmark.
+static std::string FormatLatencyCounter(const UserCounters& counters,
+                                        const char* name, double multiplier) {
+  auto it = counters.find(name);
+  if (it == counters.end()) {
+    return FormatString("%10s", "n/a");
+  }
+  return FormatTime(it->second.value * multiplier);
+}
+
 void ConsoleReporter::PrintRunData(const Run& result) {
   typedef void(PrinterFn)(std::ostream&, LogColor, const char*, ...);
   auto& Out = GetOutputStream();
@@ -134,49 +188,117 @@ void ConsoleReporter::PrintRunData(const Run& result) {
   const double cpu_time = result.GetAdjustedCPUTime();
   const std::string real_time_str = FormatTime(real_time);
   const std::string cpu_time_str = FormatTime(cpu_time);
-  const std::string latency_str = FormatTime(real_time - cpu_time);
+  // Slack is wall time not spent on this thread's CPU (waiting, I/O, other
+  // threads); the latency distribution is in the p50...Max columns.
+  const std::string slack_str = FormatTime(real_time - cpu_time);
+  const double multiplier = GetTimeUnitMultiplier(result.time_unit);
+  const std::string p50_str =
+      FormatLatencyCounter(result.counters, "Lat_p50", multiplier);
+  const std::string p90_str =
+      FormatLatencyCounter(result.counters, "Lat_p90", multiplier);
+  const std::string p99_str =
+      FormatLatencyCounter(result.counters, "Lat_p99", multiplier);
+  const std::string max_str =
+      FormatLatencyCounter(result.counters, "Lat_max", multiplier);
   // Convert real_time to seconds for throughput calculation
-  const double real_time_seconds =
-      real_time / GetTimeUnitMultiplier(result.time_unit);
+  const double real_time_seconds = real_time / multiplier;
 
-  // NOTE: Throughput should be slots/cpu_time, but we don't have the number of slots in this
+  // Throughput is slots/second for benchmarks that publish a Slots counter
+  // (the CKKS bootstraps), and operations/second otherwise. Batched
+  // benchmarks publish Ops, the number of operations per iteration. real_time
+  // is already per iteration, so the iteration count does not enter here.
+  auto slots_it = result.counters.find("Slots");
+  const double slots_per_op =
+      (slots_it != result.counters.end()) ? slots_it->second.value : 1.0;
+  auto ops_it = result.counters.find("Ops");
+  const double ops_per_iter =
+      (ops_it != result.counters.end()) ? ops_it->second.value : 1.0;
   const std::string throughput_str =
-      FormatTime(static_cast<double>(result.iterations)  / real_time_seconds);
+      FormatTime(slots_per_op * ops_per_iter / real_time_seconds);
+
+  // RSS (kB) and heap allocations per iteration come from the memory manager
+  // in benchmarks/common/memory.h, which reports peak RSS as max_bytes_used.
+  // An explicit RSS_kB counter takes precedence.
+  std::string rss_str = FormatCounter(result.counters, "RSS_kB");
+  std::string allocs_str = FormatString("%12s", "n/a");
+  std::string alloc_kb_str = FormatString("%12s", "n/a");
+  if (result.memory_result != nullptr) {
+    const MemoryManager::Result& memory = *result.memory_result;
+    if (result.counters.find("RSS_kB") == result.counters.end()) {
+      rss_str = FormatString("%12.0f", memory.max_bytes_used / 1024.0);
+    }
+    allocs_str = FormatString("%12.1f", result.allocs_per_iter);
+    // num_allocs / allocs_per_iter recovers the iteration count of the
+    // memory run, which the Run does not carry.
+    if (memory.total_allocated_bytes != MemoryManager::TombstoneValue) {
+      const double bytes_per_iter =
+          memory.num_allocs > 0
+              ? memory.total_allocated_bytes * result.allocs_per_iter /
+                    static_cast<double>(memory.num_allocs)
+              : 0.0;
+      alloc_kb_str = FormatString("%12.1f", bytes_per_iter / 1024.0);
+    }
+  }
 
-  // RSS (kB)
-  auto rss_it = result.counters.find("RSS_kB");
-  double rss_val = (rss_it != result.counters.end()) ? rss_it->second.value : 0.0;
+  // Power (W) is the average over the timed loop, Energy (J) is per iteration
+  const std::string power_str = FormatCounter(result.counters, "Power_W");
+  const std::string energy_str = FormatCounter(result.counters, "Energy_J");
 
-  // Power (W)
-  auto power_it = result.counters.find("Power_W");
-  double power_val = (power_it != result.counters.end()) ? (power_it->second.value/real_time) : 0.0;
+  // Hardware counters from benchmarks/common/perf_counters.h: instructions per
+  // cycle and misses per thousand instructions, n/a without perf events.
+  const std::string ipc_str = FormatCounter(result.counters, "IPC");
+  const std::string llc_str = FormatCounter(result.counters, "LLC_MPKI");
+  const std::string tlb_str = FormatCounter(result.counters, "dTLB_MPKI");
+  const std::string branch_str = FormatCounter(result.counters, "Branch_MPKI");
 
 
+  // The complexity rows carry no per-iteration data, only the fitted
+  // coefficients (time unit per unit of the complexity term, printed with %g
+  // as they are often tiny, e.g. ms per N*lgN) and the normalized RMS of the
+  // fit. Slack is real minus CPU time, which for the least-squares
+  // coefficients is the coefficient of the slack itself.
   if (result.report_big_o) {
     std::string big_o = GetBigOString(result.complexity);
-    printer(Out, COLOR_YELLOW,
-            "%10.2f %-4s %10.2f %-4s %10.2f %-4s", real_time,
-            big_o.c_str(), cpu_time, big_o.c_str(), 
-            latency_str.c_str(),
-            big_o.c_str(), throughput_str.c_str(), big_o.c_str());
+    printer(Out, COLOR_YELLOW, "%10.4g %-4s %10.4g %-4s %10.4g %-4s", real_time,
+            big_o.c_str(), cpu_time, big_o.c_str(), real_time - cpu_time,
+            big_o.c_str());
   } else if (result.report_rms) {
-    printer(Out, COLOR_YELLOW,
-            "%10.0f %-4s %10.0f %-4s %10.0f %-4s %12.2f %-4s %12.2f %-4s", real_time * 100,
-            "%", cpu_time * 100, "%", 
-            latency_str.c_str(), "%",
-            throughput_str.c_str(), "%", power_val, "%", rss_val, "%");
+    printer(Out, COLOR_YELLOW, "%10.0f %-4s %10.0f %-4s", real_time * 100, "%",
+            cpu_time * 100, "%");
   } else {
     const char* timeLabel = GetTimeUnitString(result.time_unit);
-    printer(Out, COLOR_YELLOW, "%s %-4s %s %-4s %s %-4s %s %-4s %12.2f %-4s %12.2f %-4s",
+    printer(Out, COLOR_YELLOW, "%s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s %s %-4s",
             real_time_str.c_str(), timeLabel, cpu_time_str.c_str(), timeLabel,
-            latency_str.c_str(), timeLabel, 
-            throughput_str.c_str(), "s", power_val, "W", rss_val, "kB");
+            slack_str.c_str(), timeLabel,
+            p50_str.c_str(), timeLabel, p90_str.c_str(), timeLabel,
+            p99_str.c_str(), timeLabel, max_str.c_str(), timeLabel,
+            throughput_str.c_str(), "s", power_str.c_str(), "W",
+            energy_str.c_str(), "J", rss_str.c_str(), "kB",
+            allocs_str.c_str(), "", alloc_kb_str.c_str(), "kB",
+            ipc_str.c_str(), "", llc_str.c_str(), "",
+            tlb_str.c_str(), "", branch_str.c_str(), "");
   }
 
   if (!result.report_big_o && !result.report_rms) {
     printer(Out, COLOR_CYAN, "%10lld", result.iterations);
   }
 
+  // Per-bootstrap wall time, key switches and NTTs of each phase; counts the
+  // profiler could not hook are n/a.
+  if (HasPhaseCounters(result.counters)) {
+    const char* timeLabel = GetTimeUnitString(result.time_unit);
+    for (const char* phase : kBootstrapPhases) {
+      const std::string name(phase);
+      const std::string time_str =
+          FormatLatencyCounter(result.counters, (name + "_s").c_str(),
+                               multiplier);
+      printer(Out, COLOR_DEFAULT, " %s %-4s %15s %15s", time_str.c_str(),
+              timeLabel,
+              FormatCounter(result.counters, (name + "_KS").c_str()).c_str(),
+              FormatCounter(result.counters, (name + "_NTT").c_str()).c_str());
+    }
+  }
+
   // for (auto& c : result.counters) {
   //   const std::size_t cNameLen =
   //       std::max(std::string::size_type(10), c.first.length());
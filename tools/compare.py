@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+"""Compare two benchmark result files and flag significant regressions.
+
+The inputs are the JSON or CSV files written by the benchmark binaries with
+--benchmark_out=<file> (see benchmarks/common/results.h); Google Benchmark's own
+JSON output works too, with the time columns only. Run the binaries with
+--benchmark_repetitions=N (N >= 5 or so) to get something to test:
+
+    ./simple-ckks-bootstrapping --benchmark_repetitions=10 --benchmark_out=base.json
+    ... change something, rebuild ...
+    ./simple-ckks-bootstrapping --benchmark_repetitions=10 --benchmark_out=new.json
+    tools/compare.py base.json new.json --metric real_time --metric lat_p99
+
+For every benchmark present in both files and every metric, the per-repetition
+samples are compared with a two-sided Mann-Whitney U test (exact for small samples
+without ties, normal approximation otherwise). Files that only contain aggregates
+(ReportAggregatesOnly) fall back to Welch's t-test on mean/stddev. A change is
+flagged when p < --alpha and the relative change exceeds --threshold in the
+metric's "worse" direction (higher for times, lower for throughput). The exit
+status is 1 when at least one regression is flagged.
+"""
+
+import argparse
+import csv
+import json
+import math
+import re
+import sys
+
+# Metrics where larger values are better; everything else is a cost.
+HIGHER_IS_BETTER = {"throughput_per_s", "precision_bits", "levels"}
+
+REPEATS_SUFFIX = re.compile(r"/repeats:\d+")
+
+
+def load(path):
+    """Returns the benchmark rows of a result file as a list of dicts."""
+    with open(path, newline="") as f:
+        text = f.read()
+    if text.lstrip().startswith("{"):
+        data = json.loads(text)
+        rows = data.get("benchmarks", [])
+        for row in rows:
+            for key, value in row.pop("counters", {}).items():
+                row.setdefault(key, value)
+        return rows
+    lines = [line for line in text.splitlines() if not line.startswith("#")]
+    rows = []
+    for row in csv.DictReader(lines):
+        for pair in filter(None, (row.pop("counters", "") or "").split(";")):
+            key, _, value = pair.partition("=")
+            row.setdefault(key, value)
+        rows.append(row)
+    return rows
+
+
+def number(value):
+    if value is None or value == "":
+        return None
+    try:
+        value = float(value)
+    except (TypeError, ValueError):
+        return None
+    return value if math.isfinite(value) else None
+
+
+def group(rows, metric):
+    """Maps benchmark name -> (samples, aggregates) for one metric."""
+    groups = {}
+    for row in rows:
+        if row.get("error_message"):
+            continue
+        name = REPEATS_SUFFIX.sub("", row.get("run_name") or row["name"])
+        name = re.sub(r"_(mean|median|stddev|cv)$", "", name) if row.get("run_type") == "aggregate" else name
+        samples, aggregates = groups.setdefault(name, ([], {}))
+        value = number(row.get(metric))
+        if value is None:
+            continue
+        if row.get("run_type", "iteration") == "aggregate":
+            aggregates[row.get("aggregate_name", "")] = value
+            aggregates["n"] = number(row.get("repetitions")) or 0
+        else:
+            samples.append(value)
+    return groups
+
+
+def normal_sf(z):
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def mann_whitney(a, b):
+    """Two-sided p-value of the Mann-Whitney U test."""
+    n1, n2 = len(a), len(b)
+    ranked = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(ranked)
+    ties = []
+    i = 0
+    while i < len(ranked):
+        j = i
+        while j + 1 < len(ranked) and ranked[j + 1][0] == ranked[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        if j > i:
+            ties.append(j - i + 1)
+        i = j + 1
+    r1 = sum(r for r, (_, which) in zip(ranks, ranked) if which == 0)
+    u1 = r1 - n1 * (n1 + 1) / 2
+    u = min(u1, n1 * n2 - u1)
+
+    if not ties and n1 * n2 <= 400:
+        # Exact null distribution: counts[m][n][u] via the usual recurrence.
+        counts = [[None] * (n2 + 1) for _ in range(n1 + 1)]
+        for m in range(n1 + 1):
+            for n in range(n2 + 1):
+                if m == 0 or n == 0:
+                    counts[m][n] = [1]
+                    continue
+                dist = [0] * (m * n + 1)
+                for k, c in enumerate(counts[m - 1][n]):
+                    dist[k + n] += c
+                for k, c in enumerate(counts[m][n - 1]):
+                    dist[k] += c
+                counts[m][n] = dist
+        dist = counts[n1][n2]
+        tail = sum(dist[: int(u) + 1]) / sum(dist)
+        return min(1.0, 2 * tail)
+
+    mean = n1 * n2 / 2
+    n = n1 + n2
+    tie_term = sum(t ** 3 - t for t in ties) / (n * (n - 1))
+    sigma = math.sqrt(n1 * n2 / 12 * ((n + 1) - tie_term))
+    if sigma == 0:
+        return 1.0
+    z = (abs(u1 - mean) - 0.5) / sigma
+    return min(1.0, 2 * normal_sf(max(z, 0.0)))
+
+
+def betacf(a, b, x):
+    """Continued fraction of the regularized incomplete beta function."""
+    tiny = 1e-300
+    c, d = 1.0, 1.0 - (a + b) * x / (a + 1)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        for num in (m * (b - m) * x / ((a + m2 - 1) * (a + m2)), -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1))):
+            d = 1.0 + num * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + num / c
+            c = c if abs(c) > tiny else tiny
+            h *= d * c
+        if abs(d * c - 1.0) < 1e-12:
+            break
+    return h
+
+
+def student_t_sf2(t, df):
+    """Two-sided tail probability of Student's t distribution."""
+    x = df / (df + t * t)
+    a, b = df / 2, 0.5
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1 - x))
+    if x < (a + 1) / (a + b + 2):
+        return front * betacf(a, b, x) / a
+    return 1.0 - front * betacf(b, a, 1 - x) / b
+
+
+def welch(mean1, sd1, n1, mean2, sd2, n2):
+    """Two-sided p-value of Welch's t-test from summary statistics."""
+    if n1 < 2 or n2 < 2:
+        return None
+    v1, v2 = sd1 * sd1 / n1, sd2 * sd2 / n2
+    if v1 + v2 == 0:
+        return 0.0 if mean1 != mean2 else 1.0
+    t = (mean2 - mean1) / math.sqrt(v1 + v2)
+    df = (v1 + v2) ** 2 / (v1 * v1 / (n1 - 1) + v2 * v2 / (n2 - 1))
+    return student_t_sf2(abs(t), df)
+
+
+def median(values):
+    values = sorted(values)
+    mid = len(values) // 2
+    return values[mid] if len(values) % 2 else (values[mid - 1] + values[mid]) / 2
+
+
+def compare(base, contender, metric):
+    """Yields (name, base value, new value, change, p-value) per common benchmark."""
+    old, new = group(base, metric), group(contender, metric)
+    for name in old:
+        if name not in new:
+            continue
+        (a, agg_a), (b, agg_b) = old[name], new[name]
+        if a and b:
+            p = mann_whitney(a, b) if len(a) >= 2 and len(b) >= 2 else None
+            x, y = median(a), median(b)
+        elif "mean" in agg_a and "mean" in agg_b:
+            x, y = agg_a["mean"], agg_b["mean"]
+            p = welch(x, agg_a.get("stddev", 0), agg_a["n"], y, agg_b.get("stddev", 0), agg_b["n"])
+        else:
+            continue
+        change = (y - x) / abs(x) if x else (0.0 if y == x else math.inf)
+        yield name, x, y, change, p
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--metric", action="append",
+                        help="column to compare (repeatable; default: real_time)")
+    parser.add_argument("--alpha", type=float, default=0.05, help="significance level (default 0.05)")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="minimum relative change to flag (default 0.05 = 5%%)")
+    parser.add_argument("--filter", default="", help="regular expression on benchmark names")
+    args = parser.parse_args()
+
+    base, contender = load(args.baseline), load(args.contender)
+    pattern = re.compile(args.filter)
+    regressions = 0
+    header = "%-60s %-16s %14s %14s %9s %8s  %s" % ("Benchmark", "Metric", "Baseline", "Contender", "Change", "p", "")
+    print(header)
+    print("-" * len(header))
+    for metric in args.metric or ["real_time"]:
+        for name, x, y, change, p in compare(base, contender, metric):
+            if not pattern.search(name):
+                continue
+            worse = change < 0 if metric in HIGHER_IS_BETTER else change > 0
+            verdict = ""
+            if p is None:
+                verdict = "(too few samples)"
+            elif p < args.alpha and abs(change) > args.threshold:
+                verdict = "REGRESSION" if worse else "improvement"
+                regressions += worse
+            print("%-60s %-16s %14.6g %14.6g %+8.1f%% %8s  %s" % (
+                name[:60], metric, x, y, 100 * change, "n/a" if p is None else "%.4f" % p, verdict))
+    if regressions:
+        print("\n%d significant regression(s)" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
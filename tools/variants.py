@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""Build the benchmarks as several compiler variants and print the results side by side.
+
+Every variant is configured and built from the top-level CMakeLists.txt in its own
+directory under --build-root, then the selected benchmarks are run from each build
+with --benchmark_out and their medians are printed in one table, with the gain
+relative to the first variant (positive is faster, or higher throughput):
+
+    tools/variants.py --variants baseline,lto,native,pgo,lto+native+pgo \\
+        -- -DOpenFHE_DIR=/usr/local/lib/OpenFHE -DFHEBENCH_FETCH_BENCHMARK=ON
+
+Variants are "+"-separated sets of lto (FHEBENCH_LTO), native (FHEBENCH_NATIVE,
+-march=native) and pgo, or baseline. A pgo variant is built twice: first
+instrumented (FHEBENCH_PGO=GENERATE), then trained on a short run of the CKKS and
+CGGI benchmarks in TRAINING, then rebuilt with the profile (FHEBENCH_PGO=USE). The
+flags apply to the benchmark code and to what it inlines from the library headers;
+OpenFHE and HElib themselves keep the flags they were built with.
+
+Arguments after "--" are passed to every cmake configure. The runs share one key
+cache (--build-root/.fhebench-keys), so keys are generated once for all variants.
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from compare import HIGHER_IS_BETTER, group, load, median  # noqa: E402
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+OPTIONS = {
+    "lto": ["-DFHEBENCH_LTO=ON"],
+    "native": ["-DFHEBENCH_NATIVE=ON"],
+    "pgo": [],
+}
+
+# (binary, --benchmark_filter) of the PGO training run and of the default measurement.
+TRAINING = [
+    ("simple-ckks-bootstrapping", "EvalBootstrap/logN:12/"),
+    ("binfhe-ginx", "FHEW_BINGATE/MEDIUM_AND"),
+    ("cggi-eval-func", "FHEW_EVAL_FUNC/MEDIUM"),
+]
+TRAINING_ARGS = ["--benchmark_min_time=0.05", "--benchmark_repetitions=1"]
+
+
+def parse_variant(name):
+    parts = [] if name == "baseline" else name.split("+")
+    for part in parts:
+        if part not in OPTIONS:
+            raise SystemExit("unknown variant component %r (expected baseline or lto/native/pgo)" % part)
+    return parts
+
+
+def run(command, **kwargs):
+    print("+ " + " ".join(command), flush=True)
+    subprocess.run(command, check=True, **kwargs)
+
+
+def configure_and_build(build_dir, flags, cmake_args, targets, jobs):
+    run(["cmake", "-S", ROOT, "-B", build_dir, "-DCMAKE_BUILD_TYPE=Release"] + flags + cmake_args)
+    run(["cmake", "--build", build_dir, "-j", str(jobs), "--target"] + targets)
+
+
+def run_benchmark(binary, bench_filter, extra, cwd):
+    env = dict(os.environ)
+    env.setdefault("FHEBENCH_KEY_CACHE", os.path.join(cwd, ".fhebench-keys"))
+    run([binary, "--benchmark_filter=" + bench_filter] + extra, cwd=cwd, env=env)
+
+
+def build_variant(name, args, benches):
+    """Builds one variant and returns its build directory."""
+    parts = parse_variant(name)
+    build_dir = os.path.join(args.build_root, name)
+    flags = [flag for part in parts for flag in OPTIONS[part]]
+    targets = sorted({binary for binary, _ in benches})
+
+    if "pgo" in parts:
+        profile_dir = os.path.join(build_dir, "pgo-profile")
+        shutil.rmtree(profile_dir, ignore_errors=True)
+        configure_and_build(build_dir, flags + ["-DFHEBENCH_PGO=GENERATE", "-DFHEBENCH_PGO_DIR=" + profile_dir],
+                            args.cmake_args, sorted({binary for binary, _ in TRAINING}), args.jobs)
+        for binary, bench_filter in TRAINING:
+            run_benchmark(os.path.join(build_dir, binary), bench_filter, TRAINING_ARGS, args.build_root)
+        flags += ["-DFHEBENCH_PGO=USE", "-DFHEBENCH_PGO_DIR=" + profile_dir]
+    else:
+        flags += ["-DFHEBENCH_PGO=OFF"]
+    configure_and_build(build_dir, flags, args.cmake_args, targets, args.jobs)
+    return build_dir
+
+
+def measure(build_dir, args, benches):
+    """Runs the benchmarks of one variant and returns all result rows."""
+    rows = []
+    out_dir = os.path.join(build_dir, "results")
+    os.makedirs(out_dir, exist_ok=True)
+    for binary, bench_filter in benches:
+        out = os.path.join(out_dir, binary + ".json")
+        run_benchmark(os.path.join(build_dir, binary), bench_filter,
+                      ["--benchmark_repetitions=%d" % args.repetitions, "--benchmark_out=" + out], args.build_root)
+        rows += load(out)
+    return rows
+
+
+def side_by_side(variants, results, metrics):
+    """Prints one row per benchmark and metric, one column per variant."""
+    header = "%-56s %-12s" % ("Benchmark", "Metric")
+    for i, name in enumerate(variants):
+        header += " %14s" % name[:14] + ("" if i == 0 else " %8s" % "gain")
+    print(header)
+    print("-" * len(header))
+    for metric in metrics:
+        values = {}
+        for name in variants:
+            for bench, (samples, aggregates) in group(results[name], metric).items():
+                value = median(samples) if samples else aggregates.get("median", aggregates.get("mean"))
+                if value is not None:
+                    values.setdefault(bench, {})[name] = value
+        for bench, by_variant in values.items():
+            base = by_variant.get(variants[0])
+            line = "%-56s %-12s" % (bench[:56], metric)
+            for i, name in enumerate(variants):
+                value = by_variant.get(name)
+                line += " %14s" % ("n/a" if value is None else "%.6g" % value)
+                if i == 0:
+                    continue
+                if value is None or not base:
+                    line += " %8s" % ""
+                    continue
+                # Positive is better, for costs and for throughput alike.
+                change = (value - base) / abs(base)
+                line += " %+7.1f%%" % (100 * (change if metric in HIGHER_IS_BETTER else -change))
+            print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--variants", default="baseline,lto,native,pgo",
+                        help="comma-separated variants (default baseline,lto,native,pgo)")
+    parser.add_argument("--build-root", default="build-variants", help="directory of the builds and results")
+    parser.add_argument("--bench", action="append", metavar="BINARY:FILTER",
+                        help="benchmark binary and filter to measure (repeatable; default: the training set)")
+    parser.add_argument("--metric", action="append", help="column to compare (repeatable; default: real_time)")
+    parser.add_argument("--repetitions", type=int, default=5, help="--benchmark_repetitions (default 5)")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="build parallelism")
+    parser.add_argument("--no-build", action="store_true", help="reuse the existing builds")
+    parser.add_argument("cmake_args", nargs="*", help="arguments for cmake, after --")
+    args = parser.parse_args()
+
+    args.build_root = os.path.abspath(args.build_root)
+    os.makedirs(args.build_root, exist_ok=True)
+    variants = [v for v in args.variants.split(",") if v]
+    benches = [tuple(b.split(":", 1)) if ":" in b else (b, ".") for b in args.bench] if args.bench else TRAINING
+
+    results = {}
+    for name in variants:
+        build_dir = os.path.join(args.build_root, name) if args.no_build else build_variant(name, args, benches)
+        results[name] = measure(build_dir, args, benches)
+
+    print()
+    side_by_side(variants, results, args.metric or ["real_time"])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())